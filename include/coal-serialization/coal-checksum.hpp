@@ -0,0 +1,121 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2021 Desarrollo de Software Ronie Salgado Faila E.I.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef COAL_SERIALIZATION_COAL_CHECKSUM_HPP
+#define COAL_SERIALIZATION_COAL_CHECKSUM_HPP
+
+#pragma once
+
+#include "coal.hpp"
+
+namespace coal
+{
+
+/**
+ * I compute the CRC32C (Castagnoli) checksum of some data. The checksum of the previous data can be passed for extending it.
+ * I use the SSE 4.2 or the ARMv8 CRC32 instructions when they are available, and a slicing by 8 table driven fallback otherwise.
+ */
+uint32_t crc32c(const uint8_t *data, size_t size, uint32_t previousChecksum = 0);
+
+/**
+ * I compute the CRC32C checksum of the concatenation of two pieces of data from their checksums.
+ */
+uint32_t crc32cCombine(uint32_t firstChecksum, uint32_t secondChecksum, size_t secondSize);
+
+bool isCrc32cHardwareAccelerated();
+
+/**
+ * CRC32C write stream.
+ * I forward the data into a target stream while computing the checksum of the current section and of the whole message.
+ */
+class Crc32cWriteStream : public WriteStream
+{
+public:
+    static constexpr size_t BufferSize = 16*1024;
+
+    Crc32cWriteStream(WriteStream *initialTarget);
+
+    virtual void writeBytes(const uint8_t *data, size_t size) override;
+
+    /**
+     * I return the checksum of the data written since the end of the previous section, and I start a new section.
+     */
+    uint32_t endSection();
+
+    /**
+     * I end the current section and I write its checksum, which is only part of the checksum of the whole message.
+     */
+    void writeSectionChecksum();
+
+    /**
+     * I flush the pending data and I return the checksum of all of the data written into me.
+     */
+    uint32_t finish();
+
+private:
+    void flush();
+
+    WriteStream *target;
+    std::vector<uint8_t> buffer;
+    uint32_t sectionChecksum = 0;
+    size_t sectionSize = 0;
+    uint32_t messageChecksum = 0;
+};
+
+/**
+ * CRC32C read stream.
+ * I compute the checksum of the data that is read from a source stream whose data is not in memory.
+ * The small reads are gathered in a buffer, so that the checksum is computed over large pieces of data.
+ */
+class Crc32cReadStream : public ReadStream
+{
+public:
+    static constexpr size_t BufferSize = 16*1024;
+
+    Crc32cReadStream(ReadStream *initialSource);
+
+    virtual bool readBytes(uint8_t *destination, size_t size) override;
+    virtual bool skipBytes(size_t size) override;
+
+    /**
+     * I add into the checksum some data that was read from the source before me.
+     */
+    void includeBytes(const uint8_t *data, size_t size);
+
+    /**
+     * I return the checksum of all of the data that was read through me.
+     */
+    uint32_t finish();
+
+private:
+    void flush();
+
+    ReadStream *source;
+    std::array<uint8_t, BufferSize> buffer;
+    size_t bufferSize = 0;
+    uint32_t checksum = 0;
+};
+
+} // End of namespace coal
+
+#endif //COAL_SERIALIZATION_COAL_CHECKSUM_HPP
@@ -0,0 +1,215 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2021 Desarrollo de Software Ronie Salgado Faila E.I.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef COAL_SERIALIZATION_COAL_CHUNKED_STREAM_HPP
+#define COAL_SERIALIZATION_COAL_CHUNKED_STREAM_HPP
+
+#pragma once
+
+#include "coal.hpp"
+#include "coal-std-bindings.hpp"
+
+namespace coal
+{
+
+static constexpr uint32_t CoalChunkedStreamMagicNumber = 0x534C4F43; // COLS
+static constexpr uint8_t CoalChunkedStreamVersionMajor = 1;
+static constexpr uint8_t CoalChunkedStreamVersionMinor = 0;
+
+/**
+ * Chunked stream writer.
+ * I write a sequence of chunks, where each one of them is a complete coal message with its own blob, schema and instances.
+ * The chunks are written in session mode, so the schema is only sent in the first chunk that uses it, and a chunk
+ * that uses new types only carries their layouts.
+ * Each chunk is prefixed by its size, and the stream is terminated by a zero size.
+ */
+class ChunkedStreamWriter
+{
+public:
+    ChunkedStreamWriter(WriteStream *initialTarget);
+
+    /**
+     * I return the serializer that writes the chunks, for configuring its compression and checksums.
+     */
+    Serializer &getSerializer();
+
+    template<typename ROT>
+    void writeChunkWithRootObjectOrValue(ROT &&root)
+    {
+        writeChunkWithRootObject(ObjectMapperClassFor<ROT>::type::makeFor(root));
+    }
+
+    void writeChunkWithRootObject(const ObjectMapperPtr &rootObject);
+
+    /**
+     * I write the end of the stream.
+     */
+    void finish();
+
+private:
+    void writeHeaderIfNeeded();
+
+    WriteStream *target;
+    bool hasWrittenHeader = false;
+    std::vector<uint8_t> chunkData;
+    MemoryWriteStream chunkOutput;
+    Serializer serializer;
+};
+
+/**
+ * Chunked stream reader.
+ * I read the chunks written by a chunked stream writer one at a time, so that only a single chunk is held in memory.
+ */
+class ChunkedStreamReader
+{
+public:
+    static constexpr size_t MaxChunkSize = 256*1024*1024;
+
+    ChunkedStreamReader(ReadStream *initialSource);
+
+    template<typename T>
+    std::optional<T> readChunkWithRootObjectOrValueOfType()
+    {
+        typedef typename ObjectMapperClassFor<T>::type RootObjectMapperClass;
+
+        auto result = readChunkWithRootObject(RootObjectMapperClass::typeMapperSingleton());
+        return RootObjectMapperClass::unwrapDeserializedRootObjectOrValue(result);
+    }
+
+    /**
+     * I return the root object of the next chunk. I return null when the stream ends or when a chunk cannot be read.
+     */
+    ObjectMapperPtr readChunkWithRootObject(const TypeMapperPtr &rootTypeMapper);
+
+    /**
+     * I tell whether the end of the stream was read, for distinguishing it from a failure.
+     */
+    bool hasReachedEnd() const;
+
+private:
+    bool readHeaderIfNeeded();
+    bool readChunkData();
+
+    ReadStream *source;
+    bool hasReadHeader = false;
+    bool reachedEnd = false;
+    std::vector<uint8_t> chunkData;
+    Deserializer deserializer;
+};
+
+/**
+ * Chunked sequence writer.
+ * I write an unbounded sequence of values, by grouping them in chunks of a fixed number of values.
+ * Shared objects are only shared between the values of the same chunk.
+ */
+template<typename VT>
+class ChunkedSequenceWriter
+{
+public:
+    static constexpr size_t DefaultChunkValueCount = 1024;
+
+    ChunkedSequenceWriter(WriteStream *target, size_t initialChunkValueCount = DefaultChunkValueCount)
+        : streamWriter(target), chunkValueCount(initialChunkValueCount)
+    {
+        assert(chunkValueCount > 0);
+    }
+
+    ChunkedStreamWriter &getStreamWriter()
+    {
+        return streamWriter;
+    }
+
+    void write(const VT &value)
+    {
+        pendingValues.push_back(value);
+        if(pendingValues.size() >= chunkValueCount)
+            flush();
+    }
+
+    /**
+     * I write the pending values as a chunk, without waiting for the chunk to be full.
+     */
+    void flush()
+    {
+        if(pendingValues.empty())
+            return;
+
+        streamWriter.writeChunkWithRootObjectOrValue(pendingValues);
+        pendingValues.clear();
+    }
+
+    void finish()
+    {
+        flush();
+        streamWriter.finish();
+    }
+
+private:
+    ChunkedStreamWriter streamWriter;
+    size_t chunkValueCount;
+    std::vector<VT> pendingValues;
+};
+
+/**
+ * Chunked sequence reader.
+ * I read the values written by a chunked sequence writer, by materializing a single chunk at a time.
+ */
+template<typename VT>
+class ChunkedSequenceReader
+{
+public:
+    ChunkedSequenceReader(ReadStream *source)
+        : streamReader(source) {}
+
+    /**
+     * I return the next value. I return nothing when the sequence ends or when a chunk cannot be read.
+     */
+    std::optional<VT> read()
+    {
+        while(position >= chunkValues.size())
+        {
+            auto nextChunkValues = streamReader.template readChunkWithRootObjectOrValueOfType<std::vector<VT>> ();
+            if(!nextChunkValues.has_value())
+                return std::nullopt;
+
+            chunkValues = std::move(nextChunkValues.value());
+            position = 0;
+        }
+
+        return std::move(chunkValues[position++]);
+    }
+
+    bool hasReachedEnd() const
+    {
+        return position >= chunkValues.size() && streamReader.hasReachedEnd();
+    }
+
+private:
+    ChunkedStreamReader streamReader;
+    std::vector<VT> chunkValues;
+    size_t position = 0;
+};
+
+} // End of namespace coal
+
+#endif //COAL_SERIALIZATION_COAL_CHUNKED_STREAM_HPP
@@ -0,0 +1,141 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2021 Desarrollo de Software Ronie Salgado Faila E.I.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef COAL_SERIALIZATION_COAL_COMPRESSION_HPP
+#define COAL_SERIALIZATION_COAL_COMPRESSION_HPP
+
+#pragma once
+
+#include "coal.hpp"
+#include <thread>
+#include <condition_variable>
+
+namespace coal
+{
+
+/**
+ * The compression level that selects the default level of each codec.
+ */
+static constexpr int DefaultCompressionLevel = -1;
+
+/**
+ * I tell whether a codec is available. The zlib and zstd codecs depend on the libraries that are found when configuring the build.
+ */
+bool isCompressionCodecSupported(CompressionCodec codec);
+
+/**
+ * I return the maximum size of a block compressed with the specified codec.
+ */
+size_t compressBound(CompressionCodec codec, size_t sourceSize);
+
+/**
+ * I compress a block. I return zero if the block cannot be compressed with the specified codec.
+ */
+size_t compressBlock(CompressionCodec codec, const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t destinationCapacity, int level = DefaultCompressionLevel);
+
+/**
+ * I decompress a block whose decompressed size is known in advance.
+ */
+bool decompressBlock(CompressionCodec codec, const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t destinationSize);
+
+/**
+ * Compressing write stream.
+ * I split the data that is written into me in chunks that are compressed independently and written into the target stream.
+ * Each chunk is prefixed by its raw size and its stored size, and the stream is terminated by a zero raw size.
+ * With more than one thread, I buffer one chunk per thread and I compress them in parallel.
+ * My worker threads are started on the first parallel batch, and they are kept until I am destroyed.
+ */
+class CompressingWriteStream : public WriteStream
+{
+public:
+    static constexpr size_t ChunkSize = 64*1024;
+
+    CompressingWriteStream(WriteStream *initialTarget, CompressionCodec initialCodec, size_t initialThreadCount = 1);
+    ~CompressingWriteStream();
+
+    virtual void writeBytes(const uint8_t *data, size_t size) override;
+
+    void setCompressionLevel(int newLevel);
+    void finish();
+
+private:
+    struct Chunk
+    {
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> compressedData;
+        size_t compressedSize = 0;
+    };
+
+    void compressChunk(Chunk &chunk);
+    void compressChunksInWorker(size_t chunkIndex);
+    void flushPendingChunks();
+
+    WriteStream *target;
+    CompressionCodec codec;
+    int level = DefaultCompressionLevel;
+    std::vector<Chunk> chunks;
+    size_t pendingChunkCount = 0;
+
+    std::vector<std::thread> workers;
+    std::mutex workerMutex;
+    std::condition_variable batchStartedCondition;
+    std::condition_variable batchFinishedCondition;
+    uint64_t batchGeneration = 0;
+    size_t batchChunkCount = 0;
+    size_t remainingWorkerChunkCount = 0;
+    bool stoppingWorkers = false;
+};
+
+/**
+ * Decompressing read stream.
+ * I read the chunks written by a compressing write stream and I decompress them on demand.
+ */
+class DecompressingReadStream : public ReadStream
+{
+public:
+    static constexpr size_t MaxChunkSize = 16*1024*1024;
+
+    DecompressingReadStream(ReadStream *initialSource, CompressionCodec initialCodec);
+
+    virtual bool readBytes(uint8_t *buffer, size_t size) override;
+    virtual bool skipBytes(size_t size) override;
+
+    /**
+     * I check that all of the decompressed data was consumed, and I read the end of the stream.
+     */
+    bool finish();
+
+private:
+    bool readChunk();
+
+    ReadStream *source;
+    CompressionCodec codec;
+    bool hasReachedEnd = false;
+    size_t position = 0;
+    std::vector<uint8_t> chunk;
+    std::vector<uint8_t> compressedChunk;
+};
+
+} // End of namespace coal
+
+#endif //COAL_SERIALIZATION_COAL_COMPRESSION_HPP
@@ -0,0 +1,183 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2021 Desarrollo de Software Ronie Salgado Faila E.I.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef COAL_SERIALIZATION_COAL_LOG_HPP
+#define COAL_SERIALIZATION_COAL_LOG_HPP
+
+#pragma once
+
+#include "coal.hpp"
+#include <cstdio>
+
+namespace coal
+{
+
+static constexpr uint32_t CoalLogMagicNumber = 0x474C4F43; // COLG
+static constexpr uint32_t CoalLogIndexMagicNumber = 0x494C4F43; // COLI
+static constexpr uint8_t CoalLogVersionMajor = 1;
+static constexpr uint8_t CoalLogVersionMinor = 0;
+
+/**
+ * The location and the timestamp of a record of a coal log.
+ */
+struct CoalLogRecordEntry
+{
+    uint64_t offset = 0;
+    uint64_t timestamp = 0;
+};
+
+/**
+ * Memory mapped file.
+ * I map a whole file for reading.
+ */
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile() = default;
+    MemoryMappedFile(const MemoryMappedFile &) = delete;
+    MemoryMappedFile &operator=(const MemoryMappedFile &) = delete;
+    ~MemoryMappedFile();
+
+    bool open(const std::string &path);
+    void close();
+
+    const uint8_t *getData() const
+    {
+        return data;
+    }
+
+    size_t getSize() const
+    {
+        return size;
+    }
+
+private:
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+};
+
+/**
+ * Coal log writer.
+ * I append independent coal documents as records of a file. Each record is prefixed by its size, a CRC32C of its
+ * content and a timestamp. When closing, I write an index footer with the offset and the timestamp of every record.
+ * When opening an existing log, I drop its index footer or its torn last record before appending.
+ */
+class CoalLogWriter
+{
+public:
+    CoalLogWriter();
+    CoalLogWriter(const CoalLogWriter &) = delete;
+    CoalLogWriter &operator=(const CoalLogWriter &) = delete;
+    ~CoalLogWriter();
+
+    /**
+     * I open a log for appending records, creating it when it does not exist.
+     */
+    bool open(const std::string &path);
+
+    /**
+     * I write the index footer and I close the file.
+     */
+    bool close();
+
+    bool isOpen() const;
+
+    /**
+     * I write the pending records into the file, without writing the index.
+     */
+    bool flush();
+
+    /**
+     * I return the serializer that encodes the records, for configuring its compression and checksums.
+     */
+    Serializer &getSerializer();
+
+    template<typename VT>
+    bool append(const VT &value, uint64_t timestamp)
+    {
+        recordData.clear();
+        serializer.serializeRootObjectOrValue(value);
+        return appendRecordData(recordData.data(), recordData.size(), timestamp);
+    }
+
+    bool appendRecordData(const uint8_t *data, size_t size, uint64_t timestamp);
+
+    size_t getRecordCount() const;
+
+private:
+    bool writeData(const void *data, size_t size);
+
+    FILE *file = nullptr;
+    uint64_t fileSize = 0;
+    std::vector<CoalLogRecordEntry> entries;
+    std::vector<uint8_t> recordData;
+    MemoryWriteStream recordOutput;
+    Serializer serializer;
+};
+
+/**
+ * Coal log reader.
+ * I map a coal log into memory and I give random access to its records. I use the index footer when it is present,
+ * and I scan the records otherwise, stopping at a torn or corrupted record.
+ */
+class CoalLogReader
+{
+public:
+    CoalLogReader();
+
+    bool open(const std::string &path);
+    void close();
+
+    size_t getRecordCount() const;
+    uint64_t getRecordTimestamp(size_t index) const;
+
+    /**
+     * I return the index of the first record whose timestamp is not less than the given one, assuming that the timestamps are not decreasing.
+     */
+    size_t findFirstRecordAtOrAfter(uint64_t timestamp) const;
+
+    /**
+     * I give a view of the content of a record, which remains valid while the log is open. I fail when its checksum does not match.
+     */
+    bool getRecordData(size_t index, const uint8_t *&data, size_t &size) const;
+
+    template<typename T>
+    std::optional<T> read(size_t index)
+    {
+        typedef typename ObjectMapperClassFor<T>::type RootObjectMapperClass;
+
+        auto result = readWithRootObject(index, RootObjectMapperClass::typeMapperSingleton());
+        return RootObjectMapperClass::unwrapDeserializedRootObjectOrValue(result);
+    }
+
+    ObjectMapperPtr readWithRootObject(size_t index, const TypeMapperPtr &rootTypeMapper);
+
+private:
+    MemoryMappedFile mappedFile;
+    std::vector<CoalLogRecordEntry> entries;
+    Deserializer deserializer;
+};
+
+} // End of namespace coal
+
+#endif //COAL_SERIALIZATION_COAL_LOG_HPP
@@ -29,8 +29,15 @@
 #include "coal.hpp"
 
 #include <array>
+#include <cstddef>
+#include <iterator>
 #include <map>
+#include <optional>
 #include <set>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <variant>
 
 namespace coal
 {
@@ -59,6 +66,151 @@ public:
 template<>
 struct TypeMapperFor<std::string> : SingletonTypeMapperFor<StdStringTypeMapper> {};
 
+/**
+ * std::string_view type mapper.
+ * I read the string views without copying them, so they point into the blob of the deserializer. See Deserializer::getBinaryBlobHandle.
+ * I am not read by coal::deserialize, because its deserializer does not outlive it.
+ */
+class StdStringViewTypeMapper : public PrimitiveTypeMapper
+{
+public:
+    static constexpr bool IsObjectType = false;
+    static constexpr bool IsReferenceType = false;
+
+    static TypeMapperPtr uniqueInstance();
+
+    StdStringViewTypeMapper();
+
+    virtual std::string getQualifiedName() const override;
+    virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override;
+    virtual void pushFieldDataIntoBinaryBlob(void *fieldPointer, BinaryBlobBuilder &binaryBlobBuilder) override;
+
+    virtual bool canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const override;
+
+    virtual bool readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override;
+    virtual TypeDescriptorPtr getOrCreateTypeDescriptor(TypeDescriptorContext *context) override;
+};
+
+template<>
+struct TypeMapperFor<std::string_view> : SingletonTypeMapperFor<StdStringViewTypeMapper> {};
+
+/**
+ * Shared immutable string type mapper.
+ * I read the strings from the string pool of the deserializer when it is enabled, so that the repeated strings are materialized once.
+ * A null string is written as an empty string.
+ */
+class StdSharedStringTypeMapper : public PrimitiveTypeMapper
+{
+public:
+    static constexpr bool IsObjectType = false;
+    static constexpr bool IsReferenceType = false;
+
+    static TypeMapperPtr uniqueInstance();
+
+    StdSharedStringTypeMapper();
+
+    virtual std::string getQualifiedName() const override;
+    virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override;
+    virtual void pushFieldDataIntoBinaryBlob(void *fieldPointer, BinaryBlobBuilder &binaryBlobBuilder) override;
+
+    virtual bool canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const override;
+
+    virtual bool readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override;
+    virtual TypeDescriptorPtr getOrCreateTypeDescriptor(TypeDescriptorContext *context) override;
+};
+
+template<>
+struct TypeMapperFor<std::shared_ptr<const std::string>> : SingletonTypeMapperFor<StdSharedStringTypeMapper> {};
+
+/**
+ * Bytes view.
+ * I am a read-only view of a byte range that I do not own, such as a binary payload in the blob of a deserializer.
+ */
+class BytesView
+{
+public:
+    BytesView() = default;
+    BytesView(const uint8_t *initialData, size_t initialSize)
+        : viewData(initialData), viewSize(initialSize) {}
+
+    template<typename CT>
+    BytesView(const CT &container)
+        : viewData(reinterpret_cast<const uint8_t*> (std::data(container))), viewSize(std::size(container)) {}
+
+    const uint8_t *data() const
+    {
+        return viewData;
+    }
+
+    size_t size() const
+    {
+        return viewSize;
+    }
+
+    bool empty() const
+    {
+        return viewSize == 0;
+    }
+
+    const uint8_t *begin() const
+    {
+        return viewData;
+    }
+
+    const uint8_t *end() const
+    {
+        return viewData + viewSize;
+    }
+
+    uint8_t operator[](size_t index) const
+    {
+        assert(index < viewSize);
+        return viewData[index];
+    }
+
+    bool operator==(const BytesView &other) const
+    {
+        return viewSize == other.viewSize && (viewSize == 0 || memcmp(viewData, other.viewData, viewSize) == 0);
+    }
+
+    bool operator!=(const BytesView &other) const
+    {
+        return !(*this == other);
+    }
+
+private:
+    const uint8_t *viewData = nullptr;
+    size_t viewSize = 0;
+};
+
+/**
+ * Bytes view type mapper.
+ * I read the byte views without copying them, so they point into the blob of the deserializer. See Deserializer::getBinaryBlobHandle.
+ * I am not read by coal::deserialize, because its deserializer does not outlive it.
+ */
+class BytesViewTypeMapper : public PrimitiveTypeMapper
+{
+public:
+    static constexpr bool IsObjectType = false;
+    static constexpr bool IsReferenceType = false;
+
+    static TypeMapperPtr uniqueInstance();
+
+    BytesViewTypeMapper();
+
+    virtual std::string getQualifiedName() const override;
+    virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override;
+    virtual void pushFieldDataIntoBinaryBlob(void *fieldPointer, BinaryBlobBuilder &binaryBlobBuilder) override;
+
+    virtual bool canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const override;
+
+    virtual bool readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override;
+    virtual TypeDescriptorPtr getOrCreateTypeDescriptor(TypeDescriptorContext *context) override;
+};
+
+template<>
+struct TypeMapperFor<BytesView> : SingletonTypeMapperFor<BytesViewTypeMapper> {};
+
 /**
  * std::vector type mapper.
  */
@@ -77,114 +229,837 @@ public:
         return singleton;
     }
 
-    StdVectorTypeMapper()
-    {
-        name = typeDescriptorKindToString(TypeDescriptorKind::Array32);
+    StdVectorTypeMapper()
+    {
+        name = typeDescriptorKindToString(TypeDescriptorKind::Array32);
+    }
+
+    virtual std::string getQualifiedName() const override
+    {
+        return name + "<" + typeMapperForType<ET> ()->getQualifiedName() + ">";
+    }
+
+    virtual void typeMapperDependenciesDo(const TypeMapperIterationBlock &aBlock) override
+    {
+        typeMapperForType<ET> ()->withTypeMapperDependenciesDo(aBlock);
+    }
+
+    virtual void objectReferencesInFieldDo(void *fieldPointer, const ObjectReferenceIterationBlock &aBlock) override
+    {
+        auto &vector = *reinterpret_cast<std::vector<ET>*> (fieldPointer);
+        auto elementType = typeMapperForType<ET> ();
+        for(auto &element : vector)
+            elementType->objectReferencesInFieldDo(&element, aBlock);
+    }
+
+    virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override
+    {
+        auto &vector = *reinterpret_cast<std::vector<ET>*> (fieldPointer);
+        output->writeUInt32(uint32_t(vector.size()));
+        auto elementType = typeMapperForType<ET> ();
+        for(auto &element : vector)
+            elementType->writeFieldWith(&element, output);
+    }
+
+    virtual void pushFieldDataIntoBinaryBlob(void *fieldPointer, BinaryBlobBuilder &binaryBlobBuilder) override
+    {
+        auto &vector = *reinterpret_cast<std::vector<ET>*> (fieldPointer);
+        auto elementType = typeMapperForType<ET> ();
+        for(auto &element : vector)
+            elementType->pushFieldDataIntoBinaryBlob(&element, binaryBlobBuilder);
+    }
+
+    virtual bool canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const override
+    {
+        switch(encoding->kind)
+        {
+        case TypeDescriptorKind::Array8:
+        case TypeDescriptorKind::Array16:
+        case TypeDescriptorKind::Array32:
+            {
+                auto targetTypeMapper = typeMapperForType<ET> ();
+                auto elementTypeDescriptor = std::static_pointer_cast<ArrayTypeDescriptor> (encoding)->element;
+                return targetTypeMapper->canReadFieldWithTypeDescriptor(elementTypeDescriptor);
+            }
+        default:
+            return false;
+        }
+    }
+
+    virtual bool readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override
+    {
+        auto &destination = *reinterpret_cast<std::vector<ET>*> (fieldPointer);
+
+        switch(fieldEncoding->kind)
+        {
+        case TypeDescriptorKind::Array8:
+            {
+                uint8_t count = 0;
+                if(!input->readUInt8(count))
+                    return false;
+                destination.resize(count);
+            }
+            break;
+        case TypeDescriptorKind::Array16:
+            {
+                uint16_t count = 0;
+                if(!input->readUInt16(count))
+                    return false;
+                destination.resize(count);
+            }
+            break;
+        case TypeDescriptorKind::Array32:
+            {
+                uint32_t count = 0;
+                if(!input->readUInt32(count))
+                    return false;
+                destination.resize(count);
+            }
+            break;
+        default:
+            return false;
+        }
+
+        auto targetTypeMapper = typeMapperForType<ET> ();
+        auto elementTypeDescriptor = std::static_pointer_cast<ArrayTypeDescriptor> (fieldEncoding)->element;
+        for(size_t i = 0; i < destination.size(); ++i)
+        {
+            auto elementFieldPointer = &destination[i];
+            if(!targetTypeMapper->readFieldWith(elementFieldPointer, elementTypeDescriptor, input))
+                return false;
+        }
+
+        return true;
+    }
+
+    virtual TypeDescriptorPtr getOrCreateTypeDescriptor(TypeDescriptorContext *context) override
+    {
+        return context->getOrCreateArrayTypeDescriptor(TypeDescriptorKind::Array32, 
+            context->getForTypeMapper(typeMapperForType<ET> ())
+        );
+    }
+};
+
+template<typename ET>
+struct TypeMapperFor<std::vector<ET>> : SingletonTypeMapperFor<StdVectorTypeMapper<ET>> {};
+
+/**
+ * std::vector<float> type mapper with half precision elements. The elements are converted in batches.
+ */
+class Float16VectorTypeMapper : public PrimitiveTypeMapper
+{
+public:
+    static constexpr size_t ConversionBatchSize = 256;
+
+    static TypeMapperPtr uniqueInstance();
+
+    Float16VectorTypeMapper();
+
+    virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override;
+    virtual bool canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const override;
+    virtual bool readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override;
+    virtual TypeDescriptorPtr getOrCreateTypeDescriptor(TypeDescriptorContext *context) override;
+};
+
+template<>
+struct Float16TypeMapperFor<std::vector<float>>
+{
+    static TypeMapperPtr apply()
+    {
+        return Float16VectorTypeMapper::uniqueInstance();
+    }
+};
+
+/**
+ * Byte vector type mapper.
+ * I store the bytes in the binary blob, where identical payloads are shared, and I copy them in a single operation.
+ * I can also read the byte arrays that were written element by element.
+ */
+template<typename BT>
+class StdByteVectorTypeMapper : public PrimitiveTypeMapper
+{
+public:
+    static constexpr bool IsObjectType = false;
+    static constexpr bool IsReferenceType = false;
+
+    typedef StdByteVectorTypeMapper<BT> ThisType;
+
+    static_assert(sizeof(BT) == 1, "Byte vectors must have single byte elements.");
+
+    static TypeMapperPtr uniqueInstance()
+    {
+        static auto singleton = std::make_shared<ThisType> ();
+        return singleton;
+    }
+
+    StdByteVectorTypeMapper()
+    {
+        name = typeDescriptorKindToString(TypeDescriptorKind::Binary_32_32);
+    }
+
+    virtual std::string getQualifiedName() const override
+    {
+        if constexpr (std::is_same_v<BT, std::byte>)
+            return "std::vector<std::byte>";
+        return name;
+    }
+
+    virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override
+    {
+        auto &vector = *reinterpret_cast<std::vector<BT>*> (fieldPointer);
+        output->writeBinary_32_32(reinterpret_cast<const uint8_t*> (vector.data()), vector.size());
+    }
+
+    virtual void pushFieldDataIntoBinaryBlob(void *fieldPointer, BinaryBlobBuilder &binaryBlobBuilder) override
+    {
+        auto &vector = *reinterpret_cast<std::vector<BT>*> (fieldPointer);
+        binaryBlobBuilder.pushBytes(reinterpret_cast<const uint8_t*> (vector.data()), std::min(vector.size(), size_t(0xFFFFFFFF)));
+    }
+
+    virtual bool canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const override
+    {
+        switch(encoding->kind)
+        {
+        case TypeDescriptorKind::Binary_32_8:
+        case TypeDescriptorKind::Binary_32_16:
+        case TypeDescriptorKind::Binary_32_32:
+            return true;
+        case TypeDescriptorKind::Array8:
+        case TypeDescriptorKind::Array16:
+        case TypeDescriptorKind::Array32:
+            return typeMapperForType<uint8_t> ()->canReadFieldWithTypeDescriptor(std::static_pointer_cast<ArrayTypeDescriptor> (encoding)->element);
+        default:
+            return false;
+        }
+    }
+
+    virtual bool readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override
+    {
+        auto &destination = *reinterpret_cast<std::vector<BT>*> (fieldPointer);
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+
+        switch(fieldEncoding->kind)
+        {
+        case TypeDescriptorKind::Binary_32_8:
+            if(!input->readBinary_32_8(data, size))
+                return false;
+            break;
+        case TypeDescriptorKind::Binary_32_16:
+            if(!input->readBinary_32_16(data, size))
+                return false;
+            break;
+        case TypeDescriptorKind::Binary_32_32:
+            if(!input->readBinary_32_32(data, size))
+                return false;
+            break;
+        default:
+            return readArrayFieldWith(destination, fieldEncoding, input);
+        }
+
+        destination.resize(size);
+        if(size > 0)
+            memcpy(destination.data(), data, size);
+        return true;
+    }
+
+    virtual TypeDescriptorPtr getOrCreateTypeDescriptor(TypeDescriptorContext *context) override
+    {
+        return context->getOrCreatePrimitiveTypeDescriptor(TypeDescriptorKind::Binary_32_32);
+    }
+
+private:
+    bool readArrayFieldWith(std::vector<BT> &destination, const TypeDescriptorPtr &fieldEncoding, ReadStream *input)
+    {
+        switch(fieldEncoding->kind)
+        {
+        case TypeDescriptorKind::Array8:
+            {
+                uint8_t count = 0;
+                if(!input->readUInt8(count))
+                    return false;
+                destination.resize(count);
+            }
+            break;
+        case TypeDescriptorKind::Array16:
+            {
+                uint16_t count = 0;
+                if(!input->readUInt16(count))
+                    return false;
+                destination.resize(count);
+            }
+            break;
+        case TypeDescriptorKind::Array32:
+            {
+                uint32_t count = 0;
+                if(!input->readUInt32(count))
+                    return false;
+                destination.resize(count);
+            }
+            break;
+        default:
+            return false;
+        }
+
+        auto elementTypeDescriptor = std::static_pointer_cast<ArrayTypeDescriptor> (fieldEncoding)->element;
+        if(elementTypeDescriptor->kind == TypeDescriptorKind::UInt8)
+            return input->readBytes(reinterpret_cast<uint8_t*> (destination.data()), destination.size());
+
+        auto elementTypeMapper = typeMapperForType<uint8_t> ();
+        for(auto &element : destination)
+        {
+            uint8_t value = 0;
+            if(!elementTypeMapper->readFieldWith(&value, elementTypeDescriptor, input))
+                return false;
+            element = BT(value);
+        }
+
+        return true;
+    }
+};
+
+template<>
+struct TypeMapperFor<std::vector<uint8_t>> : SingletonTypeMapperFor<StdByteVectorTypeMapper<uint8_t>> {};
+
+template<>
+struct TypeMapperFor<std::vector<std::byte>> : SingletonTypeMapperFor<StdByteVectorTypeMapper<std::byte>> {};
+
+/**
+ * Fixed array type mapper, for std::array and C array fields.
+ * The arrays of numeric primitives whose encoding is their in-memory representation are written and read with a single copy.
+ * An array can also be read from an encoding with a different size or from a variable size array encoding,
+ * in which case the extra elements are skipped and the missing ones are value initialized.
+ */
+template<typename CT, typename ET, size_t N>
+class FixedArrayTypeMapper : public PrimitiveTypeMapper
+{
+public:
+    static constexpr bool IsObjectType = false;
+    static constexpr bool IsReferenceType = false;
+
+    typedef FixedArrayTypeMapper<CT, ET, N> ThisType;
+
+    static TypeMapperPtr uniqueInstance()
+    {
+        static auto singleton = std::make_shared<ThisType> ();
+        return singleton;
+    }
+
+    FixedArrayTypeMapper()
+    {
+        name = typeDescriptorKindToString(TypeDescriptorKind::FixedArray);
+    }
+
+    virtual std::string getQualifiedName() const override
+    {
+        return name + "<" + typeMapperForType<ET> ()->getQualifiedName() + ", " + std::to_string(N) + ">";
+    }
+
+    static ET *elementsOf(void *fieldPointer)
+    {
+        return std::data(*reinterpret_cast<CT*> (fieldPointer));
+    }
+
+    static bool isBulkCopyEncoding(const TypeDescriptorPtr &elementEncoding)
+    {
+        if constexpr (std::is_arithmetic<ET>::value && !std::is_same<ET, bool>::value)
+            return elementEncoding->kind == TypeMapperFor<ET>::MapperType::EncodingDescriptorKind;
+        else
+            return false;
+    }
+
+    virtual void typeMapperDependenciesDo(const TypeMapperIterationBlock &aBlock) override
+    {
+        typeMapperForType<ET> ()->withTypeMapperDependenciesDo(aBlock);
+    }
+
+    virtual void objectReferencesInFieldDo(void *fieldPointer, const ObjectReferenceIterationBlock &aBlock) override
+    {
+        if constexpr (std::is_arithmetic<ET>::value)
+            return;
+
+        auto elements = elementsOf(fieldPointer);
+        auto elementType = typeMapperForType<ET> ();
+        for(size_t i = 0; i < N; ++i)
+            elementType->objectReferencesInFieldDo(&elements[i], aBlock);
+    }
+
+    virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override
+    {
+        auto elements = elementsOf(fieldPointer);
+        if constexpr (std::is_arithmetic<ET>::value)
+        {
+            output->writeBytes(reinterpret_cast<const uint8_t*> (elements), sizeof(ET)*N);
+            return;
+        }
+
+        auto elementType = typeMapperForType<ET> ();
+        for(size_t i = 0; i < N; ++i)
+            elementType->writeFieldWith(&elements[i], output);
+    }
+
+    virtual void pushFieldDataIntoBinaryBlob(void *fieldPointer, BinaryBlobBuilder &binaryBlobBuilder) override
+    {
+        if constexpr (std::is_arithmetic<ET>::value)
+            return;
+
+        auto elements = elementsOf(fieldPointer);
+        auto elementType = typeMapperForType<ET> ();
+        for(size_t i = 0; i < N; ++i)
+            elementType->pushFieldDataIntoBinaryBlob(&elements[i], binaryBlobBuilder);
+    }
+
+    virtual bool canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const override
+    {
+        switch(encoding->kind)
+        {
+        case TypeDescriptorKind::FixedArray:
+            return typeMapperForType<ET> ()->canReadFieldWithTypeDescriptor(std::static_pointer_cast<FixedArrayTypeDescriptor> (encoding)->element);
+        case TypeDescriptorKind::Array8:
+        case TypeDescriptorKind::Array16:
+        case TypeDescriptorKind::Array32:
+            return typeMapperForType<ET> ()->canReadFieldWithTypeDescriptor(std::static_pointer_cast<ArrayTypeDescriptor> (encoding)->element);
+        default:
+            return false;
+        }
+    }
+
+    virtual bool readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override
+    {
+        size_t elementCount = 0;
+        TypeDescriptorPtr elementTypeDescriptor;
+        switch(fieldEncoding->kind)
+        {
+        case TypeDescriptorKind::FixedArray:
+            {
+                auto fixedArrayEncoding = std::static_pointer_cast<FixedArrayTypeDescriptor> (fieldEncoding);
+                elementCount = fixedArrayEncoding->size;
+                elementTypeDescriptor = fixedArrayEncoding->element;
+            }
+            break;
+        case TypeDescriptorKind::Array8:
+            {
+                uint8_t count = 0;
+                if(!input->readUInt8(count))
+                    return false;
+                elementCount = count;
+                elementTypeDescriptor = std::static_pointer_cast<ArrayTypeDescriptor> (fieldEncoding)->element;
+            }
+            break;
+        case TypeDescriptorKind::Array16:
+            {
+                uint16_t count = 0;
+                if(!input->readUInt16(count))
+                    return false;
+                elementCount = count;
+                elementTypeDescriptor = std::static_pointer_cast<ArrayTypeDescriptor> (fieldEncoding)->element;
+            }
+            break;
+        case TypeDescriptorKind::Array32:
+            {
+                uint32_t count = 0;
+                if(!input->readUInt32(count))
+                    return false;
+                elementCount = count;
+                elementTypeDescriptor = std::static_pointer_cast<ArrayTypeDescriptor> (fieldEncoding)->element;
+            }
+            break;
+        default:
+            return false;
+        }
+
+        auto elements = elementsOf(fieldPointer);
+        auto readCount = std::min(elementCount, N);
+        for(size_t i = readCount; i < N; ++i)
+            elements[i] = ET();
+
+        if(isBulkCopyEncoding(elementTypeDescriptor))
+        {
+            return input->readBytes(reinterpret_cast<uint8_t*> (elements), sizeof(ET)*readCount) &&
+                input->skipBytes(sizeof(ET)*(elementCount - readCount));
+        }
+
+        auto targetTypeMapper = typeMapperForType<ET> ();
+        for(size_t i = 0; i < readCount; ++i)
+        {
+            if(!targetTypeMapper->readFieldWith(&elements[i], elementTypeDescriptor, input))
+                return false;
+        }
+
+        for(size_t i = readCount; i < elementCount; ++i)
+        {
+            if(!elementTypeDescriptor->skipDataWith(input))
+                return false;
+        }
+
+        return true;
+    }
+
+    virtual TypeDescriptorPtr getOrCreateTypeDescriptor(TypeDescriptorContext *context) override
+    {
+        return context->getOrCreateFixedArrayTypeDescriptor(uint32_t(N),
+            context->getForTypeMapper(typeMapperForType<ET> ())
+        );
+    }
+};
+
+template<typename ET, size_t N>
+struct TypeMapperFor<std::array<ET, N>> : SingletonTypeMapperFor<FixedArrayTypeMapper<std::array<ET, N>, ET, N>> {};
+
+template<typename ET, size_t N>
+struct TypeMapperFor<ET[N]> : SingletonTypeMapperFor<FixedArrayTypeMapper<ET[N], ET, N>> {};
+
+/**
+ * std::optional type mapper. The value is stored inline after a one byte presence tag.
+ * A field that was encoded without the optional wrapper is read as a present value.
+ */
+template<typename ET>
+class StdOptionalTypeMapper : public PrimitiveTypeMapper
+{
+public:
+    static constexpr bool IsObjectType = false;
+    static constexpr bool IsReferenceType = false;
+
+    typedef std::optional<ET> OptionalType;
+    typedef StdOptionalTypeMapper<ET> ThisType;
+
+    static TypeMapperPtr uniqueInstance()
+    {
+        static auto singleton = std::make_shared<ThisType> ();
+        return singleton;
+    }
+
+    StdOptionalTypeMapper()
+    {
+        name = typeDescriptorKindToString(TypeDescriptorKind::Optional);
+    }
+
+    virtual std::string getQualifiedName() const override
+    {
+        return name + "<" + typeMapperForType<ET> ()->getQualifiedName() + ">";
+    }
+
+    virtual void typeMapperDependenciesDo(const TypeMapperIterationBlock &aBlock) override
+    {
+        typeMapperForType<ET> ()->withTypeMapperDependenciesDo(aBlock);
+    }
+
+    virtual void objectReferencesInFieldDo(void *fieldPointer, const ObjectReferenceIterationBlock &aBlock) override
+    {
+        auto &optional = *reinterpret_cast<OptionalType*> (fieldPointer);
+        if(optional.has_value())
+            typeMapperForType<ET> ()->objectReferencesInFieldDo(&*optional, aBlock);
+    }
+
+    virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override
+    {
+        auto &optional = *reinterpret_cast<OptionalType*> (fieldPointer);
+        output->writeUInt8(optional.has_value() ? 1 : 0);
+        if(optional.has_value())
+            typeMapperForType<ET> ()->writeFieldWith(&*optional, output);
+    }
+
+    virtual void pushFieldDataIntoBinaryBlob(void *fieldPointer, BinaryBlobBuilder &binaryBlobBuilder) override
+    {
+        auto &optional = *reinterpret_cast<OptionalType*> (fieldPointer);
+        if(optional.has_value())
+            typeMapperForType<ET> ()->pushFieldDataIntoBinaryBlob(&*optional, binaryBlobBuilder);
+    }
+
+    virtual bool canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const override
+    {
+        auto targetTypeMapper = typeMapperForType<ET> ();
+        if(encoding->kind == TypeDescriptorKind::Optional)
+            return targetTypeMapper->canReadFieldWithTypeDescriptor(std::static_pointer_cast<OptionalTypeDescriptor> (encoding)->element);
+
+        return targetTypeMapper->canReadFieldWithTypeDescriptor(encoding);
+    }
+
+    virtual bool readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override
+    {
+        auto &destination = *reinterpret_cast<OptionalType*> (fieldPointer);
+        auto elementTypeDescriptor = fieldEncoding;
+        if(fieldEncoding->kind == TypeDescriptorKind::Optional)
+        {
+            uint8_t isPresent = 0;
+            if(!input->readUInt8(isPresent))
+                return false;
+
+            if(!isPresent)
+            {
+                destination.reset();
+                return true;
+            }
+
+            elementTypeDescriptor = std::static_pointer_cast<OptionalTypeDescriptor> (fieldEncoding)->element;
+        }
+
+        if(!destination.has_value())
+            destination.emplace();
+        return typeMapperForType<ET> ()->readFieldWith(&*destination, elementTypeDescriptor, input);
+    }
+
+    virtual TypeDescriptorPtr getOrCreateTypeDescriptor(TypeDescriptorContext *context) override
+    {
+        return context->getOrCreateOptionalTypeDescriptor(context->getForTypeMapper(typeMapperForType<ET> ()));
+    }
+};
+
+template<typename ET>
+struct TypeMapperFor<std::optional<ET>> : SingletonTypeMapperFor<StdOptionalTypeMapper<ET>> {};
+
+/**
+ * std::variant type mapper. The active alternative is stored inline after a one byte alternative index.
+ * An encoded alternative is read into the alternative with the same index when it can read it,
+ * or otherwise into the first alternative that can read it.
+ * A variant that is valueless by exception cannot be recreated by a reader, so it cannot be written, and an encoded valueless index fails to read.
+ */
+template<typename... Ts>
+class StdVariantTypeMapper : public PrimitiveTypeMapper
+{
+public:
+    static constexpr bool IsObjectType = false;
+    static constexpr bool IsReferenceType = false;
+    static constexpr size_t AlternativeCount = sizeof...(Ts);
+    static_assert(AlternativeCount > 0 && AlternativeCount < VariantTypeDescriptor::ValuelessIndex, "Unsupported number of variant alternatives.");
+
+    typedef std::variant<Ts...> VariantType;
+    typedef StdVariantTypeMapper<Ts...> ThisType;
+    typedef bool (*AlternativeReader)(VariantType &destination, const TypeDescriptorPtr &encoding, ReadStream *input);
+
+    static TypeMapperPtr uniqueInstance()
+    {
+        static auto singleton = std::make_shared<ThisType> ();
+        return singleton;
+    }
+
+    StdVariantTypeMapper()
+    {
+        name = typeDescriptorKindToString(TypeDescriptorKind::Variant);
+    }
+
+    virtual std::string getQualifiedName() const override
+    {
+        std::string qualifiedName = name + "<";
+        auto alternativeTypes = alternativeTypeMappers();
+        for(size_t i = 0; i < AlternativeCount; ++i)
+        {
+            if(i > 0)
+                qualifiedName += ", ";
+            qualifiedName += alternativeTypes[i]->getQualifiedName();
+        }
+        qualifiedName += ">";
+        return qualifiedName;
+    }
+
+    static std::array<TypeMapperPtr, AlternativeCount> alternativeTypeMappers()
+    {
+        return {typeMapperForType<Ts> ()...};
+    }
+
+    template<size_t I>
+    static bool readAlternative(VariantType &destination, const TypeDescriptorPtr &encoding, ReadStream *input)
+    {
+        typedef std::variant_alternative_t<I, VariantType> AlternativeType;
+        auto &value = destination.index() == I ? std::get<I> (destination) : destination.template emplace<I> ();
+        return typeMapperForType<AlternativeType> ()->readFieldWith(&value, encoding, input);
+    }
+
+    template<size_t... Is>
+    static const std::array<AlternativeReader, AlternativeCount> &alternativeReaders(std::index_sequence<Is...>)
+    {
+        static const std::array<AlternativeReader, AlternativeCount> readers = {&readAlternative<Is>...};
+        return readers;
+    }
+
+    static const std::array<AlternativeReader, AlternativeCount> &alternativeReaders()
+    {
+        return alternativeReaders(std::index_sequence_for<Ts...> ());
+    }
+
+    static size_t targetAlternativeIndexFor(const TypeDescriptorPtr &encoding, size_t sourceIndex)
+    {
+        auto targetTypeMappers = alternativeTypeMappers();
+        if(sourceIndex < AlternativeCount && targetTypeMappers[sourceIndex]->canReadFieldWithTypeDescriptor(encoding))
+            return sourceIndex;
+
+        for(size_t i = 0; i < AlternativeCount; ++i)
+        {
+            if(targetTypeMappers[i]->canReadFieldWithTypeDescriptor(encoding))
+                return i;
+        }
+
+        return AlternativeCount;
     }
 
     virtual void typeMapperDependenciesDo(const TypeMapperIterationBlock &aBlock) override
     {
-        typeMapperForType<ET> ()->withTypeMapperDependenciesDo(aBlock);
+        (typeMapperForType<Ts> ()->withTypeMapperDependenciesDo(aBlock), ...);
     }
 
-    virtual void objectReferencesInFieldDo(void *fieldPointer, std::unordered_map<void*, ObjectMapperPtr> *cache, const ObjectReferenceIterationBlock &aBlock) override
+    virtual void objectReferencesInFieldDo(void *fieldPointer, const ObjectReferenceIterationBlock &aBlock) override
     {
-        auto &vector = *reinterpret_cast<std::vector<ET>*> (fieldPointer);
-        auto elementType = typeMapperForType<ET> ();
-        for(auto &element : vector)
-            elementType->objectReferencesInFieldDo(&element, cache, aBlock);
+        auto &variant = *reinterpret_cast<VariantType*> (fieldPointer);
+        if(variant.valueless_by_exception())
+            return;
+
+        std::visit([&](auto &value) {
+            typeMapperForType<std::decay_t<decltype(value)>> ()->objectReferencesInFieldDo(&value, aBlock);
+        }, variant);
     }
 
     virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override
     {
-        auto &vector = *reinterpret_cast<std::vector<ET>*> (fieldPointer);
-        output->writeUInt32(uint32_t(vector.size()));
-        auto elementType = typeMapperForType<ET> ();
-        for(auto &element : vector)
-            elementType->writeFieldWith(&element, output);
+        auto &variant = *reinterpret_cast<VariantType*> (fieldPointer);
+
+        // std::visit also throws std::bad_variant_access for a valueless variant when the assertions are disabled.
+        assert(!variant.valueless_by_exception());
+        output->writeUInt8(uint8_t(variant.index()));
+        std::visit([&](auto &value) {
+            typeMapperForType<std::decay_t<decltype(value)>> ()->writeFieldWith(&value, output);
+        }, variant);
     }
 
     virtual void pushFieldDataIntoBinaryBlob(void *fieldPointer, BinaryBlobBuilder &binaryBlobBuilder) override
     {
-        auto &vector = *reinterpret_cast<std::vector<ET>*> (fieldPointer);
-        auto elementType = typeMapperForType<ET> ();
-        for(auto &element : vector)
-            elementType->pushFieldDataIntoBinaryBlob(&element, binaryBlobBuilder);
+        auto &variant = *reinterpret_cast<VariantType*> (fieldPointer);
+        if(variant.valueless_by_exception())
+            return;
+
+        std::visit([&](auto &value) {
+            typeMapperForType<std::decay_t<decltype(value)>> ()->pushFieldDataIntoBinaryBlob(&value, binaryBlobBuilder);
+        }, variant);
     }
 
     virtual bool canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const override
     {
-        switch(encoding->kind)
-        {
-        case TypeDescriptorKind::Array8:
-        case TypeDescriptorKind::Array16:
-        case TypeDescriptorKind::Array32:
-            {
-                auto targetTypeMapper = typeMapperForType<ET> ();
-                auto elementTypeDescriptor = std::static_pointer_cast<ArrayTypeDescriptor> (encoding)->element;
-                return targetTypeMapper->canReadFieldWithTypeDescriptor(elementTypeDescriptor);
-            }
-        default:
+        if(encoding->kind != TypeDescriptorKind::Variant)
             return false;
+
+        auto &sourceAlternatives = std::static_pointer_cast<VariantTypeDescriptor> (encoding)->alternatives;
+        for(size_t i = 0; i < sourceAlternatives.size(); ++i)
+        {
+            if(targetAlternativeIndexFor(sourceAlternatives[i], i) >= AlternativeCount)
+                return false;
         }
+
+        return true;
     }
 
     virtual bool readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override
     {
-        auto &destination = *reinterpret_cast<std::vector<ET>*> (fieldPointer);
+        if(fieldEncoding->kind != TypeDescriptorKind::Variant)
+            return false;
 
-        switch(fieldEncoding->kind)
-        {
-        case TypeDescriptorKind::Array8:
-            {
-                uint8_t count = 0;
-                if(!input->readUInt8(count))
-                    return false;
-                destination.resize(count);
-            }
-            break;
-        case TypeDescriptorKind::Array16:
-            {
-                uint16_t count = 0;
-                if(!input->readUInt16(count))
-                    return false;
-                destination.resize(count);
-            }
-            break;
-        case TypeDescriptorKind::Array32:
-            {
-                uint32_t count = 0;
-                if(!input->readUInt32(count))
-                    return false;
-                destination.resize(count);
-            }
-            break;
-        default:
+        auto &destination = *reinterpret_cast<VariantType*> (fieldPointer);
+        auto &sourceAlternatives = std::static_pointer_cast<VariantTypeDescriptor> (fieldEncoding)->alternatives;
+        uint8_t sourceIndex = 0;
+        if(!input->readUInt8(sourceIndex))
             return false;
-        }
 
-        auto targetTypeMapper = typeMapperForType<ET> ();
-        auto elementTypeDescriptor = std::static_pointer_cast<ArrayTypeDescriptor> (fieldEncoding)->element;
-        for(size_t i = 0; i < destination.size(); ++i)
+        // This also rejects the valueless index.
+        if(sourceIndex >= sourceAlternatives.size())
+            return false;
+
+        auto &alternativeEncoding = sourceAlternatives[sourceIndex];
+        auto targetIndex = targetAlternativeIndexFor(alternativeEncoding, sourceIndex);
+        if(targetIndex >= AlternativeCount)
+            return false;
+
+        return alternativeReaders()[targetIndex](destination, alternativeEncoding, input);
+    }
+
+    virtual TypeDescriptorPtr getOrCreateTypeDescriptor(TypeDescriptorContext *context) override
+    {
+        return context->getOrCreateVariantTypeDescriptor({context->getForTypeMapper(typeMapperForType<Ts> ())...});
+    }
+};
+
+template<typename... Ts>
+struct TypeMapperFor<std::variant<Ts...>> : SingletonTypeMapperFor<StdVariantTypeMapper<Ts...>> {};
+
+/**
+ * I am an accessor for an element of a std::pair or a std::tuple. The element offset is resolved at compile time by std::get.
+ */
+template<typename TT, size_t I>
+class TupleElementFieldAccessor : public FieldAccessor
+{
+public:
+    virtual void *getPointerForBasePointer(void *basePointer) override
+    {
+        return reinterpret_cast<void*> (&std::get<I> (*reinterpret_cast<TT*> (basePointer)));
+    }
+};
+
+/**
+ * I describe std::pair and std::tuple as anonymous inline structures, whose names are synthesized from their element types.
+ * The qualified names of the element types tell apart the C++ types that share an encoding, such as std::string and std::string_view.
+ */
+template<typename TT, typename... Ts>
+struct TupleStructureTypeMetadataFor
+{
+    typedef void type;
+
+    template<size_t... Is>
+    static FieldDescriptions getFieldsWithIndices(std::index_sequence<Is...>)
+    {
+        return {
+            FieldDescription(TT::fieldNameAt(Is), typeMapperForType<Ts> (), std::make_shared<TupleElementFieldAccessor<typename TT::TupleType, Is>> ())...
+        };
+    }
+
+    static FieldDescriptions getFields()
+    {
+        return getFieldsWithIndices(std::index_sequence_for<Ts...> ());
+    }
+
+    static std::string getTypeName()
+    {
+        std::string name = TT::TypeNamePrefix;
+        name += '<';
+        std::vector<TypeMapperPtr> elementTypes = {typeMapperForType<Ts> ()...};
+        for(size_t i = 0; i < elementTypes.size(); ++i)
         {
-            auto elementFieldPointer = &destination[i];
-            if(!targetTypeMapper->readFieldWith(elementFieldPointer, elementTypeDescriptor, input))
-                return false;
+            if(i > 0)
+                name += ", ";
+            name += elementTypes[i]->getQualifiedName();
         }
+        name += '>';
+        return name;
+    }
+};
 
-        return true;
+template<typename FT, typename ST>
+struct PairStructureTypeMetadataFor : TupleStructureTypeMetadataFor<PairStructureTypeMetadataFor<FT, ST>, FT, ST>
+{
+    typedef std::pair<FT, ST> TupleType;
+
+    static constexpr char const TypeNamePrefix[] = "std::pair";
+
+    static std::string fieldNameAt(size_t index)
+    {
+        return index == 0 ? "first" : "second";
     }
+};
 
-    virtual TypeDescriptorPtr getOrCreateTypeDescriptor(TypeDescriptorContext *context) override
+template<typename... Ts>
+struct StdTupleStructureTypeMetadataFor : TupleStructureTypeMetadataFor<StdTupleStructureTypeMetadataFor<Ts...>, Ts...>
+{
+    typedef std::tuple<Ts...> TupleType;
+
+    static constexpr char const TypeNamePrefix[] = "std::tuple";
+
+    static std::string fieldNameAt(size_t index)
     {
-        return context->getOrCreateArrayTypeDescriptor(TypeDescriptorKind::Array32, 
-            context->getForTypeMapper(typeMapperForType<ET> ())
-        );
+        return "element" + std::to_string(index);
     }
 };
 
-template<typename ET>
-struct TypeMapperFor<std::vector<ET>> : SingletonTypeMapperFor<StdVectorTypeMapper<ET>> {};
+template<typename FT, typename ST>
+struct StructureTypeMetadataFor<std::pair<FT, ST>> : PairStructureTypeMetadataFor<FT, ST> {};
+
+template<typename... Ts>
+struct StructureTypeMetadataFor<std::tuple<Ts...>> : StdTupleStructureTypeMetadataFor<Ts...> {};
 
 /**
  * std::(unordered_)set type mapper.
@@ -211,17 +1086,22 @@ public:
         name = typeDescriptorKindToString(TypeDescriptorKind::Set32);
     }
 
+    virtual std::string getQualifiedName() const override
+    {
+        return name + "<" + typeMapperForType<ElementType> ()->getQualifiedName() + ">";
+    }
+
     virtual void typeMapperDependenciesDo(const TypeMapperIterationBlock &aBlock) override
     {
         typeMapperForType<ElementType> ()->withTypeMapperDependenciesDo(aBlock);
     }
 
-    virtual void objectReferencesInFieldDo(void *fieldPointer, std::unordered_map<void*, ObjectMapperPtr> *cache, const ObjectReferenceIterationBlock &aBlock) override
+    virtual void objectReferencesInFieldDo(void *fieldPointer, const ObjectReferenceIterationBlock &aBlock) override
     {
         auto &set = *reinterpret_cast<ContainerType*> (fieldPointer);
         auto elementType = typeMapperForType<ElementType> ();
         for(auto &element : set)
-            elementType->objectReferencesInFieldDo(const_cast<void*> (static_cast<const void*> (&element)), cache, aBlock);
+            elementType->objectReferencesInFieldDo(const_cast<void*> (static_cast<const void*> (&element)), aBlock);
     }
 
     virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override
@@ -295,6 +1175,7 @@ public:
 
         auto targetTypeMapper = typeMapperForType<ElementType> ();
         auto elementTypeDescriptor = std::static_pointer_cast<SetTypeDescriptor> (fieldEncoding)->element;
+        destination.clear();
         for(size_t i = 0; i < elementCount; ++i)
         {
             ElementType readedElement;
@@ -348,21 +1229,26 @@ public:
         name = typeDescriptorKindToString(TypeDescriptorKind::Map32);
     }
 
+    virtual std::string getQualifiedName() const override
+    {
+        return name + "<" + typeMapperForType<KeyType> ()->getQualifiedName() + ", " + typeMapperForType<ValueType> ()->getQualifiedName() + ">";
+    }
+
     virtual void typeMapperDependenciesDo(const TypeMapperIterationBlock &aBlock) override
     {
         typeMapperForType<KeyType> ()->withTypeMapperDependenciesDo(aBlock);
         typeMapperForType<ValueType> ()->withTypeMapperDependenciesDo(aBlock);
     }
 
-    virtual void objectReferencesInFieldDo(void *fieldPointer, std::unordered_map<void*, ObjectMapperPtr> *cache, const ObjectReferenceIterationBlock &aBlock) override
+    virtual void objectReferencesInFieldDo(void *fieldPointer, const ObjectReferenceIterationBlock &aBlock) override
     {
         auto &map = *reinterpret_cast<ContainerType*> (fieldPointer);
         auto keyType = typeMapperForType<KeyType> ();
         auto valueType = typeMapperForType<ValueType> ();
         for(auto &element : map)
         {
-            keyType->objectReferencesInFieldDo(const_cast<void*> (static_cast<const void*> (&element.first)), cache, aBlock);
-            valueType->objectReferencesInFieldDo(&element.second, cache, aBlock);
+            keyType->objectReferencesInFieldDo(const_cast<void*> (static_cast<const void*> (&element.first)), aBlock);
+            valueType->objectReferencesInFieldDo(&element.second, aBlock);
         }
     }
 
@@ -450,6 +1336,7 @@ public:
         auto targetKeyTypeMapper = typeMapperForType<KeyType> ();
         auto targetValueTypeMapper = typeMapperForType<ValueType> ();
         auto mapTypeDescriptor = std::static_pointer_cast<MapTypeDescriptor> (fieldEncoding);
+        destination.clear();
         for(size_t i = 0; i < elementCount; ++i)
         {
             KeyType readedKey;
@@ -490,11 +1377,36 @@ public:
     virtual TypeMapperPtr getTypeMapper() const override;
     virtual void *getObjectBasePointer() override;
     virtual std::shared_ptr<void> asObjectSharedPointer() override;
+    virtual void *releaseObjectOwnership() override;
+    virtual bool restoreObjectOwnership() override;
 
     ValueTypePtr reference;
     TypeMapperPtr typeMapper;
 };
 
+/**
+ * I am the deleter of the deserialized shared objects that are exclusively ownable. I allow transferring their ownership into a std::unique_ptr.
+ */
+struct ReleasableObjectDeleter
+{
+    typedef void (*DestroyFunction)(void *object);
+
+    template<typename T>
+    static void destroyObjectOfType(void *object)
+    {
+        delete static_cast<T*> (object);
+    }
+
+    void operator()(void *object) const
+    {
+        if(!released)
+            destroy(object);
+    }
+
+    DestroyFunction destroy = nullptr;
+    bool released = false;
+};
+
 /**
  * I wrap a specific std::shared_ptr<> instance.
  */
@@ -516,28 +1428,17 @@ public:
         return std::make_shared<SharedObjectWrapper> (value, typeMapper);
     }
 
-    static ObjectMapperPtr makeFor(std::unordered_map<void *, ObjectMapperPtr> *cache, const ValueTypePtr &value)
-    {
-        if(!value)
-            return nullptr;
-
-        auto it = cache->find(value.get());
-        if(it != cache->end())
-            return it->second;
-
-        auto result = makeFor(value);
-        cache->insert({value.get(), result});
-        return result;
-    }
-
     static std::optional<ValueTypePtr> unwrapDeserializedRootObjectOrValue(const ObjectMapperPtr &deserializedRootObject)
     {
         if(!deserializedRootObject)
             return std::nullopt;
 
+        if(!deserializedRootObject->getTypeMapper()->isKindOf(typeMapperSingleton()))
+            return std::nullopt;
+
         return 
             std::reinterpret_pointer_cast<ValueType> (
-                std::static_pointer_cast<SharedObjectWrapper> (deserializedRootObject)->reference
+                std::static_pointer_cast<SharedObjectWrapper> (deserializedRootObject)->asObjectSharedPointer()
             );
     }
 };
@@ -563,7 +1464,11 @@ ObjectMapperPtr makeSharedObjectWrapperFor(const std::shared_ptr<T> &reference)
 template<typename T>
 ObjectMapperPtr makeNewSharedObject()
 {
-    return makeSharedObjectWrapperFor<T> (std::make_shared<T> ());
+    // Only the objects that may be moved into a std::unique_ptr need a separately allocated control block.
+    if(!typeMapperForType<T> ()->isExclusivelyOwnable())
+        return makeSharedObjectWrapperFor<T> (std::make_shared<T> ());
+
+    return makeSharedObjectWrapperFor<T> (std::shared_ptr<T> (new T(), ReleasableObjectDeleter{&ReleasableObjectDeleter::destroyObjectOfType<T>}));
 }
 
 /**
@@ -591,6 +1496,11 @@ public:
         name = typeDescriptorKindToString(TypeDescriptorKind::TypedObject);
     }
 
+    virtual std::string getQualifiedName() const override
+    {
+        return name + "<" + typeMapperForType<ObjectType> ()->getQualifiedName() + ">";
+    }
+
     virtual bool isSerializationDependencyType() const override
     {
         return true;
@@ -633,15 +1543,16 @@ public:
             return true;
 
         // Check the validity of the cast.
-        if(fieldEncoding->kind == TypeDescriptorKind::Object)
-        {
-            // TODO: Check for a super type here.
-            if(instance->getTypeMapper() != typeMapperForType<ObjectType> ())
-                return true;
-        }
+        if(fieldEncoding->kind == TypeDescriptorKind::Object && !instance->getTypeMapper()->isKindOf(typeMapperForType<ObjectType> ()))
+            return true;
+
+        // An object that was moved into a std::unique_ptr cannot be shared anymore.
+        auto object = instance->asObjectSharedPointer();
+        if(!object)
+            return false;
 
         // Cast the instance.
-        *destination = std::reinterpret_pointer_cast<ObjectType> (instance->asObjectSharedPointer());
+        *destination = std::reinterpret_pointer_cast<ObjectType> (object);
         return true;
     }
 
@@ -655,20 +1566,159 @@ public:
         return context->getOrCreateForTypedObjectReference(typeMapperForType<ObjectType> ());
     }
 
-    virtual void objectReferencesInFieldDo(void *baseFieldPointer, std::unordered_map<void*, ObjectMapperPtr> *cache, const ObjectReferenceIterationBlock &aBlock) override
+    virtual void objectReferencesInFieldDo(void *baseFieldPointer, const ObjectReferenceIterationBlock &aBlock) override
     {
-        auto referencePointer = reinterpret_cast<ObjectTypePtr*> (baseFieldPointer);
-        if(!*referencePointer)
+        auto &reference = *reinterpret_cast<ObjectTypePtr*> (baseFieldPointer);
+        if(!reference)
             return;
 
-        auto wrapper = SpecificSharedObjectWrapper<ObjectType>::makeFor(cache, *referencePointer);
-        aBlock(wrapper);
+        aBlock(ObjectHandle{reference->getCoalTypeMapper().get(), reference.get()});
     }
 };
 
 template<typename T>
 struct TypeMapperFor<std::shared_ptr<T>> : SingletonTypeMapperFor<SharedPtrTypeMapperFor<T>> {};
 
+/**
+ * std::unique_ptr reference type mapper. A deserialized object is moved into the exclusive ownership of the field,
+ * and the reading fails when the same object is also referenced by another owner.
+ */
+template<typename OT>
+class UniquePtrTypeMapperFor : public SharedPtrTypeMapperFor<OT>
+{
+public:
+    typedef OT ObjectType;
+    typedef std::unique_ptr<OT> ObjectTypePtr;
+    typedef UniquePtrTypeMapperFor<OT> ThisType;
+
+    static TypeMapperPtr uniqueInstance()
+    {
+        static auto singleton = std::make_shared<ThisType> ();
+        return singleton;
+    }
+
+    virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override
+    {
+        auto objectPointer = reinterpret_cast<ObjectTypePtr*> (fieldPointer);
+        output->writeObjectPointerAsReference(objectPointer->get());
+    }
+
+    virtual bool readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override
+    {
+        ObjectMapperPtr instance;
+        if(!input->readInstanceReference(instance))
+            return false;
+
+        // An object that is read again in delta mode keeps the child that it already owns.
+        auto destination = reinterpret_cast<ObjectTypePtr*> (fieldPointer);
+        auto ownershipTable = input->getExclusiveOwnershipTable();
+        if(instance && instance->getObjectBasePointer() == destination->get())
+            return !ownershipTable || ownershipTable->keepOwnership(destination->get(), fieldPointer);
+
+        // A child that is given up stays in the baseline, because it may be moved into another owner.
+        if(ownershipTable && *destination && ownershipTable->restoreOwnershipOf(destination->get(), fieldPointer))
+            destination->release();
+        destination->reset();
+        if(!instance)
+            return true;
+
+        // Check the validity of the cast.
+        if(fieldEncoding->kind == TypeDescriptorKind::Object && !instance->getTypeMapper()->isKindOf(typeMapperForType<ObjectType> ()))
+            return false;
+
+        // Take the ownership of the instance.
+        auto object = ownershipTable
+            ? ownershipTable->moveOwnershipInto(instance, fieldPointer, &releaseOwnerField)
+            : instance->releaseObjectOwnership();
+        if(!object)
+            return false;
+
+        destination->reset(reinterpret_cast<ObjectType*> (object));
+        return true;
+    }
+
+    static void releaseOwnerField(void *fieldPointer)
+    {
+        reinterpret_cast<ObjectTypePtr*> (fieldPointer)->release();
+    }
+
+    virtual void typeMapperDependenciesDo(const TypeMapperIterationBlock &aBlock) override
+    {
+        // The registry of a reader is built before any instance is made.
+        auto objectTypeMapper = typeMapperForType<ObjectType> ();
+        objectTypeMapper->setExclusivelyOwnable();
+        aBlock(objectTypeMapper);
+    }
+
+    virtual void objectReferencesInFieldDo(void *baseFieldPointer, const ObjectReferenceIterationBlock &aBlock) override
+    {
+        auto &reference = *reinterpret_cast<ObjectTypePtr*> (baseFieldPointer);
+        if(!reference)
+            return;
+
+        aBlock(ObjectHandle{reference->getCoalTypeMapper().get(), reference.get()});
+    }
+};
+
+template<typename T>
+struct TypeMapperFor<std::unique_ptr<T>> : SingletonTypeMapperFor<UniquePtrTypeMapperFor<T>> {};
+
+/**
+ * Raw pointer reference type mapper. The pointer is not owning, so the referenced object must be kept alive
+ * by another owner, such as a std::shared_ptr or a std::unique_ptr field, in the deserialized object graph.
+ */
+template<typename OT>
+class RawPointerTypeMapperFor : public SharedPtrTypeMapperFor<OT>
+{
+public:
+    typedef OT ObjectType;
+    typedef OT *ObjectTypePtr;
+    typedef RawPointerTypeMapperFor<OT> ThisType;
+
+    static TypeMapperPtr uniqueInstance()
+    {
+        static auto singleton = std::make_shared<ThisType> ();
+        return singleton;
+    }
+
+    virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override
+    {
+        auto objectPointer = reinterpret_cast<ObjectTypePtr*> (fieldPointer);
+        output->writeObjectPointerAsReference(*objectPointer);
+    }
+
+    virtual bool readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override
+    {
+        ObjectMapperPtr instance;
+        if(!input->readInstanceReference(instance))
+            return false;
+
+        auto destination = reinterpret_cast<ObjectTypePtr*> (fieldPointer);
+        *destination = nullptr;
+        if(!instance)
+            return true;
+
+        // Check the validity of the cast.
+        if(fieldEncoding->kind == TypeDescriptorKind::Object && !instance->getTypeMapper()->isKindOf(typeMapperForType<ObjectType> ()))
+            return false;
+
+        *destination = reinterpret_cast<ObjectType*> (instance->getObjectBasePointer());
+        return true;
+    }
+
+    virtual void objectReferencesInFieldDo(void *baseFieldPointer, const ObjectReferenceIterationBlock &aBlock) override
+    {
+        auto reference = *reinterpret_cast<ObjectTypePtr*> (baseFieldPointer);
+        if(!reference)
+            return;
+
+        aBlock(ObjectHandle{reference->getCoalTypeMapper().get(), reference});
+    }
+};
+
+template<typename T>
+struct TypeMapperFor<T*, typename std::enable_if<TypeMapperFor<T>::IsObjectType>::type> : SingletonTypeMapperFor<RawPointerTypeMapperFor<T>> {};
+
 template<typename T>
 struct ClassTypeMetadataFor<T, typename std::enable_if< std::is_base_of<SerializableSharedObjectClassTag, T>::value >::type>
 {
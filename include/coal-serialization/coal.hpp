@@ -38,6 +38,7 @@
 #include <unordered_set>
 #include <algorithm>
 #include <array>
+#include <atomic>
 
 #include <mutex> // for std::once_flag
 #include <functional>
@@ -47,7 +48,77 @@ namespace coal
 
 static constexpr uint32_t CoalMagicNumber = 0x4C414F43;
 static constexpr uint8_t CoalVersionMajor = 1;
-static constexpr uint8_t CoalVersionMinor = 0;
+static constexpr uint8_t CoalVersionMinor = 1;
+
+/**
+ * The header carries a fingerprint of the value type layouts and the cluster descriptions, and the cluster instance counts are stored after the cluster descriptions.
+ */
+static constexpr uint16_t CoalHeaderFlagSchemaFingerprint = 1 << 0;
+
+/**
+ * The value type layouts and cluster descriptions are omitted, because the reader already has the schema with the fingerprint that is present in the header.
+ */
+static constexpr uint16_t CoalHeaderFlagSchemaElided = 1 << 1;
+
+/**
+ * The blob and the cluster instances are stored as sequences of compressed chunks. The codec is stored in a byte after the header.
+ */
+static constexpr uint16_t CoalHeaderFlagCompressedSections = 1 << 2;
+
+/**
+ * The rest of the header with the blob, the schema, and the instances with the trailer are stored as three sections.
+ * Each section is preceded by its size as a uint32, and followed by a CRC32C checksum of the data since the previous checksum,
+ * so that a reader verifies a section before parsing it.
+ */
+static constexpr uint16_t CoalHeaderFlagSectionChecksums = 1 << 3;
+
+/**
+ * A CRC32C checksum of the whole message is stored after the trailer.
+ */
+static constexpr uint16_t CoalHeaderFlagTrailerChecksum = 1 << 4;
+
+/**
+ * The trailer holds a list of named roots instead of a single root.
+ */
+static constexpr uint16_t CoalHeaderFlagMultipleRoots = 1 << 5;
+
+/**
+ * The message is a delta against the previous message. The baseline blob size and instance count are stored after the header.
+ * The blob only has the data appended to the baseline blob, the instances are the new ones, and a list of the baseline
+ * instances whose content is replaced is stored for each cluster after the cluster instance counts.
+ */
+static constexpr uint16_t CoalHeaderFlagDelta = 1 << 6;
+
+/**
+ * A 64-bit stable identifier of each written instance is stored after the cluster instance counts.
+ */
+static constexpr uint16_t CoalHeaderFlagStableObjectIds = 1 << 7;
+
+/**
+ * The schema only has the value type layouts and cluster descriptions that are appended to a schema that the reader already has.
+ * The fingerprint of that schema is stored after the schema size.
+ */
+static constexpr uint16_t CoalHeaderFlagSchemaExtension = 1 << 8;
+
+static constexpr uint16_t CoalHeaderSupportedFlags = CoalHeaderFlagSchemaFingerprint | CoalHeaderFlagSchemaElided | CoalHeaderFlagCompressedSections |
+    CoalHeaderFlagSectionChecksums | CoalHeaderFlagTrailerChecksum | CoalHeaderFlagMultipleRoots | CoalHeaderFlagDelta |
+    CoalHeaderFlagStableObjectIds | CoalHeaderFlagSchemaExtension;
+
+/**
+ * The size of the part of the header that is present in every message.
+ */
+static constexpr size_t CoalFixedHeaderSize = 24;
+
+/**
+ * The codec that is used for compressing the sections of a coal file.
+ */
+enum class CompressionCodec : uint8_t
+{
+    None = 0,
+    LZ = 1,
+    Zlib = 2,
+    Zstd = 3,
+};
 
 class TypeDescriptor;
 typedef std::shared_ptr<TypeDescriptor> TypeDescriptorPtr;
@@ -69,6 +140,13 @@ typedef std::weak_ptr<ObjectMaterializationTypeMapper> ObjectMaterializationType
 class ObjectMapper;
 typedef std::shared_ptr<ObjectMapper> ObjectMapperPtr;
 
+struct ObjectHandle;
+class ObjectHandleTable;
+struct EncodedInstance;
+
+struct DeserializationSchema;
+typedef std::shared_ptr<DeserializationSchema> DeserializationSchemaPtr;
+
 class SerializationCluster;
 typedef std::shared_ptr<SerializationCluster> SerializationClusterPtr;
 typedef std::weak_ptr<SerializationCluster> SerializationClusterWeakPtr;
@@ -78,6 +156,7 @@ typedef std::shared_ptr<FieldAccessor> FieldAccessorPtr;
 
 class WriteStream;
 class ReadStream;
+class Crc32cWriteStream;
 
 /**
  * The kind of a coal type descriptor.
@@ -141,10 +220,36 @@ enum class TypeDescriptorKind : uint8_t
     Map8 = 0x89,
     Map16 = 0x8A,
     Map32 = 0x8B,
+    Optional = 0x8C,
+    Variant = 0x8D,
+    Enum = 0x8E,
 };
 
 const char *typeDescriptorKindToString(TypeDescriptorKind kind);
 
+/**
+ * I compute a 64 bits FNV-1a hash of some bytes, used for fingerprinting schemas.
+ */
+uint64_t fingerprintForBytes(const uint8_t *bytes, size_t size, uint64_t seed = 0xcbf29ce484222325ull);
+
+/**
+ * I convert a single precision float into a half precision float, rounding to the nearest even value.
+ */
+uint16_t float32ToFloat16(float value);
+
+/**
+ * I convert a half precision float into a single precision float.
+ */
+float float16ToFloat32(uint16_t value);
+
+/**
+ * I convert arrays between single and half precision floats.
+ * I use the F16C or the NEON instructions when they are available, and the scalar conversions otherwise, with the same results.
+ */
+void convertFloat32ToFloat16(const float *source, uint16_t *destination, size_t count);
+void convertFloat16ToFloat32(const uint16_t *source, float *destination, size_t count);
+bool isFloat16ConversionHardwareAccelerated();
+
 /**
  * Binary blob builder
  */
@@ -161,6 +266,8 @@ public:
     const uint8_t *getData() const;
     size_t getDataSize() const;
 
+    void clear();
+
 private:
     static constexpr size_t HashTableCapacity = 4096;
     static uint32_t hashForBytes(const uint8_t *bytes, size_t dataSize);
@@ -169,6 +276,66 @@ private:
     std::vector<uint8_t> data;
 };
 
+/**
+ * String pool.
+ * I share a single immutable string among all of the string fields that are read from the same blob range.
+ */
+class StringPool
+{
+public:
+    std::shared_ptr<const std::string> getOrCreate(uint32_t offset, const uint8_t *data, size_t dataSize);
+    void clear();
+
+    size_t size() const
+    {
+        return strings.size();
+    }
+
+private:
+    std::unordered_map<uint64_t, std::shared_ptr<const std::string>> strings;
+};
+
+/**
+ * Exclusive ownership table.
+ * I record the std::unique_ptr field that owns each object of a delta baseline, so that a later message can move the object into another owner.
+ */
+class ExclusiveOwnershipTable
+{
+public:
+    typedef void (*ReleaseFunction)(void *ownerField);
+
+    /**
+     * I take the ownership of the object of the instance from its wrapper or from its previous owner field.
+     * I return nullptr when the object already has an owner in the current message, or when it cannot be exclusively owned.
+     */
+    void *moveOwnershipInto(const ObjectMapperPtr &instance, void *ownerField, ReleaseFunction releaseOwnerField);
+
+    /**
+     * I record that the owner field still owns the object in the current message.
+     */
+    bool keepOwnership(void *object, void *ownerField);
+
+    /**
+     * I give the ownership of an object back to its wrapper, which keeps it alive in the baseline.
+     */
+    bool restoreOwnershipOf(void *object, void *ownerField);
+
+    void beginMessage();
+    void clear();
+
+private:
+    struct Entry
+    {
+        ObjectMapperPtr instance;
+        void *ownerField = nullptr;
+        ReleaseFunction releaseOwnerField = nullptr;
+        uint64_t generation = 0;
+    };
+
+    std::unordered_map<void*, Entry> entries;
+    uint64_t generation = 0;
+};
+
 /**
  * Interface for a write stream.
  */
@@ -194,17 +361,28 @@ public:
     void writeUTF8_32_8(const std::string &string);
     void writeUTF8_32_16(const std::string &string);
     void writeUTF8_32_32(const std::string &string);
+    void writeBinary_32_32(const uint8_t *bytes, size_t size);
 
+    void setBinaryBlob(const BinaryBlobBuilder *theBlob);
     void setTypeDescriptorContext(TypeDescriptorContext *context);
     void writeTypeDescriptorForTypeMapper(const TypeMapperPtr &typeMapper);
-    void setObjectPointerToIndexMap(const std::unordered_map<const void*, uint32_t> *map);
+    void setObjectHandleTable(const ObjectHandleTable *table);
 
     void writeObjectPointerAsReference(const void *pointer);
 
+    /**
+     * I record the blob offsets and the references that are written, as relocations of the data of the encoded instance,
+     * instead of resolving them. The written bytes must be appended to the data of the encoded instance.
+     */
+    void setEncodedInstanceRecorder(EncodedInstance *recorder);
+
 private:
+    void writeBlobOffsetForBytes(const uint8_t *bytes, size_t dataSize);
+
+    EncodedInstance *encodedInstanceRecorder = nullptr;
     const BinaryBlobBuilder *blob = nullptr;
     TypeDescriptorContext *typeDescriptorContext = nullptr;
-    const std::unordered_map<const void*, uint32_t> *objectPointerToIndexMap = nullptr;
+    const ObjectHandleTable *objectHandleTable = nullptr;
 };
 
 /**
@@ -218,6 +396,11 @@ public:
     virtual bool readBytes(uint8_t *buffer, size_t size) = 0;
     virtual bool skipBytes(size_t size) = 0;
 
+    /**
+     * I return the address of the next bytes without consuming them, when they are contiguous in memory. I return nullptr otherwise.
+     */
+    virtual const uint8_t *peekContiguousBytes(size_t size);
+
     bool readUInt8(uint8_t &destination);
     bool readUInt16(uint16_t &destination);
     bool readUInt32(uint32_t &destination);
@@ -233,20 +416,59 @@ public:
     bool readUTF8_32_16(std::string &output);
     bool readUTF8_32_32(std::string &output);
 
+    /**
+     * I read a binary blob range, whose data remains owned by the blob.
+     */
+    bool readBinary_32_8(const uint8_t *&data, size_t &size);
+    bool readBinary_32_16(const uint8_t *&data, size_t &size);
+    bool readBinary_32_32(const uint8_t *&data, size_t &size);
+
+    /**
+     * I read a string that is shared with the other strings in the same blob range when a string pool is set.
+     */
+    bool readSharedUTF8_32_8(std::shared_ptr<const std::string> &output);
+    bool readSharedUTF8_32_16(std::shared_ptr<const std::string> &output);
+    bool readSharedUTF8_32_32(std::shared_ptr<const std::string> &output);
+
     bool readTypeDescriptor(TypeDescriptorPtr &typeDescriptor);
 
     void setTypeDescriptorContext(TypeDescriptorContext *context);
     void setBinaryBlob(const uint8_t *data, size_t size);
+    void setStringPool(StringPool *pool);
+
+    /**
+     * I return the end of the furthest blob range that was read since the blob was set.
+     */
+    size_t getBinaryBlobReadEnd() const;
+
+    /**
+     * I tell whether the values can be read as views into the blob, which must then outlive them.
+     */
+    void setBinaryBlobViewsEnabled(bool enabled);
+    bool areBinaryBlobViewsEnabled() const;
 
     void setInstances(const std::vector<ObjectMapperPtr> *theInstances);
 
+    /**
+     * I set the table that tracks the exclusive owners across delta messages. Without it, an object can only be moved once from its wrapper.
+     */
+    void setExclusiveOwnershipTable(ExclusiveOwnershipTable *table);
+    ExclusiveOwnershipTable *getExclusiveOwnershipTable() const;
+
     bool readInstanceReference(ObjectMapperPtr &destination);
 
 private:
-    size_t binaryBlobSize;
-    const uint8_t *binaryBlobData;
+    bool getBinaryBlobRange(uint32_t offset, size_t size, const uint8_t *&data);
+    void makeSharedString(const uint8_t *data, size_t size, std::shared_ptr<const std::string> &output);
+
+    size_t binaryBlobSize = 0;
+    const uint8_t *binaryBlobData = nullptr;
+    size_t binaryBlobReadEnd = 0;
+    StringPool *stringPool = nullptr;
+    bool binaryBlobViewsEnabled = true;
     TypeDescriptorContext *typeDescriptorContext = nullptr;
     const std::vector<ObjectMapperPtr> *instances = nullptr;
+    ExclusiveOwnershipTable *exclusiveOwnershipTable = nullptr;
 };
 
 /**
@@ -273,6 +495,14 @@ public:
 
     virtual bool readBytes(uint8_t *buffer, size_t size) override;
     virtual bool skipBytes(size_t size) override;
+    virtual const uint8_t *peekContiguousBytes(size_t size) override;
+
+    /**
+     * I start reading some other data, while keeping the blob and the type descriptor context that are set.
+     */
+    void reset(const uint8_t *newData, size_t newDataSize);
+
+    size_t getRemainingSize() const;
 
 private:
     size_t position = 0;
@@ -313,7 +543,6 @@ public:
 class FixedArrayTypeDescriptor : public TypeDescriptor
 {
 public:
-
     virtual void writeDescriptionWith(WriteStream *output) override;
     virtual bool skipDataWith(ReadStream *input) override;
 
@@ -358,6 +587,79 @@ public:
     TypeDescriptorPtr value;
 };
 
+/**
+ * Optional type descriptor. The value is prefixed by a one byte presence tag.
+ */
+class OptionalTypeDescriptor : public TypeDescriptor
+{
+public:
+    virtual void writeDescriptionWith(WriteStream *output) override;
+    virtual bool skipDataWith(ReadStream *input) override;
+
+    TypeDescriptorPtr element;
+};
+
+/**
+ * Variant type descriptor. The value is prefixed by a one byte alternative index, where 0xFF is reserved for a valueless variant, which is never written.
+ */
+class VariantTypeDescriptor : public TypeDescriptor
+{
+public:
+    static constexpr uint8_t ValuelessIndex = 0xFF;
+
+    virtual void writeDescriptionWith(WriteStream *output) override;
+    virtual bool skipDataWith(ReadStream *input) override;
+
+    std::vector<TypeDescriptorPtr> alternatives;
+};
+
+/**
+ * Enumerator description.
+ */
+struct EnumeratorDescription
+{
+    EnumeratorDescription() = default;
+
+    template<typename ET>
+    EnumeratorDescription(const std::string &initialName, ET initialValue)
+        : name(initialName), value(int64_t(initialValue)) {}
+
+    bool operator<(const EnumeratorDescription &other) const
+    {
+        return name < other.name || (name == other.name && value < other.value);
+    }
+
+    std::string name;
+    int64_t value = 0;
+};
+
+typedef std::vector<EnumeratorDescription> EnumeratorDescriptions;
+
+/**
+ * Enum type descriptor. The value is encoded with its underlying integer encoding, and the enumerator names are
+ * part of the description, so that a reader can remap the values of renumbered enumerators.
+ */
+class EnumTypeDescriptor : public TypeDescriptor
+{
+public:
+    typedef std::unordered_map<int64_t, int64_t> ValueRemapTable;
+
+    virtual void writeDescriptionWith(WriteStream *output) override;
+    virtual bool skipDataWith(ReadStream *input) override;
+
+    /**
+     * I map the encoded enumerator values into the values of the enumerators with the same names in the target enum.
+     * I am computed once per target type, when resolving the schema.
+     */
+    const ValueRemapTable &getValueRemapTableFor(const TypeMapper *targetTypeMapper, const EnumeratorDescriptions &targetEnumerators);
+
+    TypeDescriptorPtr underlying;
+    EnumeratorDescriptions enumerators;
+
+private:
+    std::unordered_map<const TypeMapper*, ValueRemapTable> valueRemapTables;
+};
+
 /**
  * Structure type descriptor
  */
@@ -383,29 +685,45 @@ public:
     uint32_t getValueTypeCount();
     TypeDescriptorPtr addValueType(const TypeMapperPtr &mapper);
 
-    void pushDataIntoBinaryBlob(BinaryBlobBuilder &binaryBlobBuilder);
-    void writeValueTypeLayoutsWith(WriteStream *output);
+    void pushDataIntoBinaryBlob(BinaryBlobBuilder &binaryBlobBuilder, uint32_t firstValueTypeIndex = 0);
+    void writeValueTypeLayoutsWith(WriteStream *output, uint32_t firstValueTypeIndex = 0);
     bool readTypeDescriptorWith(TypeDescriptorPtr &descriptor, ReadStream *input);
     void addObjectTypeMapper(const TypeMapperPtr &typeMapper);
+    void clear();
 
     TypeDescriptorPtr getOrCreateForTypedObjectReference(const TypeMapperPtr &objectType);
+    TypeDescriptorPtr getOrCreateFixedArrayTypeDescriptor(uint32_t size, const TypeDescriptorPtr &elementType);
     TypeDescriptorPtr getOrCreateArrayTypeDescriptor(TypeDescriptorKind kind, const TypeDescriptorPtr &elementType);
     TypeDescriptorPtr getOrCreateSetTypeDescriptor(TypeDescriptorKind kind, const TypeDescriptorPtr &elementType);
     TypeDescriptorPtr getOrCreateMapTypeDescriptor(TypeDescriptorKind kind, const TypeDescriptorPtr &keyType, const TypeDescriptorPtr &valueType);
+    TypeDescriptorPtr getOrCreateOptionalTypeDescriptor(const TypeDescriptorPtr &elementType);
+    TypeDescriptorPtr getOrCreateVariantTypeDescriptor(const std::vector<TypeDescriptorPtr> &alternativeTypes);
+    TypeDescriptorPtr getOrCreateEnumTypeDescriptor(const TypeDescriptorPtr &underlyingType, const EnumeratorDescriptions &enumerators);
+
+    /**
+     * I add a type whose description references strings in the binary blob, such as the enumerator names.
+     */
+    void addSchemaDataType(const TypeMapperPtr &mapper);
 
 private:
     std::array<TypeDescriptorPtr, uint8_t(TypeDescriptorKind::PrimitiveTypeDescriptorCount)> primitiveTypeDescriptors;
 
     std::vector<TypeMapperPtr> valueTypes;
     std::vector<TypeDescriptorPtr> valueTypeDescriptors;
+    std::vector<TypeMapperPtr> schemaDataTypes;
+    std::unordered_set<TypeMapperPtr> schemaDataTypeSet;
 
     std::vector<TypeMapperPtr> clusterTypes;
     std::unordered_map<TypeMapperPtr, uint32_t> objectTypeToClusterIndexMap;
     std::unordered_map<TypeMapperPtr, TypeDescriptorPtr> mapperToDescriptorMap;
     std::unordered_map<TypeMapperPtr, TypeDescriptorPtr> typedObjectReferenceCache;
+    std::map<std::pair<uint32_t, TypeDescriptorPtr>, TypeDescriptorPtr> fixedArrayTypeDescriptorCache;
     std::map<std::pair<TypeDescriptorKind, TypeDescriptorPtr>, TypeDescriptorPtr> arrayTypeDescriptorCache;
     std::map<std::pair<TypeDescriptorKind, TypeDescriptorPtr>, TypeDescriptorPtr> setTypeDescriptorCache;
     std::map<std::pair<TypeDescriptorKind, std::pair<TypeDescriptorPtr, TypeDescriptorPtr>>, TypeDescriptorPtr> mapTypeDescriptorCache;
+    std::map<TypeDescriptorPtr, TypeDescriptorPtr> optionalTypeDescriptorCache;
+    std::map<std::vector<TypeDescriptorPtr>, TypeDescriptorPtr> variantTypeDescriptorCache;
+    std::map<std::pair<TypeDescriptorPtr, EnumeratorDescriptions>, TypeDescriptorPtr> enumTypeDescriptorCache;
 };
 
 /**
@@ -419,6 +737,9 @@ struct FieldDescription
     template<typename CT, typename MT>
     FieldDescription(const std::string &initialName, MT CT::*fieldPointer);
 
+    template<typename CT, typename MT>
+    FieldDescription(const std::string &initialName, MT CT::*fieldPointer, const TypeMapperPtr &encodingTypeMapper);
+
     std::string name;
     TypeMapperWeakPtr typeMapper;
     FieldAccessorPtr accessor;
@@ -442,8 +763,87 @@ struct MaterializationFieldDescription
     bool readDescriptionWith(ReadStream *input);
 };
 
+/**
+ * Object handle.
+ * I am a lightweight non-refcounted description of an object that is traced by the serializer.
+ */
+struct ObjectHandle
+{
+    TypeMapper *typeMapper = nullptr;
+    void *basePointer = nullptr;
+    SerializationCluster *cluster = nullptr;
+    EncodedInstance *encodedInstance = nullptr;
+    uint32_t instanceIndex = 0;
+};
+
+/**
+ * Encoded instance.
+ * I am the encoding of an instance whose blob offsets and references are relocated when I am written, so that I can be reused by several serializations.
+ */
+struct EncodedInstance
+{
+    TypeMapper *typeMapper = nullptr;
+    uint64_t dirtyGeneration = 0;
+    uint64_t usageGeneration = 0;
+    std::vector<uint8_t> data;
+    std::vector<std::pair<size_t, std::string>> blobRelocations;
+    std::vector<std::pair<size_t, const void*>> referenceRelocations;
+    std::vector<ObjectHandle> references;
+};
+
+/**
+ * Object handle arena.
+ * I am a bump allocator for the object handles of a serialization. My chunks are retained when I am reset.
+ */
+class ObjectHandleArena
+{
+public:
+    ObjectHandle *newHandle(TypeMapper *typeMapper, void *basePointer);
+    void reset();
+
+private:
+    static constexpr size_t ChunkCapacity = 4096;
+
+    std::vector<std::unique_ptr<ObjectHandle[]>> chunks;
+    size_t activeChunkCount = 0;
+    size_t nextChunkOffset = 0;
+};
+
+/**
+ * Object handle table.
+ * I am an open addressing hash table that maps an object base pointer into its object handle.
+ */
+class ObjectHandleTable
+{
+public:
+    ObjectHandle *find(const void *basePointer) const;
+    ObjectHandle *&findOrInsert(const void *basePointer);
+    void clear();
+
+    size_t size() const
+    {
+        return count;
+    }
+
+private:
+    struct Entry
+    {
+        const void *key = nullptr;
+        ObjectHandle *handle = nullptr;
+    };
+
+    static constexpr size_t InitialCapacity = 1024;
+    static size_t hashForPointer(const void *pointer);
+
+    size_t indexForKey(const void *basePointer) const;
+    void grow();
+
+    std::vector<Entry> entries;
+    size_t count = 0;
+};
+
 typedef std::function<void (const TypeMapperPtr &)> TypeMapperIterationBlock;
-typedef std::function<void (const ObjectMapperPtr &)> ObjectReferenceIterationBlock;
+typedef std::function<void (const ObjectHandle &)> ObjectReferenceIterationBlock;
 
 /**
  * Type mapper interface.
@@ -462,6 +862,11 @@ public:
 
     virtual const std::string &getName() const = 0;
 
+    /**
+     * I return my name qualified with the names of my element types, which tells apart the different instantiations of the same generic type mapper.
+     */
+    virtual std::string getQualifiedName() const;
+
     virtual void pushDataIntoBinaryBlob(BinaryBlobBuilder &binaryBlobBuilder);
     virtual TypeMapperPtr getResolvedType() const;
     virtual uint16_t getFieldCount() const;
@@ -489,11 +894,33 @@ public:
     virtual void addSubtype(const TypeMapperPtr &subtype);
     virtual void subtypesDo(const TypeMapperIterationBlock &aBlock);
 
+    /**
+     * I tell whether I am the specified type or one of its subtypes.
+     */
+    bool isKindOf(const TypeMapperPtr &expectedType) const;
+
+    /**
+     * I tell whether my instances or those of one of my super types may be moved into a std::unique_ptr.
+     * Only those instances are allocated with a releasable deleter when they are deserialized.
+     */
+    bool isExclusivelyOwnable() const;
+    void setExclusivelyOwnable();
+
     virtual void typeMapperDependenciesDo(const TypeMapperIterationBlock &aBlock);
     virtual void withTypeMapperDependenciesDo(const TypeMapperIterationBlock &aBlock);
 
-    virtual void objectReferencesInInstanceDo(void *instancePointer, std::unordered_map<void*, ObjectMapperPtr> *cache, const ObjectReferenceIterationBlock &aBlock);
-    virtual void objectReferencesInFieldDo(void *fieldPointer, std::unordered_map<void*, ObjectMapperPtr> *cache, const ObjectReferenceIterationBlock &aBlock);
+    virtual void objectReferencesInInstanceDo(void *instancePointer, const ObjectReferenceIterationBlock &aBlock);
+    virtual void objectReferencesInFieldDo(void *fieldPointer, const ObjectReferenceIterationBlock &aBlock);
+
+    virtual uint64_t getDirtyGenerationOfInstance(void *instancePointer);
+
+    /**
+     * I return an identifier of the instance that no other instance ever has, even at the same address, or zero when I cannot tell.
+     */
+    virtual uint64_t getIdentityOfInstance(void *instancePointer);
+
+private:
+    std::atomic<bool> exclusivelyOwnable = false;
 };
 
 /**
@@ -509,6 +936,16 @@ public:
     virtual void *getObjectBasePointer() = 0;
     
     virtual std::shared_ptr<void> asObjectSharedPointer();
+
+    /**
+     * I transfer the ownership of the object into the caller, returning nullptr when the object cannot be exclusively owned.
+     */
+    virtual void *releaseObjectOwnership();
+
+    /**
+     * I take back the ownership of an object that was released, returning false when it was not released.
+     */
+    virtual bool restoreObjectOwnership();
 };
 
 /**
@@ -522,22 +959,34 @@ public:
 
     virtual TypeMapperPtr getTypeMapperWithName(const std::string &name);
 
+    /**
+     * I tell whether a name read from a schema designates several aggregate types, in which case its data cannot be read.
+     */
+    virtual bool isAmbiguousTypeName(const std::string &name) const;
+
     static TypeMapperRegistryPtr getOrCreateForTransitiveClosureOf(const TypeMapperPtr &rootTypeMapper);
+    static TypeMapperRegistryPtr getOrCreateForTransitiveClosureOfAll(const std::vector<TypeMapperPtr> &rootTypeMappers);
 };
 
 /**
  * Transitive closure type mapper registry
  * I am a type mapper registry that is built by using the transitive closure that starts with some specified types.
+ * A synthesized name that is not found, such as "RootValueBox<Int32>" or "std::pair<Int32, Int32>", is looked up without its qualification
+ * when a single aggregate type has that generic name, so that the values of different element types can be converted into each other.
+ * The names of the user defined types are never looked up this way.
  */
 class TransitiveClosureTypeMapperRegistry : public TypeMapperRegistry
 {
 public:
     virtual TypeMapperPtr getTypeMapperWithName(const std::string &name) override;
+    virtual bool isAmbiguousTypeName(const std::string &name) const override;
     void addWithDependencies(const TypeMapperPtr &typeMapper);
 
 private:
     std::unordered_set<TypeMapperPtr> addedTypes;
     std::unordered_map<std::string, TypeMapperPtr> nameMap;
+    std::unordered_set<std::string> ambiguousNames;
+    std::unordered_map<std::string, TypeMapperPtr> genericNameMap;
 };
 
 /**
@@ -598,6 +1047,8 @@ protected:
 };
 
 typedef std::function<ObjectMapperPtr ()> ObjectMapperFactory;
+typedef std::function<uint64_t (void *)> DirtyGenerationGetter;
+typedef std::function<uint64_t (void *)> InstanceIdentityGetter;
 
 /**
  * Structure type mapper
@@ -621,10 +1072,14 @@ public:
     virtual void subtypesDo(const TypeMapperIterationBlock &aBlock) override;
     virtual void typeMapperDependenciesDo(const TypeMapperIterationBlock &aBlock) override;
 
-    virtual void objectReferencesInInstanceDo(void *instancePointer, std::unordered_map<void*, ObjectMapperPtr> *cache, const ObjectReferenceIterationBlock &aBlock) override;
+    virtual void objectReferencesInInstanceDo(void *instancePointer, const ObjectReferenceIterationBlock &aBlock) override;
+    virtual uint64_t getDirtyGenerationOfInstance(void *instancePointer) override;
+    virtual uint64_t getIdentityOfInstance(void *instancePointer) override;
 
     TypeMapperWeakPtr superType;
     ObjectMapperFactory factory;
+    DirtyGenerationGetter dirtyGenerationGetter;
+    InstanceIdentityGetter identityGetter;
     std::vector<TypeMapperWeakPtr> subtypes;
 };
 
@@ -644,7 +1099,7 @@ public:
     virtual bool readFieldWith(void *basePointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override;
 
     virtual TypeDescriptorPtr getOrCreateTypeDescriptor(TypeDescriptorContext *) override;
-    virtual void objectReferencesInFieldDo(void *baseFieldPointer, std::unordered_map<void*, ObjectMapperPtr> *cache, const ObjectReferenceIterationBlock &aBlock) override;
+    virtual void objectReferencesInFieldDo(void *baseFieldPointer, const ObjectReferenceIterationBlock &aBlock) override;
 };
 
 /**
@@ -685,6 +1140,7 @@ class StructureMaterializationTypeMapper : public MaterializationTypeMapper
 public:
     virtual bool canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const override;
     virtual bool readFieldWith(void *basePointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override;
+    virtual bool skipFieldWith(ReadStream *input) override;
 };
 
 /**
@@ -717,6 +1173,8 @@ inline TypeMapperPtr typeMapperForType()
 template<typename T>
 struct SingletonTypeMapperFor
 {
+    typedef T MapperType;
+
     static constexpr bool IsObjectType = T::IsObjectType;
     static constexpr bool IsReferenceType = T::IsReferenceType;
     static constexpr bool IsValueType = !IsObjectType && !IsReferenceType;
@@ -727,6 +1185,24 @@ struct SingletonTypeMapperFor
     }
 };
 
+/**
+ * I convert the halves of a 128 bits integer into a floating point value.
+ */
+template<typename FT>
+FT integer128HalvesToFloat(uint64_t low, uint64_t high, bool isSigned)
+{
+    // The magnitude is converted for keeping the precision of the small negative values.
+    auto isNegative = isSigned && int64_t(high) < 0;
+    if(isNegative)
+    {
+        low = ~low + 1;
+        high = ~high + (low == 0 ? 1 : 0);
+    }
+
+    auto magnitude = FT(high)*FT(18446744073709551616.0) + FT(low);
+    return isNegative ? -magnitude : magnitude;
+}
+
 /**
  * Numeric primitive type mapper.
  */
@@ -775,6 +1251,7 @@ public:
         case TypeDescriptorKind::Int32:
         case TypeDescriptorKind::Int64:
         case TypeDescriptorKind::Int128:
+        case TypeDescriptorKind::Float16:
         case TypeDescriptorKind::Float32:
         case TypeDescriptorKind::Float64:
         case TypeDescriptorKind::Char8:
@@ -843,7 +1320,11 @@ public:
                 if(!input->readUInt64(readedLow) || !input->readUInt64(readedHigh))
                     return false;
 
-                *destination = FieldType(readedLow);
+                // Narrowing keeps the low bits of integers, like a cast, and floats get the whole value.
+                if constexpr (std::is_floating_point<FieldType>::value)
+                    *destination = integer128HalvesToFloat<FieldType> (readedLow, readedHigh, false);
+                else
+                    *destination = FieldType(readedLow);
                 return true;
             }
 
@@ -885,12 +1366,25 @@ public:
 
         case TypeDescriptorKind::Int128:
             {
-                int64_t readedLow = 0;
-                int64_t readedHigh = 0;
-                if(!input->readInt64(readedLow) || !input->readInt64(readedHigh))
+                uint64_t readedLow = 0;
+                uint64_t readedHigh = 0;
+                if(!input->readUInt64(readedLow) || !input->readUInt64(readedHigh))
                     return false;
 
-                *destination = FieldType(readedLow);
+                // Narrowing keeps the low bits of integers, like a cast, and floats get the whole value.
+                if constexpr (std::is_floating_point<FieldType>::value)
+                    *destination = integer128HalvesToFloat<FieldType> (readedLow, readedHigh, true);
+                else
+                    *destination = FieldType(readedLow);
+                return true;
+            }
+
+        case TypeDescriptorKind::Float16:
+            {
+                uint16_t readedValue = 0;
+                if(!input->readUInt16(readedValue))
+                    return false;
+                *destination = FieldType(float16ToFloat32(readedValue));
                 return true;
             }
 
@@ -979,72 +1473,514 @@ template<>
 struct TypeMapperFor<double> : SingletonTypeMapperFor<NumericPrimitiveTypeMapper<double, TypeDescriptorKind::Float64>> {};
 
 /**
- * Tag for marking a serializable structure.
- */
-struct SerializableStructureTag {};
-
-/**
- * Utility for extracting the metadata for a structure type.
+ * Portable unsigned 128 bits integer, for the compilers without __int128.
  */
-template<typename T, typename C=void>
-struct StructureTypeMetadataFor;
-
-template<typename T>
-struct InlineStructureTypeMetadataFor
+struct UInt128
 {
-    typedef void type;
+    uint64_t low = 0;
+    uint64_t high = 0;
 
-    static FieldDescriptions getFields()
+    bool operator==(const UInt128 &other) const
     {
-        return T::__coal_fields__();
+        return low == other.low && high == other.high;
     }
 
-    static std::string getTypeName()
+    bool operator!=(const UInt128 &other) const
     {
-        return T::__coal_typename__;
+        return !(*this == other);
     }
-};
 
-template<typename T>
-struct StructureTypeMetadataFor<T, typename std::enable_if< std::is_base_of<SerializableStructureTag, T>::value >::type> : InlineStructureTypeMetadataFor<T> {};
+    bool operator<(const UInt128 &other) const
+    {
+        return high < other.high || (high == other.high && low < other.low);
+    }
+};
 
-template<typename T>
-struct ReflectedStructureTypeMapperFor
+/**
+ * Portable signed 128 bits integer, in two's complement, for the compilers without __int128.
+ */
+struct Int128
 {
-    typedef StructureTypeMetadataFor<T> Metadata;
+    uint64_t low = 0;
+    int64_t high = 0;
 
-    static constexpr bool IsObjectType = false;
-    static constexpr bool IsReferenceType = false;
-    static constexpr bool IsValueType = true;
+    bool operator==(const Int128 &other) const
+    {
+        return low == other.low && high == other.high;
+    }
 
-    static TypeMapperPtr apply()
+    bool operator!=(const Int128 &other) const
     {
-        static TypeMapperPtr singleton;
-        static std::once_flag singletonCreation;
-        std::call_once(singletonCreation, [&](){
-            singleton = StructureTypeMapper::makeWithFields(Metadata::getTypeName(), Metadata::getFields());
-        });
+        return !(*this == other);
+    }
 
-        return singleton;
+    bool operator<(const Int128 &other) const
+    {
+        return high < other.high || (high == other.high && low < other.low);
     }
 };
 
-template<typename T>
-struct TypeMapperFor<T, typename StructureTypeMetadataFor<T>::type> : ReflectedStructureTypeMapperFor<T> {};
-
 /**
- * Utility for extracting the metadata for a class type.
+ * Utility for accessing the 64 bits halves of a 128 bits integer type.
  */
-template<typename T, typename C=void>
-struct ClassTypeMetadataFor;
-
 template<typename T>
-struct ReflectedClassTypeMapperFor
+struct Integer128Traits;
+
+template<>
+struct Integer128Traits<UInt128>
 {
-    typedef ClassTypeMetadataFor<T> Metadata;
+    static constexpr bool IsSigned = false;
+    static uint64_t lowOf(const UInt128 &value) { return value.low; }
+    static uint64_t highOf(const UInt128 &value) { return value.high; }
+    static UInt128 fromHalves(uint64_t low, uint64_t high) { return UInt128{low, high}; }
+};
 
-    static constexpr bool IsObjectType = true;
-    static constexpr bool IsReferenceType = false;
+template<>
+struct Integer128Traits<Int128>
+{
+    static constexpr bool IsSigned = true;
+    static uint64_t lowOf(const Int128 &value) { return value.low; }
+    static uint64_t highOf(const Int128 &value) { return uint64_t(value.high); }
+    static Int128 fromHalves(uint64_t low, uint64_t high) { return Int128{low, int64_t(high)}; }
+};
+
+#ifdef __SIZEOF_INT128__
+template<>
+struct Integer128Traits<unsigned __int128>
+{
+    static constexpr bool IsSigned = false;
+    static uint64_t lowOf(unsigned __int128 value) { return uint64_t(value); }
+    static uint64_t highOf(unsigned __int128 value) { return uint64_t(value >> 64); }
+    static unsigned __int128 fromHalves(uint64_t low, uint64_t high) { return (static_cast<unsigned __int128> (high) << 64) | low; }
+};
+
+template<>
+struct Integer128Traits<__int128>
+{
+    static constexpr bool IsSigned = true;
+    static uint64_t lowOf(__int128 value) { return uint64_t(value); }
+    static uint64_t highOf(__int128 value) { return uint64_t(static_cast<unsigned __int128> (value) >> 64); }
+    static __int128 fromHalves(uint64_t low, uint64_t high) { return static_cast<__int128> ((static_cast<unsigned __int128> (high) << 64) | low); }
+};
+#endif
+
+/**
+ * 128 bits integer type mapper. I encode the low half followed by the high half.
+ * I read every integer, boolean and character encoding, by zero or sign extending it according to the signedness of the encoding,
+ * but not the floating point encodings, which cannot be converted without losing precision.
+ */
+template<typename IT>
+class Integer128TypeMapper : public PrimitiveTypeMapper
+{
+public:
+    typedef IT FieldType;
+    typedef Integer128Traits<IT> Traits;
+    typedef Integer128TypeMapper<IT> ThisType;
+
+    static constexpr TypeDescriptorKind EncodingDescriptorKind = Traits::IsSigned ? TypeDescriptorKind::Int128 : TypeDescriptorKind::UInt128;
+    static constexpr bool IsObjectType = false;
+    static constexpr bool IsReferenceType = false;
+
+    static TypeMapperPtr uniqueInstance()
+    {
+        static auto singleton = std::make_shared<ThisType> ();
+        return singleton;
+    }
+
+    Integer128TypeMapper()
+    {
+        name = typeDescriptorKindToString(EncodingDescriptorKind);
+    }
+
+    virtual std::string getQualifiedName() const override
+    {
+#ifdef __SIZEOF_INT128__
+        if constexpr (std::is_same_v<FieldType, unsigned __int128>)
+            return "unsigned __int128";
+        if constexpr (std::is_same_v<FieldType, __int128>)
+            return "__int128";
+#endif
+        return name;
+    }
+
+    virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override
+    {
+        auto &value = *reinterpret_cast<FieldType*> (fieldPointer);
+        output->writeUInt64(Traits::lowOf(value));
+        output->writeUInt64(Traits::highOf(value));
+    }
+
+    virtual bool canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const override
+    {
+        switch(encoding->kind)
+        {
+        case TypeDescriptorKind::Boolean8:
+        case TypeDescriptorKind::Boolean16:
+        case TypeDescriptorKind::Boolean32:
+        case TypeDescriptorKind::Boolean64:
+        case TypeDescriptorKind::UInt8:
+        case TypeDescriptorKind::UInt16:
+        case TypeDescriptorKind::UInt32:
+        case TypeDescriptorKind::UInt64:
+        case TypeDescriptorKind::UInt128:
+        case TypeDescriptorKind::Int8:
+        case TypeDescriptorKind::Int16:
+        case TypeDescriptorKind::Int32:
+        case TypeDescriptorKind::Int64:
+        case TypeDescriptorKind::Int128:
+        case TypeDescriptorKind::Char8:
+        case TypeDescriptorKind::Char16:
+        case TypeDescriptorKind::Char32:
+            return true;
+
+        default:
+            return false;
+        }
+    }
+
+    virtual bool readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override
+    {
+        auto destination = reinterpret_cast<FieldType*> (fieldPointer);
+
+        switch(fieldEncoding->kind)
+        {
+        case TypeDescriptorKind::UInt128:
+        case TypeDescriptorKind::Int128:
+            {
+                uint64_t readedLow = 0;
+                uint64_t readedHigh = 0;
+                if(!input->readUInt64(readedLow) || !input->readUInt64(readedHigh))
+                    return false;
+
+                *destination = Traits::fromHalves(readedLow, readedHigh);
+                return true;
+            }
+
+        case TypeDescriptorKind::Int8:
+        case TypeDescriptorKind::Int16:
+        case TypeDescriptorKind::Int32:
+        case TypeDescriptorKind::Int64:
+            {
+                int64_t readedValue = 0;
+                if(!typeMapperForType<int64_t> ()->readFieldWith(&readedValue, fieldEncoding, input))
+                    return false;
+
+                *destination = Traits::fromHalves(uint64_t(readedValue), readedValue < 0 ? ~uint64_t(0) : 0);
+                return true;
+            }
+
+        default:
+            {
+                uint64_t readedValue = 0;
+                if(!typeMapperForType<uint64_t> ()->readFieldWith(&readedValue, fieldEncoding, input))
+                    return false;
+
+                *destination = Traits::fromHalves(readedValue, 0);
+                return true;
+            }
+        }
+    }
+
+    virtual TypeDescriptorPtr getOrCreateTypeDescriptor(TypeDescriptorContext *context) override
+    {
+        return context->getOrCreatePrimitiveTypeDescriptor(EncodingDescriptorKind);
+    }
+};
+
+template<>
+struct TypeMapperFor<UInt128> : SingletonTypeMapperFor<Integer128TypeMapper<UInt128>> {};
+
+template<>
+struct TypeMapperFor<Int128> : SingletonTypeMapperFor<Integer128TypeMapper<Int128>> {};
+
+#ifdef __SIZEOF_INT128__
+template<>
+struct TypeMapperFor<unsigned __int128> : SingletonTypeMapperFor<Integer128TypeMapper<unsigned __int128>> {};
+
+template<>
+struct TypeMapperFor<__int128> : SingletonTypeMapperFor<Integer128TypeMapper<__int128>> {};
+#endif
+
+/**
+ * Half precision float type mapper. I am used for opting in the Float16 encoding of float fields.
+ */
+class Float16TypeMapper : public NumericPrimitiveTypeMapper<float, TypeDescriptorKind::Float16>
+{
+public:
+    static TypeMapperPtr uniqueInstance();
+
+    virtual void writeFieldWith(void *fieldPointer, WriteStream *output) override;
+};
+
+/**
+ * Utility for selecting the half precision encoding of a field type.
+ */
+template<typename T>
+struct Float16TypeMapperFor;
+
+template<>
+struct Float16TypeMapperFor<float>
+{
+    static TypeMapperPtr apply()
+    {
+        return Float16TypeMapper::uniqueInstance();
+    }
+};
+
+/**
+ * Utility for extracting the enumerator names of an enum type.
+ * I am specialized with a static getEnumerators() method returning the EnumeratorDescriptions of the enum,
+ * which allows reading the values of enumerators that were renumbered by name.
+ */
+template<typename T>
+struct EnumTypeMetadataFor {};
+
+template<typename T, typename C=void>
+struct HasEnumTypeMetadata : std::false_type {};
+
+template<typename T>
+struct HasEnumTypeMetadata<T, std::void_t<decltype(EnumTypeMetadataFor<T>::getEnumerators())>> : std::true_type {};
+
+/**
+ * I compute the integer encoding for a type with the given size and signedness.
+ */
+template<typename T>
+constexpr TypeDescriptorKind integerTypeDescriptorKindFor()
+{
+    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8, "Unsupported integer size.");
+    if constexpr (std::is_signed<T>::value)
+        return sizeof(T) == 1 ? TypeDescriptorKind::Int8 : sizeof(T) == 2 ? TypeDescriptorKind::Int16 : sizeof(T) == 4 ? TypeDescriptorKind::Int32 : TypeDescriptorKind::Int64;
+    else
+        return sizeof(T) == 1 ? TypeDescriptorKind::UInt8 : sizeof(T) == 2 ? TypeDescriptorKind::UInt16 : sizeof(T) == 4 ? TypeDescriptorKind::UInt32 : TypeDescriptorKind::UInt64;
+}
+
+/**
+ * Enum type mapper. I encode the underlying integer of the enum.
+ * When the enum has metadata, the enumerator names are emitted once in the schema and the read values are remapped by name.
+ */
+template<typename ET>
+class EnumTypeMapper : public NumericPrimitiveTypeMapper<ET, integerTypeDescriptorKindFor<std::underlying_type_t<ET>> ()>
+{
+public:
+    typedef NumericPrimitiveTypeMapper<ET, integerTypeDescriptorKindFor<std::underlying_type_t<ET>> ()> Super;
+    typedef EnumTypeMapper<ET> ThisType;
+
+    static constexpr bool HasEnumerators = HasEnumTypeMetadata<ET>::value;
+
+    static TypeMapperPtr uniqueInstance()
+    {
+        static auto singleton = std::make_shared<ThisType> ();
+        return singleton;
+    }
+
+    EnumTypeMapper()
+    {
+        if constexpr (HasEnumerators)
+        {
+            this->name = typeDescriptorKindToString(TypeDescriptorKind::Enum);
+            enumerators = EnumTypeMetadataFor<ET>::getEnumerators();
+        }
+    }
+
+    virtual bool isSerializationDependencyType() const override
+    {
+        return HasEnumerators;
+    }
+
+    virtual std::string getQualifiedName() const override
+    {
+        // An enum without metadata is told apart from its underlying integer type, but not from the other enums with the same underlying type.
+        if constexpr (!HasEnumerators)
+            return std::string(typeDescriptorKindToString(TypeDescriptorKind::Enum)) + "<" + this->name + ">";
+
+        std::string qualifiedName = this->name + "<" + typeDescriptorKindToString(Super::EncodingDescriptorKind) + ">{";
+        for(size_t i = 0; i < enumerators.size(); ++i)
+        {
+            if(i > 0)
+                qualifiedName += ", ";
+            qualifiedName += enumerators[i].name;
+        }
+        qualifiedName += "}";
+        return qualifiedName;
+    }
+
+    virtual void pushDataIntoBinaryBlob(BinaryBlobBuilder &binaryBlobBuilder) override
+    {
+        for(auto &enumerator : enumerators)
+            binaryBlobBuilder.internString16(enumerator.name);
+    }
+
+    virtual bool canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const override
+    {
+        if(encoding->kind != TypeDescriptorKind::Enum)
+            return Super::canReadFieldWithTypeDescriptor(encoding);
+
+        auto enumEncoding = std::static_pointer_cast<EnumTypeDescriptor> (encoding);
+        if(!Super::canReadFieldWithTypeDescriptor(enumEncoding->underlying))
+            return false;
+
+        // Precompute the remapping of the values.
+        if constexpr (HasEnumerators)
+            enumEncoding->getValueRemapTableFor(this, enumerators);
+        return true;
+    }
+
+    virtual bool readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input) override
+    {
+        if(fieldEncoding->kind != TypeDescriptorKind::Enum)
+            return Super::readFieldWith(fieldPointer, fieldEncoding, input);
+
+        auto enumEncoding = std::static_pointer_cast<EnumTypeDescriptor> (fieldEncoding);
+        if(!Super::readFieldWith(fieldPointer, enumEncoding->underlying, input))
+            return false;
+
+        if constexpr (HasEnumerators)
+        {
+            auto &table = enumEncoding->getValueRemapTableFor(this, enumerators);
+            if(table.empty())
+                return true;
+
+            auto &destination = *reinterpret_cast<ET*> (fieldPointer);
+            auto it = table.find(int64_t(destination));
+            if(it != table.end())
+                destination = ET(it->second);
+        }
+
+        return true;
+    }
+
+    virtual TypeDescriptorPtr getOrCreateTypeDescriptor(TypeDescriptorContext *context) override
+    {
+        auto underlyingDescriptor = context->getOrCreatePrimitiveTypeDescriptor(Super::EncodingDescriptorKind);
+        if constexpr (HasEnumerators)
+            return context->getOrCreateEnumTypeDescriptor(underlyingDescriptor, enumerators);
+        else
+            return underlyingDescriptor;
+    }
+
+private:
+    EnumeratorDescriptions enumerators;
+};
+
+template<typename T>
+struct TypeMapperFor<T, typename std::enable_if<std::is_enum<T>::value>::type> : SingletonTypeMapperFor<EnumTypeMapper<T>> {};
+
+/**
+ * Tag for marking a serializable structure.
+ */
+struct SerializableStructureTag {};
+
+/**
+ * Utility for extracting the metadata for a structure type.
+ */
+template<typename T, typename C=void>
+struct StructureTypeMetadataFor;
+
+template<typename T>
+struct InlineStructureTypeMetadataFor
+{
+    typedef void type;
+
+    static FieldDescriptions getFields()
+    {
+        return T::__coal_fields__();
+    }
+
+    static std::string getTypeName()
+    {
+        return T::__coal_typename__;
+    }
+};
+
+template<typename T>
+struct StructureTypeMetadataFor<T, typename std::enable_if< std::is_base_of<SerializableStructureTag, T>::value >::type> : InlineStructureTypeMetadataFor<T> {};
+
+template<typename T>
+struct ReflectedStructureTypeMapperFor
+{
+    typedef StructureTypeMetadataFor<T> Metadata;
+
+    static constexpr bool IsObjectType = false;
+    static constexpr bool IsReferenceType = false;
+    static constexpr bool IsValueType = true;
+
+    static TypeMapperPtr apply()
+    {
+        static TypeMapperPtr singleton;
+        static std::once_flag singletonCreation;
+        std::call_once(singletonCreation, [&](){
+            singleton = StructureTypeMapper::makeWithFields(Metadata::getTypeName(), Metadata::getFields());
+        });
+
+        return singleton;
+    }
+};
+
+template<typename T>
+struct TypeMapperFor<T, typename StructureTypeMetadataFor<T>::type> : ReflectedStructureTypeMapperFor<T> {};
+
+/**
+ * Utility for extracting the metadata for a class type.
+ */
+template<typename T, typename C=void>
+struct ClassTypeMetadataFor;
+
+/**
+ * Dirty tracked object mixin.
+ * I count the modifications of an object, so that the serializer can reuse its previous encoding while it is not modified.
+ * My generation is unique among all the objects, so that a new object allocated at the address of a destroyed one is never taken as unmodified.
+ * Immutable objects, such as loaded assets, are marked by deriving from me, and only flagged with markCoalDirty when they are modified anyway.
+ */
+class DirtyTrackedObject
+{
+public:
+    DirtyTrackedObject()
+        : coalIdentity(nextDirtyGeneration()), coalDirtyGeneration(coalIdentity) {}
+
+    DirtyTrackedObject(const DirtyTrackedObject &)
+        : coalIdentity(nextDirtyGeneration()), coalDirtyGeneration(coalIdentity) {}
+
+    DirtyTrackedObject &operator=(const DirtyTrackedObject &)
+    {
+        markCoalDirty();
+        return *this;
+    }
+
+    /**
+     * I must be called after modifying any serialized field, including the replacement of a referenced object.
+     */
+    void markCoalDirty()
+    {
+        coalDirtyGeneration = nextDirtyGeneration();
+    }
+
+    uint64_t getCoalDirtyGeneration() const
+    {
+        return coalDirtyGeneration;
+    }
+
+    /**
+     * I return my initial generation, which is kept by my modifications and never given to another object.
+     */
+    uint64_t getCoalIdentity() const
+    {
+        return coalIdentity;
+    }
+
+    static uint64_t nextDirtyGeneration();
+
+private:
+    uint64_t coalIdentity;
+    uint64_t coalDirtyGeneration;
+};
+
+template<typename T>
+struct ReflectedClassTypeMapperFor
+{
+    typedef ClassTypeMetadataFor<T> Metadata;
+
+    static constexpr bool IsObjectType = true;
+    static constexpr bool IsReferenceType = false;
     static constexpr bool IsValueType = false;
 
     static TypeMapperPtr apply()
@@ -1053,6 +1989,15 @@ struct ReflectedClassTypeMapperFor
         static std::once_flag singletonCreation;
         std::call_once(singletonCreation, [&](){
             singleton = ObjectTypeMapper::makeWithFields(Metadata::getTypeName(), Metadata::getSuperType(), Metadata::newInstance, Metadata::getFields());
+            if constexpr (std::is_base_of<DirtyTrackedObject, T>::value)
+            {
+                std::static_pointer_cast<ObjectTypeMapper> (singleton)->dirtyGenerationGetter = [](void *instancePointer) {
+                    return static_cast<const DirtyTrackedObject*> (reinterpret_cast<T*> (instancePointer))->getCoalDirtyGeneration();
+                };
+                std::static_pointer_cast<ObjectTypeMapper> (singleton)->identityGetter = [](void *instancePointer) {
+                    return static_cast<const DirtyTrackedObject*> (reinterpret_cast<T*> (instancePointer))->getCoalIdentity();
+                };
+            }
         });
 
         return singleton;
@@ -1097,9 +2042,25 @@ inline FieldDescription::FieldDescription(const std::string &initialName, MT CT:
 {
 }
 
+template<typename CT, typename MT>
+inline FieldDescription::FieldDescription(const std::string &initialName, MT CT::*fieldPointer, const TypeMapperPtr &encodingTypeMapper)
+    : name(initialName), typeMapper(encodingTypeMapper), accessor(memberFieldAccessorFor(fieldPointer))
+{
+}
+
+/**
+ * I describe a float field, or a container of floats, that is encoded with half precision.
+ */
+template<typename CT, typename MT>
+FieldDescription float16Field(const std::string &name, MT CT::*fieldPointer)
+{
+    return FieldDescription(name, fieldPointer, Float16TypeMapperFor<MT>::apply());
+}
+
 
 /**
  * I am a default value type box object.
+ * My type name is qualified with the name of the value type, so that the boxes of different value types can be mixed in a document.
  */
 template<typename VT>
 class RootValueBox : public ObjectMapper
@@ -1113,7 +2074,7 @@ public:
 
     static TypeMapperPtr typeMapperSingleton()
     {
-        static auto singleton = ObjectTypeMapper::makeWithFields("RootValueBox", nullptr, 
+        static auto singleton = ObjectTypeMapper::makeWithFields("RootValueBox<" + typeMapperForType<VT> ()->getQualifiedName() + ">", nullptr,
             []() {
                 return std::make_shared<ThisType> ();
             },
@@ -1123,15 +2084,14 @@ public:
         return singleton;
     }
 
-    static ObjectMapperPtr makeFor(std::unordered_map<void *, ObjectMapperPtr> *cache, const ValueType &value)
+    static ObjectMapperPtr makeFor(const ValueType &value)
     {
-        (void)cache;
         return std::make_shared<ThisType> (value);
     }
 
     static std::optional<ValueType> unwrapDeserializedRootObjectOrValue(const ObjectMapperPtr &deserializedRootObject)
     {
-        if(!deserializedRootObject)
+        if(!deserializedRootObject || deserializedRootObject->getTypeMapper() != typeMapperSingleton())
             return std::nullopt;
 
         return std::static_pointer_cast<ThisType> (deserializedRootObject)->value;
@@ -1168,6 +2128,17 @@ struct ObjectMapperClassFor<const T &> : ObjectMapperClassFor<T> {};
 template<typename T>
 struct ObjectMapperClassFor<T &> : ObjectMapperClassFor<T> {};
 
+template<typename ROT>
+ObjectMapperPtr makeRootObjectFor(ROT &&root)
+{
+    return ObjectMapperClassFor<ROT>::type::makeFor(root);
+}
+
+/**
+ * The roots of a document with several roots, with their names.
+ */
+typedef std::vector<std::pair<std::string, ObjectMapperPtr>> NamedRootObjectList;
+
 /**
  * Serialization cluster
  */
@@ -1178,14 +2149,16 @@ public:
     std::string name;
     SerializationClusterWeakPtr supertype;
     TypeMapperPtr typeMapper;
-    std::vector<ObjectMapperPtr> instances;
+    std::vector<ObjectHandle*> instances;
+    std::vector<ObjectHandle*> updatedInstances;
     std::vector<size_t> objectFieldDescriptions;
 
-    void pushDataIntoBinaryBlob(BinaryBlobBuilder &binaryBlobBuilder);
+    void pushLayoutDataIntoBinaryBlob(BinaryBlobBuilder &binaryBlobBuilder);
+    void pushInstanceDataIntoBinaryBlob(BinaryBlobBuilder &binaryBlobBuilder);
 
-    void addObject(const ObjectMapperPtr &object);
+    void addObject(ObjectHandle *object);
 
-    void writeDescriptionWith(WriteStream *output);
+    void writeDescriptionWith(WriteStream *output, bool withInstanceCount);
     void writeInstancesWith(WriteStream *output);
 };
 
@@ -1197,14 +2170,77 @@ class Serializer
 public:
     Serializer(WriteStream *initialOutput);
 
+    /**
+     * I discard the content of the last serialization, retaining the allocated memory,
+     * the type descriptors and the cluster layouts for reusing them with the same root type.
+     */
+    void reset();
+    void reset(WriteStream *newOutput);
+
+    void setSchemaFingerprintEnabled(bool enabled);
+
+    /**
+     * In session mode, I omit the schema from the messages whose schema was already sent in a previous message.
+     * When new types are traced for the same root types, I only send the layouts of the new types as an extension of the previous schema.
+     * The reader must be a deserializer in session mode that has read all of the previous messages.
+     */
+    void setSessionModeEnabled(bool enabled);
+
+    void setSectionCompressionCodec(CompressionCodec codec);
+
+    /**
+     * In delta mode, I only write the objects that are new or whose encoded content changed since the previous message,
+     * and the blob data that was not already sent. I write a complete message first, and whenever the baseline has
+     * accumulated too many unreachable objects or replaced blob strings. The reader must be a deserializer in delta mode that has read all of the previous messages.
+     */
+    void setDeltaModeEnabled(bool enabled);
+
+    /**
+     * I make the next message a complete one, for example for a new reader.
+     */
+    void resetDeltaBaseline();
+
+    /**
+     * I give to each dirty tracked object an identifier that is kept across serializations while the object remains reachable, and I store it with its instance.
+     * The other objects have the zero identifier, because an object allocated at the address of a destroyed one could not be told apart from it.
+     */
+    void setStableObjectIdsEnabled(bool enabled);
+
+    /**
+     * I return the stable identifier of an object of the last serialization, or zero.
+     */
+    uint64_t getStableObjectIdOf(const void *objectBasePointer) const;
+
+    /**
+     * I keep the encoding of the dirty tracked objects across serializations, and I reuse it for tracing and writing them while they are not marked as dirty.
+     * An object that is not reachable anymore is removed from the cache on the next serialization.
+     */
+    void setEncodedInstanceCacheEnabled(bool enabled);
+
+    /**
+     * I store the sections with their sizes and their checksums, for detecting corruption before parsing each section.
+     * The sections are buffered before writing them.
+     */
+    void setSectionChecksumsEnabled(bool enabled);
+
+    /**
+     * I store a checksum of the whole message after the trailer.
+     */
+    void setTrailerChecksumEnabled(bool enabled);
+
     template<typename ROT>
     void serializeRootObjectOrValue(ROT &&root)
     {
-        serializeRootObject(ObjectMapperClassFor<ROT>::type::makeFor(&objectPointerToMapperMap, root));
+        serializeRootObject(ObjectMapperClassFor<ROT>::type::makeFor(root));
     }
 
     void serializeRootObject(const ObjectMapperPtr &object);
 
+    /**
+     * I serialize several roots in a single document, so that they share the blob and the objects that they reference.
+     */
+    void serializeRootObjects(const NamedRootObjectList &roots);
+
 private:
     enum class ValueTypeScanColor: uint8_t
     {
@@ -1213,37 +2249,150 @@ private:
         Black
     };
 
-    void addPendingObject(const ObjectMapperPtr &object);
+    void addPendingObject(const ObjectHandle &object);
     void tracePendingObjects();
-    void tracePendingObject(const ObjectMapperPtr &object);
+    void tracePendingObject(ObjectHandle *object);
+    EncodedInstance *getOrCreateEncodedInstanceFor(ObjectHandle *object);
+    void pruneEncodedInstanceCache();
+    void pushInstanceDataOf(ObjectHandle *instance);
+    void writeInstanceOf(ObjectHandle *instance, WriteStream *instanceOutput);
 
     TypeDescriptorPtr getOrCreateAggregateTypeDescriptorFor(const TypeMapperPtr &typeMapper);
     void scanReferenceTypeDependencies(const TypeMapperPtr &typeMapper);
     void scanTypeMapperDependency(const TypeMapperPtr &typeMapper);
-    SerializationClusterPtr getOrCreateClusterFor(const TypeMapperPtr &typeMapper);
+    SerializationClusterPtr getOrCreateClusterFor(TypeMapper *typeMapper);
 
-    void writeHeader();
+    void writeFixedHeader();
+    void writeVariableHeader();
     void writeBlob();
     void writeValueTypeLayouts();
     void writeClusterDescriptions();
+    void writeClusterInstanceCounts();
+    void writeStableObjectIds();
     void writeClusterInstances();
-    void writeTrailerForObject(const ObjectMapperPtr &rootObject);
+    void writeClusterInstancesWith(WriteStream *instanceOutput);
+    void writeTrailer();
+    void beginSection();
+    void endSection();
+    void writeSections();
+    void serializeRoots();
     void prepareForWriting();
+    void prepareDeltaForWriting();
+    bool isUnmodifiedSinceDeltaBaseline(ObjectHandle *instance);
+    void assignStableObjectIds();
+    void encodeSchema(size_t schemaBlobSize);
+    void discardLayoutsForDifferentRootTypes();
 
     WriteStream *output;
+    NamedRootObjectList rootObjects;
+    bool multipleRoots = false;
+    std::vector<TypeMapperPtr> rootTypeMappers;
+    std::vector<TypeMapperPtr> layoutsRootTypeMappers;
+    bool schemaFingerprintEnabled = true;
+    bool sessionModeEnabled = false;
+    bool schemaElided = false;
+    bool schemaExtended = false;
+    CompressionCodec sectionCompressionCodec = CompressionCodec::None;
+    bool sectionChecksumsEnabled = false;
+    bool trailerChecksumEnabled = false;
+    Crc32cWriteStream *checksumOutput = nullptr;
+    WriteStream *sectionOutput = nullptr;
+    std::vector<uint8_t> sectionData;
+    std::unordered_set<uint64_t> sessionSchemaFingerprints;
+
+    struct DeltaBaselineEntry
+    {
+        TypeMapper *typeMapper = nullptr;
+        uint32_t instanceIndex = 0;
+        size_t dataOffset = 0;
+        size_t dataSize = 0;
+        uint64_t dirtyGeneration = 0;
+    };
+
+    bool deltaModeEnabled = false;
+    bool hasDeltaBaseline = false;
+    bool isDeltaMessage = false;
+    size_t deltaBaselineBlobSize = 0;
+    size_t deltaCompleteBlobSize = 0;
+    uint32_t deltaBaselineInstanceCount = 0;
+    std::unordered_map<const void*, DeltaBaselineEntry> deltaBaseline;
+    std::vector<uint8_t> deltaBaselineInstanceData;
+    std::vector<uint8_t> deltaInstanceData;
+    std::vector<std::pair<size_t, size_t>> deltaWrittenInstances;
+
+    struct StableObjectIdEntry
+    {
+        uint64_t identity = 0;
+        uint64_t id = 0;
+        uint64_t generation = 0;
+    };
+
+    bool stableObjectIdsEnabled = false;
+    uint64_t nextStableObjectId = 1;
+    uint64_t stableObjectIdGeneration = 0;
+    std::unordered_map<const void*, StableObjectIdEntry> stableObjectIds;
+
+    bool encodedInstanceCacheEnabled = false;
+    uint64_t encodedInstanceCacheGeneration = 0;
+    std::unordered_map<const void*, EncodedInstance> encodedInstanceCache;
+    std::vector<uint8_t> relocatedInstanceData;
+
+    bool hasEncodedSchema = false;
+    bool isEncodedSchemaExtension = false;
+    std::vector<uint8_t> encodedSchema;
+    uint64_t encodedSchemaFingerprint = 0;
+    uint64_t baseSchemaFingerprint = 0;
+    size_t encodedSchemaValueTypeCount = 0;
+    size_t encodedSchemaClusterCount = 0;
 
     TypeDescriptorContext typeDescriptorContext;
     BinaryBlobBuilder binaryBlobBuilder;
     size_t objectCount;
     std::vector<SerializationClusterPtr> clusters;
     std::unordered_map<TypeMapperPtr, ValueTypeScanColor> valueTypeScanColorMap;
-    std::unordered_map<TypeMapperPtr, SerializationClusterPtr> typeMapperToClustersMap;
+    std::unordered_map<TypeMapper*, SerializationClusterPtr> typeMapperToClustersMap;
     std::unordered_set<TypeMapperPtr> scannedReferenceType;
 
-    std::vector<ObjectMapperPtr> tracingStack;
-    std::unordered_set<ObjectMapperPtr> seenSet;
-    std::unordered_map<void *, ObjectMapperPtr> objectPointerToMapperMap;
-    std::unordered_map<const void *, uint32_t> objectPointerToInstanceIndexTable;
+    ObjectHandleArena objectHandleArena;
+    ObjectHandleTable objectHandleTable;
+    std::vector<ObjectHandle*> tracingStack;
+};
+
+/**
+ * Deserialization schema.
+ * I hold the materialization type mappers that are resolved for the value type layouts and cluster descriptions of a serialized schema.
+ */
+struct DeserializationSchema
+{
+    uint64_t fingerprint = 0;
+    uint32_t size = 0;
+    uint32_t valueTypeCount = 0;
+    std::vector<TypeMapperPtr> valueTypes;
+    std::vector<ObjectMaterializationTypeMapperPtr> clusterTypes;
+
+    // The encoded schema and the blob data with its names, for comparing the schemas with the same fingerprint.
+    std::vector<uint8_t> encoding;
+    std::vector<uint8_t> nameData;
+};
+
+/**
+ * Schema resolution cache.
+ * I am a process wide cache of the deserialization schemas that are resolved against a type mapper registry, keyed by their fingerprint.
+ */
+class SchemaResolutionCache
+{
+public:
+    static SchemaResolutionCache &uniqueInstance();
+
+    DeserializationSchemaPtr find(const TypeMapperRegistryPtr &registry, uint64_t fingerprint);
+    void add(const TypeMapperRegistryPtr &registry, const DeserializationSchemaPtr &schema);
+    void clear();
+
+private:
+    static constexpr size_t Capacity = 256;
+
+    std::mutex mutex;
+    std::map<std::pair<TypeMapperRegistry*, uint64_t>, DeserializationSchemaPtr> entries;
 };
 
 /**
@@ -1263,30 +2412,150 @@ public:
         return RootObjectMapperClass::unwrapDeserializedRootObjectOrValue(result);
     }
 
+    /**
+     * I deserialize a document, and I return its root. I return the first root of a document with several roots.
+     */
     ObjectMapperPtr deserializeRootObject(const TypeMapperPtr &rootTypeMapper);
 
+    template<typename...Types>
+    bool deserializeRootObjectsOrValuesOfTypes()
+    {
+        return deserializeRootObjects({ObjectMapperClassFor<Types>::type::typeMapperSingleton()...});
+    }
+
+    /**
+     * I deserialize a document with several roots, whose types are in the transitive closure of the specified ones.
+     * A document with a single root has a single root without a name.
+     * I fail when different aggregate types of the transitive closure have the same name.
+     */
+    bool deserializeRootObjects(const std::vector<TypeMapperPtr> &rootTypeMappers);
+
+    size_t getRootObjectCount() const;
+    ObjectMapperPtr getRootObjectAt(size_t index) const;
+    ObjectMapperPtr getRootObjectNamed(const std::string &name) const;
+
+    template<typename T>
+    std::optional<T> getRootObjectOrValueAt(size_t index) const
+    {
+        return ObjectMapperClassFor<T>::type::unwrapDeserializedRootObjectOrValue(getRootObjectAt(index));
+    }
+
+    template<typename T>
+    std::optional<T> getRootObjectOrValueNamed(const std::string &name) const
+    {
+        return ObjectMapperClassFor<T>::type::unwrapDeserializedRootObjectOrValue(getRootObjectNamed(name));
+    }
+
+    /**
+     * I discard the content of the last deserialization, retaining the allocated memory and the type mapper registry.
+     */
+    void reset();
+    void reset(ReadStream *newInput);
+
+    /**
+     * In session mode, I retain every schema that I read, so that I can read the following messages in which the schema is elided or extended.
+     */
+    void setSessionModeEnabled(bool enabled);
+
+    /**
+     * In delta mode, I retain the blob and the instances of the last message as the baseline for the following delta messages,
+     * whose changes are applied onto the previously materialized objects. The baseline is dropped by the next complete message.
+     */
+    void setDeltaModeEnabled(bool enabled);
+
+    /**
+     * I return the stable identifier of a materialized object, or zero when the message does not have stable identifiers or when the object has none.
+     */
+    uint64_t getStableObjectIdOf(const void *objectBasePointer) const;
+    ObjectMapperPtr getObjectWithStableId(uint64_t id) const;
+
+    /**
+     * I return the blob of the last message, into which the deserialized string and byte views point.
+     * The views remain valid while this handle is held, because I make a new blob for the next messages instead of overwriting a shared one.
+     */
+    std::shared_ptr<const std::vector<uint8_t>> getBinaryBlobHandle() const;
+
+    /**
+     * I read the string and byte views into my blob, which is the default. When they are disabled, reading a view fails.
+     */
+    void setBinaryBlobViewsEnabled(bool enabled);
+
+    /**
+     * With the string pool, the shared string fields that are read from the same blob range share a single string.
+     * In delta mode, the strings of the baseline blob are also shared with the following messages.
+     */
+    void setStringPoolEnabled(bool enabled);
+
+    size_t getStringPoolSize() const;
+
 private:
+    void clearBlobData();
+    void detachSharedBlobData(size_t retainedSize);
+    bool parseFixedHeader();
     bool parseHeaderAndReadBlob();
     bool parseContent();
+    bool parseSections();
+    bool beginSection();
+    bool endSection();
+    bool readSchemaData(const uint8_t *&schemaData);
+    bool useCachedSchema(const uint8_t *schemaData);
+    bool extendSessionSchema(const uint8_t *schemaData);
+    bool parseSchema(const uint8_t *schemaData);
     bool parseValueTypeDescriptors();
     bool parseClusterDescriptors();
-    bool validateAndResolveTypes();
+    bool validateAndResolveTypes(size_t firstClusterIndex);
+    bool parseClusterInstanceCounts();
+    bool parseStableObjectIds();
+    void registerStableObjectIds(size_t firstNewInstanceIndex);
     bool parseClusterInstances();
+    bool parseClusterInstancesWith(ReadStream *instanceInput);
     bool parseTrailer();
 
     ReadStream *input;
-    ObjectMapperPtr rootObject;
+    std::vector<ObjectMapperPtr> rootObjects;
+    std::vector<std::string> rootNames;
+    std::vector<TypeMapperPtr> registryRootTypeMappers;
     TypeMapperRegistryPtr typeMapperRegistry;
-    std::vector<uint8_t> blobData;
+    std::shared_ptr<std::vector<uint8_t>> blobData = std::make_shared<std::vector<uint8_t>> ();
+    bool stringPoolEnabled = false;
+    bool binaryBlobViewsEnabled = true;
+    StringPool stringPool;
     TypeDescriptorContext typeDescriptorContext;
 
+    uint16_t headerFlags = 0;
+    uint32_t blobSize = 0;
     uint32_t valueTypeCount = 0;
     uint32_t clusterCount = 0;
     uint32_t objectCount = 0;
-
-    std::vector<ObjectMaterializationTypeMapperPtr> clusterTypes;
+    uint64_t schemaFingerprint = 0;
+    uint64_t baseSchemaFingerprint = 0;
+    uint32_t schemaSize = 0;
+    CompressionCodec sectionCompressionCodec = CompressionCodec::None;
+    std::array<uint8_t, CoalFixedHeaderSize> fixedHeader;
+    ReadStream *sectionSource = nullptr;
+    MemoryReadStream *sectionInput = nullptr;
+    std::vector<uint8_t> sectionBuffer;
+    std::vector<uint8_t> schemaBuffer;
+    uint32_t pendingChecksum = 0;
+    size_t pendingSize = 0;
+    uint32_t messageChecksum = 0;
+
+    DeserializationSchemaPtr schema;
     std::vector<uint32_t> clusterInstanceCount;
+
+    bool sessionModeEnabled = false;
+    std::map<std::pair<TypeMapperRegistry*, uint64_t>, DeserializationSchemaPtr> sessionSchemas; // The registries are never destroyed.
+
+    bool deltaModeEnabled = false;
+    bool hasDeltaBaseline = false;
+    uint32_t deltaBaselineInstanceCount = 0;
+    std::vector<std::vector<uint32_t>> clusterUpdatedInstances;
+
+    std::vector<uint64_t> newInstanceStableIds;
+    std::unordered_map<uint64_t, ObjectMapperPtr> objectsByStableId;
+    std::unordered_map<const void*, uint64_t> stableIdsByObject;
     std::vector<ObjectMapperPtr> instances;
+    ExclusiveOwnershipTable exclusiveOwnershipTable;
 };
 
 /**
@@ -1304,12 +2573,15 @@ std::vector<uint8_t> serialize(const VT &value)
 
 /**
  * Convenience method for deserializing Coal objects and values.
+ * The blob of the message does not outlive me, so I return nothing for the types with string or byte views, such as
+ * std::string_view and BytesView. They are read with a Deserializer, whose blob is kept alive with Deserializer::getBinaryBlobHandle.
  */
 template<typename RT>
 std::optional<RT> deserialize(const std::vector<uint8_t> &data)
 {
     MemoryReadStream input(data.data(), data.size());
     Deserializer deserializer(&input);
+    deserializer.setBinaryBlobViewsEnabled(false);
     return deserializer.deserializeRootObjectOrValueOfType<RT> ();
 }
 
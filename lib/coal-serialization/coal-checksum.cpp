@@ -0,0 +1,449 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2021 Desarrollo de Software Ronie Salgado Faila E.I.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "coal-serialization/coal-checksum.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define COAL_CRC32C_X86
+#   include <nmmintrin.h>
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#       define COAL_CRC32C_TARGET
+#   else
+#       include <cpuid.h>
+#       define COAL_CRC32C_TARGET __attribute__((target("sse4.2")))
+#   endif
+#elif defined(__ARM_FEATURE_CRC32) || defined(_M_ARM64)
+#   define COAL_CRC32C_ARM
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#   else
+#       include <arm_acle.h>
+#   endif
+#   define COAL_CRC32C_TARGET
+#endif
+
+namespace coal
+{
+
+#pragma region Crc32cTables
+
+static constexpr uint32_t Crc32cPolynomial = 0x82F63B78; // Reflected.
+static constexpr size_t Crc32cLongBlockSize = 8192;
+static constexpr size_t Crc32cShortBlockSize = 256;
+
+/**
+ * I multiply two polynomials modulo the CRC32C polynomial, in the reflected bit order. The first one must not be zero.
+ */
+static uint32_t crc32cMultiplyModP(uint32_t a, uint32_t b)
+{
+    uint32_t mask = 1u << 31;
+    uint32_t product = 0;
+    for(;;)
+    {
+        if(a & mask)
+        {
+            product ^= b;
+            if((a & (mask - 1)) == 0)
+                break;
+        }
+
+        mask >>= 1;
+        b = (b & 1) ? (b >> 1) ^ Crc32cPolynomial : b >> 1;
+    }
+
+    return product;
+}
+
+struct Crc32cTables
+{
+    Crc32cTables()
+    {
+        for(uint32_t i = 0; i < 256; ++i)
+        {
+            auto crc = i;
+            for(int j = 0; j < 8; ++j)
+                crc = (crc & 1) ? (crc >> 1) ^ Crc32cPolynomial : crc >> 1;
+            slicing[0][i] = crc;
+        }
+
+        for(uint32_t i = 0; i < 256; ++i)
+        {
+            for(size_t k = 1; k < 8; ++k)
+                slicing[k][i] = (slicing[k - 1][i] >> 8) ^ slicing[0][slicing[k - 1][i] & 0xFF];
+        }
+
+        // x^(2^n) mod P, for computing x^(8*size) mod P in logarithmic time.
+        powersOfTwo[0] = 1u << 30;
+        for(size_t i = 1; i < 32; ++i)
+            powersOfTwo[i] = crc32cMultiplyModP(powersOfTwo[i - 1], powersOfTwo[i - 1]);
+
+        makeShiftTable(longShift, Crc32cLongBlockSize);
+        makeShiftTable(shortShift, Crc32cShortBlockSize);
+    }
+
+    uint32_t xPower8nModP(size_t n) const
+    {
+        uint32_t result = 1u << 31;
+        size_t k = 3;
+        while(n)
+        {
+            if(n & 1)
+                result = crc32cMultiplyModP(powersOfTwo[k & 31], result);
+            n >>= 1;
+            ++k;
+        }
+
+        return result;
+    }
+
+    // Feeding zeros into a CRC register is a linear operation, so it can be tabulated per byte of the register.
+    void makeShiftTable(uint32_t table[4][256], size_t zeroCount)
+    {
+        auto power = xPower8nModP(zeroCount);
+        for(uint32_t k = 0; k < 4; ++k)
+        {
+            for(uint32_t i = 0; i < 256; ++i)
+                table[k][i] = crc32cMultiplyModP(power, i << (8*k));
+        }
+    }
+
+    uint32_t slicing[8][256];
+    uint32_t powersOfTwo[32];
+    uint32_t longShift[4][256];
+    uint32_t shortShift[4][256];
+};
+
+static const Crc32cTables &crc32cTables()
+{
+    static Crc32cTables tables;
+    return tables;
+}
+
+static inline uint32_t crc32cShift(const uint32_t table[4][256], uint32_t crc)
+{
+    return table[0][crc & 0xFF] ^ table[1][(crc >> 8) & 0xFF] ^ table[2][(crc >> 16) & 0xFF] ^ table[3][crc >> 24];
+}
+
+static inline uint64_t crc32cLoadUInt64(const uint8_t *data)
+{
+    uint64_t result;
+    memcpy(&result, data, 8);
+    return result;
+}
+
+#pragma endregion Crc32cTables
+
+#pragma region Crc32cSoftware
+
+static uint32_t crc32cSoftware(uint32_t crc, const uint8_t *data, size_t size)
+{
+    auto &table = crc32cTables().slicing;
+    while(size > 0 && (reinterpret_cast<uintptr_t> (data) & 7) != 0)
+    {
+        crc = table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+        --size;
+    }
+
+    while(size >= 8)
+    {
+        auto word = crc32cLoadUInt64(data) ^ crc;
+        crc = table[7][word & 0xFF] ^
+            table[6][(word >> 8) & 0xFF] ^
+            table[5][(word >> 16) & 0xFF] ^
+            table[4][(word >> 24) & 0xFF] ^
+            table[3][(word >> 32) & 0xFF] ^
+            table[2][(word >> 40) & 0xFF] ^
+            table[1][(word >> 48) & 0xFF] ^
+            table[0][word >> 56];
+        data += 8;
+        size -= 8;
+    }
+
+    while(size > 0)
+    {
+        crc = table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+        --size;
+    }
+
+    return crc;
+}
+
+#pragma endregion Crc32cSoftware
+
+#pragma region Crc32cHardware
+
+#if defined(COAL_CRC32C_X86) || defined(COAL_CRC32C_ARM)
+
+COAL_CRC32C_TARGET static inline uint32_t crc32cHardwareStep8(uint32_t crc, uint8_t value)
+{
+#ifdef COAL_CRC32C_X86
+    return _mm_crc32_u8(crc, value);
+#else
+    return __crc32cb(crc, value);
+#endif
+}
+
+COAL_CRC32C_TARGET static inline uint32_t crc32cHardwareStep64(uint32_t crc, uint64_t value)
+{
+#if defined(__x86_64__) || defined(_M_X64)
+    return uint32_t(_mm_crc32_u64(crc, value));
+#elif defined(COAL_CRC32C_X86)
+    crc = _mm_crc32_u32(crc, uint32_t(value));
+    return _mm_crc32_u32(crc, uint32_t(value >> 32));
+#else
+    return __crc32cd(crc, value);
+#endif
+}
+
+/**
+ * I process blocks of three lanes in parallel for hiding the latency of the CRC instruction. The lane checksums are combined with a shift table.
+ */
+COAL_CRC32C_TARGET static uint32_t crc32cHardwareInterleaved(uint32_t crc, const uint8_t *&data, size_t &size, size_t blockSize, const uint32_t shiftTable[4][256])
+{
+    while(size >= 3*blockSize)
+    {
+        uint32_t crc0 = crc;
+        uint32_t crc1 = 0;
+        uint32_t crc2 = 0;
+        auto blockEnd = data + blockSize;
+        do
+        {
+            crc0 = crc32cHardwareStep64(crc0, crc32cLoadUInt64(data));
+            crc1 = crc32cHardwareStep64(crc1, crc32cLoadUInt64(data + blockSize));
+            crc2 = crc32cHardwareStep64(crc2, crc32cLoadUInt64(data + 2*blockSize));
+            data += 8;
+        } while(data < blockEnd);
+
+        crc = crc32cShift(shiftTable, crc0) ^ crc1;
+        crc = crc32cShift(shiftTable, crc) ^ crc2;
+        data += 2*blockSize;
+        size -= 3*blockSize;
+    }
+
+    return crc;
+}
+
+COAL_CRC32C_TARGET static uint32_t crc32cHardware(uint32_t crc, const uint8_t *data, size_t size)
+{
+    while(size > 0 && (reinterpret_cast<uintptr_t> (data) & 7) != 0)
+    {
+        crc = crc32cHardwareStep8(crc, *data++);
+        --size;
+    }
+
+    auto &tables = crc32cTables();
+    crc = crc32cHardwareInterleaved(crc, data, size, Crc32cLongBlockSize, tables.longShift);
+    crc = crc32cHardwareInterleaved(crc, data, size, Crc32cShortBlockSize, tables.shortShift);
+
+    while(size >= 8)
+    {
+        crc = crc32cHardwareStep64(crc, crc32cLoadUInt64(data));
+        data += 8;
+        size -= 8;
+    }
+
+    while(size > 0)
+    {
+        crc = crc32cHardwareStep8(crc, *data++);
+        --size;
+    }
+
+    return crc;
+}
+
+#endif
+
+static bool detectHardwareCrc32c()
+{
+#if defined(COAL_CRC32C_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#elif defined(COAL_CRC32C_X86)
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+    return (ecx & bit_SSE4_2) != 0;
+#elif defined(COAL_CRC32C_ARM)
+    return true;
+#else
+    return false;
+#endif
+}
+
+#pragma endregion Crc32cHardware
+
+#pragma region Crc32c
+
+bool isCrc32cHardwareAccelerated()
+{
+    static bool result = detectHardwareCrc32c();
+    return result;
+}
+
+uint32_t crc32c(const uint8_t *data, size_t size, uint32_t previousChecksum)
+{
+    auto crc = ~previousChecksum;
+#if defined(COAL_CRC32C_X86) || defined(COAL_CRC32C_ARM)
+    if(isCrc32cHardwareAccelerated())
+        return ~crc32cHardware(crc, data, size);
+#endif
+    return ~crc32cSoftware(crc, data, size);
+}
+
+uint32_t crc32cCombine(uint32_t firstChecksum, uint32_t secondChecksum, size_t secondSize)
+{
+    return crc32cMultiplyModP(crc32cTables().xPower8nModP(secondSize), firstChecksum) ^ secondChecksum;
+}
+
+#pragma endregion Crc32c
+
+#pragma region Crc32cWriteStream
+
+Crc32cWriteStream::Crc32cWriteStream(WriteStream *initialTarget)
+    : target(initialTarget)
+{
+}
+
+void Crc32cWriteStream::writeBytes(const uint8_t *data, size_t size)
+{
+    if(buffer.size() + size > BufferSize)
+        flush();
+
+    // Large writes are directly forwarded.
+    if(size >= BufferSize)
+    {
+        sectionChecksum = crc32c(data, size, sectionChecksum);
+        sectionSize += size;
+        target->writeBytes(data, size);
+        return;
+    }
+
+    buffer.insert(buffer.end(), data, data + size);
+}
+
+void Crc32cWriteStream::flush()
+{
+    if(buffer.empty())
+        return;
+
+    sectionChecksum = crc32c(buffer.data(), buffer.size(), sectionChecksum);
+    sectionSize += buffer.size();
+    target->writeBytes(buffer.data(), buffer.size());
+    buffer.clear();
+}
+
+uint32_t Crc32cWriteStream::endSection()
+{
+    flush();
+    auto result = sectionChecksum;
+    messageChecksum = crc32cCombine(messageChecksum, sectionChecksum, sectionSize);
+    sectionChecksum = 0;
+    sectionSize = 0;
+    return result;
+}
+
+void Crc32cWriteStream::writeSectionChecksum()
+{
+    auto checksum = endSection();
+    writeUInt32(checksum);
+
+    // The checksum is not part of the next section.
+    endSection();
+}
+
+uint32_t Crc32cWriteStream::finish()
+{
+    endSection();
+    return messageChecksum;
+}
+
+#pragma endregion Crc32cWriteStream
+
+#pragma region Crc32cReadStream
+
+Crc32cReadStream::Crc32cReadStream(ReadStream *initialSource)
+    : source(initialSource)
+{
+}
+
+bool Crc32cReadStream::readBytes(uint8_t *destination, size_t size)
+{
+    if(!source->readBytes(destination, size))
+        return false;
+
+    includeBytes(destination, size);
+    return true;
+}
+
+bool Crc32cReadStream::skipBytes(size_t size)
+{
+    // Skipped data is still part of the checksum, so it is read directly into the buffer.
+    while(size > 0)
+    {
+        if(bufferSize == BufferSize)
+            flush();
+
+        auto readSize = std::min(size, BufferSize - bufferSize);
+        if(!source->readBytes(buffer.data() + bufferSize, readSize))
+            return false;
+
+        bufferSize += readSize;
+        size -= readSize;
+    }
+
+    return true;
+}
+
+void Crc32cReadStream::includeBytes(const uint8_t *data, size_t size)
+{
+    if(bufferSize + size > BufferSize)
+        flush();
+
+    // Large reads are directly included.
+    if(size >= BufferSize)
+    {
+        checksum = crc32c(data, size, checksum);
+        return;
+    }
+
+    memcpy(buffer.data() + bufferSize, data, size);
+    bufferSize += size;
+}
+
+void Crc32cReadStream::flush()
+{
+    checksum = crc32c(buffer.data(), bufferSize, checksum);
+    bufferSize = 0;
+}
+
+uint32_t Crc32cReadStream::finish()
+{
+    flush();
+    return checksum;
+}
+
+#pragma endregion Crc32cReadStream
+
+} // End of namespace coal
@@ -0,0 +1,138 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2021 Desarrollo de Software Ronie Salgado Faila E.I.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "coal-serialization/coal-chunked-stream.hpp"
+
+namespace coal
+{
+
+#pragma region ChunkedStreamWriter
+
+ChunkedStreamWriter::ChunkedStreamWriter(WriteStream *initialTarget)
+    : target(initialTarget), chunkOutput(chunkData), serializer(&chunkOutput)
+{
+    serializer.setSessionModeEnabled(true);
+}
+
+Serializer &ChunkedStreamWriter::getSerializer()
+{
+    return serializer;
+}
+
+void ChunkedStreamWriter::writeHeaderIfNeeded()
+{
+    if(hasWrittenHeader)
+        return;
+
+    target->writeUInt32(CoalChunkedStreamMagicNumber);
+    target->writeUInt8(CoalChunkedStreamVersionMajor);
+    target->writeUInt8(CoalChunkedStreamVersionMinor);
+    target->writeUInt16(0); // Reserved
+    hasWrittenHeader = true;
+}
+
+void ChunkedStreamWriter::writeChunkWithRootObject(const ObjectMapperPtr &rootObject)
+{
+    writeHeaderIfNeeded();
+
+    chunkData.clear();
+    serializer.serializeRootObject(rootObject);
+    assert(!chunkData.empty());
+
+    target->writeUInt32(uint32_t(chunkData.size()));
+    target->writeBytes(chunkData.data(), chunkData.size());
+}
+
+void ChunkedStreamWriter::finish()
+{
+    writeHeaderIfNeeded();
+    target->writeUInt32(0);
+}
+
+#pragma endregion ChunkedStreamWriter
+
+#pragma region ChunkedStreamReader
+
+ChunkedStreamReader::ChunkedStreamReader(ReadStream *initialSource)
+    : source(initialSource), deserializer(nullptr)
+{
+    deserializer.setSessionModeEnabled(true);
+}
+
+bool ChunkedStreamReader::hasReachedEnd() const
+{
+    return reachedEnd;
+}
+
+bool ChunkedStreamReader::readHeaderIfNeeded()
+{
+    if(hasReadHeader)
+        return true;
+
+    uint32_t magicNumber;
+    uint8_t versionMajor, versionMinor;
+    uint16_t reserved;
+    if(!source->readUInt32(magicNumber) || magicNumber != CoalChunkedStreamMagicNumber ||
+        !source->readUInt8(versionMajor) || versionMajor != CoalChunkedStreamVersionMajor ||
+        !source->readUInt8(versionMinor) || versionMinor > CoalChunkedStreamVersionMinor ||
+        !source->readUInt16(reserved))
+        return false;
+
+    hasReadHeader = true;
+    return true;
+}
+
+bool ChunkedStreamReader::readChunkData()
+{
+    uint32_t chunkSize = 0;
+    if(!source->readUInt32(chunkSize))
+        return false;
+
+    if(chunkSize == 0)
+    {
+        reachedEnd = true;
+        return false;
+    }
+
+    if(chunkSize > MaxChunkSize)
+        return false;
+
+    chunkData.resize(chunkSize);
+    return source->readBytes(chunkData.data(), chunkSize);
+}
+
+ObjectMapperPtr ChunkedStreamReader::readChunkWithRootObject(const TypeMapperPtr &rootTypeMapper)
+{
+    if(reachedEnd || !readHeaderIfNeeded() || !readChunkData())
+        return nullptr;
+
+    MemoryReadStream chunkInput(chunkData.data(), chunkData.size());
+    deserializer.reset(&chunkInput);
+    auto result = deserializer.deserializeRootObject(rootTypeMapper);
+    deserializer.reset(nullptr);
+    return result;
+}
+
+#pragma endregion ChunkedStreamReader
+
+} // End of namespace coal
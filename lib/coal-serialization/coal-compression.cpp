@@ -0,0 +1,564 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2021 Desarrollo de Software Ronie Salgado Faila E.I.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "coal-serialization/coal-compression.hpp"
+#include <thread>
+
+#ifdef COAL_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef COAL_HAS_ZSTD
+#include <zstd.h>
+#endif
+
+namespace coal
+{
+
+#pragma region LZCodec
+
+// A LZ77 block format in the style of LZ4. A block is a sequence of tokens, whose high nibble is a literal count,
+// and whose low nibble is a match length. Lengths of 15 are extended with additional bytes. The literals are
+// followed by a 16 bits match offset, except in the last sequence which only has literals.
+static constexpr size_t LZMinMatchLength = 4;
+static constexpr size_t LZLastLiteralsSize = 5;
+static constexpr size_t LZMatchSearchEndMargin = 12;
+static constexpr size_t LZMaxMatchOffset = 0xFFFF;
+static constexpr size_t LZHashBits = 12;
+
+static inline uint32_t lzReadUInt32(const uint8_t *pointer)
+{
+    uint32_t result;
+    memcpy(&result, pointer, 4);
+    return result;
+}
+
+static inline uint32_t lzHash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZHashBits);
+}
+
+static uint8_t *lzWriteExtendedLength(uint8_t *output, size_t length)
+{
+    while(length >= 0xFF)
+    {
+        *output++ = 0xFF;
+        length -= 0xFF;
+    }
+
+    *output++ = uint8_t(length);
+    return output;
+}
+
+static bool lzReadExtendedLength(const uint8_t *&input, const uint8_t *inputEnd, size_t &length)
+{
+    uint8_t byte = 0;
+    do
+    {
+        if(input == inputEnd)
+            return false;
+
+        byte = *input++;
+        length += byte;
+    } while(byte == 0xFF);
+
+    return true;
+}
+
+static uint8_t *lzWriteSequence(uint8_t *output, const uint8_t *literals, size_t literalCount, size_t matchOffset, size_t matchLength)
+{
+    auto token = output++;
+    *token = uint8_t(std::min(literalCount, size_t(15)) << 4);
+    if(literalCount >= 15)
+        output = lzWriteExtendedLength(output, literalCount - 15);
+
+    memcpy(output, literals, literalCount);
+    output += literalCount;
+
+    // The last sequence does not have a match.
+    if(matchLength == 0)
+        return output;
+
+    *output++ = uint8_t(matchOffset);
+    *output++ = uint8_t(matchOffset >> 8);
+
+    auto encodedMatchLength = matchLength - LZMinMatchLength;
+    *token |= uint8_t(std::min(encodedMatchLength, size_t(15)));
+    if(encodedMatchLength >= 15)
+        output = lzWriteExtendedLength(output, encodedMatchLength - 15);
+    return output;
+}
+
+static size_t lzCompressBound(size_t sourceSize)
+{
+    return sourceSize + sourceSize / 255 + 16;
+}
+
+static size_t lzCompress(const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t destinationCapacity)
+{
+    if(destinationCapacity < lzCompressBound(sourceSize))
+        return 0;
+
+    uint32_t hashTable[1 << LZHashBits] = {};
+    auto output = destination;
+    size_t anchor = 0;
+    size_t position = 0;
+
+    if(sourceSize > LZMatchSearchEndMargin)
+    {
+        auto matchSearchEnd = sourceSize - LZMatchSearchEndMargin;
+        auto matchEnd = sourceSize - LZLastLiteralsSize;
+        while(position < matchSearchEnd)
+        {
+            auto sequence = lzReadUInt32(source + position);
+            auto &hashEntry = hashTable[lzHash(sequence)];
+            size_t candidate = hashEntry;
+            hashEntry = uint32_t(position);
+
+            if(candidate >= position || position - candidate > LZMaxMatchOffset || lzReadUInt32(source + candidate) != sequence)
+            {
+                // Skip faster through incompressible data.
+                position += 1 + ((position - anchor) >> 6);
+                continue;
+            }
+
+            // Extend the match backwards into the pending literals.
+            while(position > anchor && candidate > 0 && source[position - 1] == source[candidate - 1])
+            {
+                --position;
+                --candidate;
+            }
+
+            auto matchLength = LZMinMatchLength;
+            while(position + matchLength < matchEnd && source[position + matchLength] == source[candidate + matchLength])
+                ++matchLength;
+
+            output = lzWriteSequence(output, source + anchor, position - anchor, position - candidate, matchLength);
+            position += matchLength;
+            anchor = position;
+        }
+    }
+
+    output = lzWriteSequence(output, source + anchor, sourceSize - anchor, 0, 0);
+    return size_t(output - destination);
+}
+
+static bool lzDecompress(const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t destinationSize)
+{
+    auto input = source;
+    auto inputEnd = source + sourceSize;
+    auto output = destination;
+    auto outputEnd = destination + destinationSize;
+
+    while(input < inputEnd)
+    {
+        auto token = *input++;
+        size_t literalCount = token >> 4;
+        if(literalCount == 15 && !lzReadExtendedLength(input, inputEnd, literalCount))
+            return false;
+
+        if(size_t(inputEnd - input) < literalCount || size_t(outputEnd - output) < literalCount)
+            return false;
+
+        memcpy(output, input, literalCount);
+        input += literalCount;
+        output += literalCount;
+
+        // Is this the last sequence?
+        if(input == inputEnd)
+            break;
+
+        if(inputEnd - input < 2)
+            return false;
+
+        size_t matchOffset = size_t(input[0]) | (size_t(input[1]) << 8);
+        input += 2;
+        if(matchOffset == 0 || matchOffset > size_t(output - destination))
+            return false;
+
+        size_t matchLength = token & 15;
+        if(matchLength == 15 && !lzReadExtendedLength(input, inputEnd, matchLength))
+            return false;
+        matchLength += LZMinMatchLength;
+        if(size_t(outputEnd - output) < matchLength)
+            return false;
+
+        // Overlapping matches are used for encoding repetitions, so they have to be copied sequentially.
+        auto match = output - matchOffset;
+        if(matchOffset >= matchLength)
+        {
+            memcpy(output, match, matchLength);
+        }
+        else
+        {
+            for(size_t i = 0; i < matchLength; ++i)
+                output[i] = match[i];
+        }
+        output += matchLength;
+    }
+
+    return output == outputEnd;
+}
+
+#pragma endregion LZCodec
+
+#ifdef COAL_HAS_ZLIB
+#pragma region ZlibCodec
+
+static size_t zlibCompress(const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t destinationCapacity, int level)
+{
+    uLongf destinationSize = uLongf(destinationCapacity);
+    if(compress2(destination, &destinationSize, source, uLong(sourceSize), level < 0 ? Z_DEFAULT_COMPRESSION : std::min(level, Z_BEST_COMPRESSION)) != Z_OK)
+        return 0;
+
+    return size_t(destinationSize);
+}
+
+static bool zlibDecompress(const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t destinationSize)
+{
+    uLongf decompressedSize = uLongf(destinationSize);
+    return uncompress(destination, &decompressedSize, source, uLong(sourceSize)) == Z_OK && decompressedSize == destinationSize;
+}
+
+#pragma endregion ZlibCodec
+#endif
+
+#ifdef COAL_HAS_ZSTD
+#pragma region ZstdCodec
+
+static size_t zstdCompress(const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t destinationCapacity, int level)
+{
+    auto result = ZSTD_compress(destination, destinationCapacity, source, sourceSize, level < 0 ? ZSTD_CLEVEL_DEFAULT : std::min(level, ZSTD_maxCLevel()));
+    return ZSTD_isError(result) ? 0 : result;
+}
+
+static bool zstdDecompress(const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t destinationSize)
+{
+    auto result = ZSTD_decompress(destination, destinationSize, source, sourceSize);
+    return !ZSTD_isError(result) && result == destinationSize;
+}
+
+#pragma endregion ZstdCodec
+#endif
+
+#pragma region CompressionCodec
+
+bool isCompressionCodecSupported(CompressionCodec codec)
+{
+    switch(codec)
+    {
+    case CompressionCodec::None:
+    case CompressionCodec::LZ:
+        return true;
+#ifdef COAL_HAS_ZLIB
+    case CompressionCodec::Zlib:
+        return true;
+#endif
+#ifdef COAL_HAS_ZSTD
+    case CompressionCodec::Zstd:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+size_t compressBound(CompressionCodec codec, size_t sourceSize)
+{
+    switch(codec)
+    {
+    case CompressionCodec::LZ:
+        return lzCompressBound(sourceSize);
+#ifdef COAL_HAS_ZLIB
+    case CompressionCodec::Zlib:
+        return size_t(::compressBound(uLong(sourceSize)));
+#endif
+#ifdef COAL_HAS_ZSTD
+    case CompressionCodec::Zstd:
+        return ZSTD_compressBound(sourceSize);
+#endif
+    default:
+        return sourceSize;
+    }
+}
+
+size_t compressBlock(CompressionCodec codec, const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t destinationCapacity, int level)
+{
+    (void)level;
+    switch(codec)
+    {
+    case CompressionCodec::LZ:
+        return lzCompress(source, sourceSize, destination, destinationCapacity);
+#ifdef COAL_HAS_ZLIB
+    case CompressionCodec::Zlib:
+        return zlibCompress(source, sourceSize, destination, destinationCapacity, level);
+#endif
+#ifdef COAL_HAS_ZSTD
+    case CompressionCodec::Zstd:
+        return zstdCompress(source, sourceSize, destination, destinationCapacity, level);
+#endif
+    default:
+        return 0;
+    }
+}
+
+bool decompressBlock(CompressionCodec codec, const uint8_t *source, size_t sourceSize, uint8_t *destination, size_t destinationSize)
+{
+    switch(codec)
+    {
+    case CompressionCodec::LZ:
+        return lzDecompress(source, sourceSize, destination, destinationSize);
+#ifdef COAL_HAS_ZLIB
+    case CompressionCodec::Zlib:
+        return zlibDecompress(source, sourceSize, destination, destinationSize);
+#endif
+#ifdef COAL_HAS_ZSTD
+    case CompressionCodec::Zstd:
+        return zstdDecompress(source, sourceSize, destination, destinationSize);
+#endif
+    default:
+        return false;
+    }
+}
+
+#pragma endregion CompressionCodec
+
+#pragma region CompressingWriteStream
+
+CompressingWriteStream::CompressingWriteStream(WriteStream *initialTarget, CompressionCodec initialCodec, size_t initialThreadCount)
+    : target(initialTarget), codec(initialCodec)
+{
+    assert(isCompressionCodecSupported(codec));
+    chunks.resize(std::max(initialThreadCount, size_t(1)));
+    chunks.front().data.reserve(ChunkSize);
+}
+
+CompressingWriteStream::~CompressingWriteStream()
+{
+    {
+        std::unique_lock<std::mutex> lock(workerMutex);
+        stoppingWorkers = true;
+    }
+    batchStartedCondition.notify_all();
+
+    for(auto &worker : workers)
+        worker.join();
+}
+
+void CompressingWriteStream::writeBytes(const uint8_t *data, size_t size)
+{
+    while(size > 0)
+    {
+        auto &buffer = chunks[pendingChunkCount].data;
+        auto copySize = std::min(size, ChunkSize - buffer.size());
+        buffer.insert(buffer.end(), data, data + copySize);
+        data += copySize;
+        size -= copySize;
+
+        if(buffer.size() == ChunkSize && ++pendingChunkCount == chunks.size())
+            flushPendingChunks();
+    }
+}
+
+void CompressingWriteStream::setCompressionLevel(int newLevel)
+{
+    level = newLevel;
+}
+
+void CompressingWriteStream::finish()
+{
+    if(!chunks[pendingChunkCount].data.empty())
+        ++pendingChunkCount;
+    flushPendingChunks();
+    target->writeUInt32(0);
+}
+
+void CompressingWriteStream::compressChunk(Chunk &chunk)
+{
+    chunk.compressedData.resize(compressBound(codec, chunk.data.size()));
+    chunk.compressedSize = compressBlock(codec, chunk.data.data(), chunk.data.size(), chunk.compressedData.data(), chunk.compressedData.size(), level);
+}
+
+void CompressingWriteStream::compressChunksInWorker(size_t chunkIndex)
+{
+    uint64_t processedGeneration = 0;
+    std::unique_lock<std::mutex> lock(workerMutex);
+    for(;;)
+    {
+        batchStartedCondition.wait(lock, [&]() { return stoppingWorkers || batchGeneration != processedGeneration; });
+        if(stoppingWorkers)
+            return;
+
+        // The last batch of a stream can have fewer chunks than workers.
+        processedGeneration = batchGeneration;
+        if(chunkIndex >= batchChunkCount)
+            continue;
+
+        lock.unlock();
+        compressChunk(chunks[chunkIndex]);
+        lock.lock();
+
+        if(--remainingWorkerChunkCount == 0)
+            batchFinishedCondition.notify_one();
+    }
+}
+
+void CompressingWriteStream::flushPendingChunks()
+{
+    if(pendingChunkCount == 0)
+        return;
+
+    // The chunks are independent, so they can be compressed in parallel. The first one is compressed by the calling thread.
+    if(pendingChunkCount > 1)
+    {
+        if(workers.empty())
+        {
+            workers.reserve(chunks.size() - 1);
+            for(size_t i = 1; i < chunks.size(); ++i)
+                workers.emplace_back([this, i]() { compressChunksInWorker(i); });
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(workerMutex);
+            batchChunkCount = pendingChunkCount;
+            remainingWorkerChunkCount = pendingChunkCount - 1;
+            ++batchGeneration;
+        }
+        batchStartedCondition.notify_all();
+    }
+
+    compressChunk(chunks[0]);
+
+    if(pendingChunkCount > 1)
+    {
+        std::unique_lock<std::mutex> lock(workerMutex);
+        batchFinishedCondition.wait(lock, [this]() { return remainingWorkerChunkCount == 0; });
+    }
+
+    // Chunks that do not get smaller are stored, which is signaled by having the same raw and stored sizes.
+    for(size_t i = 0; i < pendingChunkCount; ++i)
+    {
+        auto &chunk = chunks[i];
+        target->writeUInt32(uint32_t(chunk.data.size()));
+        if(chunk.compressedSize == 0 || chunk.compressedSize >= chunk.data.size())
+        {
+            target->writeUInt32(uint32_t(chunk.data.size()));
+            target->writeBytes(chunk.data.data(), chunk.data.size());
+        }
+        else
+        {
+            target->writeUInt32(uint32_t(chunk.compressedSize));
+            target->writeBytes(chunk.compressedData.data(), chunk.compressedSize);
+        }
+
+        chunk.data.clear();
+    }
+
+    pendingChunkCount = 0;
+}
+
+#pragma endregion CompressingWriteStream
+
+#pragma region DecompressingReadStream
+
+DecompressingReadStream::DecompressingReadStream(ReadStream *initialSource, CompressionCodec initialCodec)
+    : source(initialSource), codec(initialCodec)
+{
+}
+
+bool DecompressingReadStream::readBytes(uint8_t *buffer, size_t size)
+{
+    while(size > 0)
+    {
+        if(position == chunk.size() && !readChunk())
+            return false;
+
+        auto copySize = std::min(size, chunk.size() - position);
+        memcpy(buffer, chunk.data() + position, copySize);
+        buffer += copySize;
+        position += copySize;
+        size -= copySize;
+    }
+
+    return true;
+}
+
+bool DecompressingReadStream::skipBytes(size_t size)
+{
+    while(size > 0)
+    {
+        if(position == chunk.size() && !readChunk())
+            return false;
+
+        auto skipSize = std::min(size, chunk.size() - position);
+        position += skipSize;
+        size -= skipSize;
+    }
+
+    return true;
+}
+
+bool DecompressingReadStream::finish()
+{
+    if(position != chunk.size())
+        return false;
+
+    if(hasReachedEnd)
+        return true;
+
+    uint32_t rawSize = 0;
+    return source->readUInt32(rawSize) && rawSize == 0;
+}
+
+bool DecompressingReadStream::readChunk()
+{
+    if(hasReachedEnd)
+        return false;
+
+    uint32_t rawSize = 0;
+    if(!source->readUInt32(rawSize))
+        return false;
+
+    if(rawSize == 0)
+    {
+        hasReachedEnd = true;
+        return false;
+    }
+
+    uint32_t storedSize = 0;
+    if(!source->readUInt32(storedSize) || storedSize > rawSize || rawSize > MaxChunkSize)
+        return false;
+
+    chunk.resize(rawSize);
+    position = 0;
+    if(storedSize == rawSize)
+        return source->readBytes(chunk.data(), rawSize);
+
+    compressedChunk.resize(storedSize);
+    return source->readBytes(compressedChunk.data(), storedSize) &&
+        decompressBlock(codec, compressedChunk.data(), storedSize, chunk.data(), rawSize);
+}
+
+#pragma endregion DecompressingReadStream
+
+} // End of namespace coal
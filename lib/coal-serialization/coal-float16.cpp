@@ -0,0 +1,247 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2021 Desarrollo de Software Ronie Salgado Faila E.I.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "coal-serialization/coal.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#   define COAL_FLOAT16_X86
+#   include <immintrin.h>
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#       define COAL_FLOAT16_TARGET
+#   else
+#       include <cpuid.h>
+#       define COAL_FLOAT16_TARGET __attribute__((target("avx,f16c")))
+#   endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#   define COAL_FLOAT16_ARM
+#   include <arm_neon.h>
+#   define COAL_FLOAT16_TARGET
+#endif
+
+namespace coal
+{
+
+#pragma region Float16Scalar
+
+uint16_t float32ToFloat16(float value)
+{
+    uint32_t bits = 0;
+    memcpy(&bits, &value, 4);
+
+    auto sign = (bits >> 16) & 0x8000;
+    auto exponent = (bits >> 23) & 0xFF;
+    auto mantissa = bits & 0x7FFFFF;
+
+    // Infinity and NaN. The NaNs are quieted, like with the conversion instructions.
+    if(exponent == 0xFF)
+        return uint16_t(sign | 0x7C00 | (mantissa ? 0x200 | (mantissa >> 13) : 0));
+
+    auto halfExponent = int32_t(exponent) - 127 + 15;
+    if(halfExponent >= 0x1F)
+        return uint16_t(sign | 0x7C00);
+
+    // Subnormal results, including the values that are rounded to zero.
+    if(halfExponent <= 0)
+    {
+        if(halfExponent < -10)
+            return uint16_t(sign);
+
+        mantissa |= 0x800000;
+        auto shift = uint32_t(14 - halfExponent);
+        auto halfMantissa = mantissa >> shift;
+        auto remainder = mantissa & ((1u << shift) - 1);
+        auto halfway = 1u << (shift - 1);
+        if(remainder > halfway || (remainder == halfway && (halfMantissa & 1)))
+            ++halfMantissa;
+        return uint16_t(sign | halfMantissa);
+    }
+
+    // The rounding carry may propagate into the exponent, which yields the correct result, up to infinity.
+    auto half = sign | (uint32_t(halfExponent) << 10) | (mantissa >> 13);
+    auto remainder = mantissa & 0x1FFF;
+    if(remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        ++half;
+    return uint16_t(half);
+}
+
+float float16ToFloat32(uint16_t value)
+{
+    auto sign = uint32_t(value & 0x8000) << 16;
+    auto exponent = uint32_t(value >> 10) & 0x1F;
+    auto mantissa = uint32_t(value) & 0x3FF;
+
+    uint32_t bits = 0;
+    if(exponent == 0x1F)
+    {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+        if(mantissa)
+            bits |= 0x400000;
+    }
+    else if(exponent == 0)
+    {
+        if(mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // Normalize the subnormal value.
+            exponent = 127 - 15 + 1;
+            while((mantissa & 0x400) == 0)
+            {
+                mantissa <<= 1;
+                --exponent;
+            }
+
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+        }
+    }
+    else
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float result = 0;
+    memcpy(&result, &bits, 4);
+    return result;
+}
+
+#pragma endregion Float16Scalar
+
+#pragma region Float16Hardware
+
+#if defined(COAL_FLOAT16_X86) || defined(COAL_FLOAT16_ARM)
+
+COAL_FLOAT16_TARGET static void convertFloat32ToFloat16Hardware(const float *source, uint16_t *destination, size_t count)
+{
+    size_t i = 0;
+#ifdef COAL_FLOAT16_X86
+    for(; i + 8 <= count; i += 8)
+        _mm_storeu_si128(reinterpret_cast<__m128i*> (destination + i), _mm256_cvtps_ph(_mm256_loadu_ps(source + i), _MM_FROUND_TO_NEAREST_INT));
+#else
+    for(; i + 4 <= count; i += 4)
+        vst1_u16(destination + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(source + i))));
+#endif
+
+    for(; i < count; ++i)
+        destination[i] = float32ToFloat16(source[i]);
+}
+
+COAL_FLOAT16_TARGET static void convertFloat16ToFloat32Hardware(const uint16_t *source, float *destination, size_t count)
+{
+    size_t i = 0;
+#ifdef COAL_FLOAT16_X86
+    for(; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(destination + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*> (source + i))));
+#else
+    for(; i + 4 <= count; i += 4)
+        vst1q_f32(destination + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(source + i))));
+#endif
+
+    for(; i < count; ++i)
+        destination[i] = float16ToFloat32(source[i]);
+}
+
+#endif
+
+static bool detectHardwareFloat16Conversion()
+{
+#if defined(COAL_FLOAT16_X86)
+    // F16C uses the VEX encoding, so the operating system must also save the AVX registers.
+#   ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    auto ecx = unsigned(info[2]);
+#   else
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+#   endif
+    const unsigned int requiredFeatures = (1u << 27) | (1u << 28) | (1u << 29); // OSXSAVE, AVX and F16C.
+    if((ecx & requiredFeatures) != requiredFeatures)
+        return false;
+
+#   ifdef _MSC_VER
+    auto enabledStates = _xgetbv(0);
+#   else
+    uint32_t enabledStatesLow = 0, enabledStatesHigh = 0;
+    __asm__ volatile("xgetbv" : "=a"(enabledStatesLow), "=d"(enabledStatesHigh) : "c"(0));
+    auto enabledStates = enabledStatesLow;
+#   endif
+    return (enabledStates & 6) == 6;
+#elif defined(COAL_FLOAT16_ARM)
+    return true;
+#else
+    return false;
+#endif
+}
+
+#pragma endregion Float16Hardware
+
+#pragma region Float16Arrays
+
+bool isFloat16ConversionHardwareAccelerated()
+{
+    static bool result = detectHardwareFloat16Conversion();
+    return result;
+}
+
+void convertFloat32ToFloat16(const float *source, uint16_t *destination, size_t count)
+{
+#if defined(COAL_FLOAT16_X86) || defined(COAL_FLOAT16_ARM)
+    if(isFloat16ConversionHardwareAccelerated())
+        return convertFloat32ToFloat16Hardware(source, destination, count);
+#endif
+    for(size_t i = 0; i < count; ++i)
+        destination[i] = float32ToFloat16(source[i]);
+}
+
+void convertFloat16ToFloat32(const uint16_t *source, float *destination, size_t count)
+{
+#if defined(COAL_FLOAT16_X86) || defined(COAL_FLOAT16_ARM)
+    if(isFloat16ConversionHardwareAccelerated())
+        return convertFloat16ToFloat32Hardware(source, destination, count);
+#endif
+    for(size_t i = 0; i < count; ++i)
+        destination[i] = float16ToFloat32(source[i]);
+}
+
+#pragma endregion Float16Arrays
+
+#pragma region Float16TypeMapper
+
+TypeMapperPtr Float16TypeMapper::uniqueInstance()
+{
+    static auto singleton = std::make_shared<Float16TypeMapper> ();
+    return singleton;
+}
+
+void Float16TypeMapper::writeFieldWith(void *fieldPointer, WriteStream *output)
+{
+    output->writeUInt16(float32ToFloat16(*reinterpret_cast<float*> (fieldPointer)));
+}
+
+#pragma endregion Float16TypeMapper
+
+} // End of namespace coal
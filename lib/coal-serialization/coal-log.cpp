@@ -0,0 +1,436 @@
+/**
+ * The MIT License (MIT)
+ * Copyright (c) 2021 Desarrollo de Software Ronie Salgado Faila E.I.R.L.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "coal-serialization/coal-log.hpp"
+#include "coal-serialization/coal-checksum.hpp"
+#include <filesystem>
+
+#ifdef _WIN32
+#   define WIN32_LEAN_AND_MEAN
+#   define NOMINMAX
+#   include <windows.h>
+#else
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#endif
+
+namespace coal
+{
+
+static constexpr size_t CoalLogHeaderSize = 8;
+static constexpr size_t CoalLogRecordHeaderSize = 16;
+static constexpr size_t CoalLogIndexEntrySize = 16;
+static constexpr size_t CoalLogIndexTrailerSize = 16;
+
+#pragma region CoalLogFormat
+
+struct CoalLogRecordHeader
+{
+    uint32_t size = 0;
+    uint32_t checksum = 0;
+    uint64_t timestamp = 0;
+};
+
+static bool readLogRecordHeader(const uint8_t *data, size_t dataSize, uint64_t offset, CoalLogRecordHeader &header)
+{
+    if(offset > dataSize || dataSize - offset < CoalLogRecordHeaderSize)
+        return false;
+
+    MemoryReadStream input(data + offset, CoalLogRecordHeaderSize);
+    return input.readUInt32(header.size) &&
+        input.readUInt32(header.checksum) &&
+        input.readUInt64(header.timestamp) &&
+        header.size <= dataSize - offset - CoalLogRecordHeaderSize;
+}
+
+/**
+ * I read the index footer. I fail when it is absent or inconsistent with the records.
+ */
+static bool parseLogIndex(const uint8_t *data, size_t dataSize, std::vector<CoalLogRecordEntry> &entries, uint64_t &indexOffset)
+{
+    if(dataSize < CoalLogHeaderSize + CoalLogIndexTrailerSize)
+        return false;
+
+    uint32_t recordCount = 0;
+    uint32_t magicNumber = 0;
+    MemoryReadStream trailerInput(data + dataSize - CoalLogIndexTrailerSize, CoalLogIndexTrailerSize);
+    if(!trailerInput.readUInt64(indexOffset) ||
+        !trailerInput.readUInt32(recordCount) ||
+        !trailerInput.readUInt32(magicNumber) ||
+        magicNumber != CoalLogIndexMagicNumber ||
+        indexOffset < CoalLogHeaderSize ||
+        indexOffset > dataSize - CoalLogIndexTrailerSize ||
+        (dataSize - CoalLogIndexTrailerSize - indexOffset) != uint64_t(recordCount)*CoalLogIndexEntrySize)
+        return false;
+
+    entries.resize(recordCount);
+    MemoryReadStream indexInput(data + indexOffset, size_t(recordCount)*CoalLogIndexEntrySize);
+    uint64_t nextRecordOffset = CoalLogHeaderSize;
+    for(auto &entry : entries)
+    {
+        CoalLogRecordHeader recordHeader;
+        if(!indexInput.readUInt64(entry.offset) ||
+            !indexInput.readUInt64(entry.timestamp) ||
+            entry.offset != nextRecordOffset ||
+            !readLogRecordHeader(data, size_t(indexOffset), entry.offset, recordHeader))
+            return false;
+
+        nextRecordOffset = entry.offset + CoalLogRecordHeaderSize + recordHeader.size;
+    }
+
+    return nextRecordOffset == indexOffset;
+}
+
+/**
+ * I read the entries of a log, from its index or by scanning its records. I return the offset of the end of the last valid record.
+ */
+static bool parseLogEntries(const uint8_t *data, size_t dataSize, std::vector<CoalLogRecordEntry> &entries, uint64_t &endOffset)
+{
+    entries.clear();
+
+    uint32_t magicNumber;
+    uint8_t versionMajor, versionMinor;
+    uint16_t reserved;
+    MemoryReadStream headerInput(data, dataSize);
+    if(!headerInput.readUInt32(magicNumber) || magicNumber != CoalLogMagicNumber ||
+        !headerInput.readUInt8(versionMajor) || versionMajor != CoalLogVersionMajor ||
+        !headerInput.readUInt8(versionMinor) || versionMinor > CoalLogVersionMinor ||
+        !headerInput.readUInt16(reserved))
+        return false;
+
+    if(parseLogIndex(data, dataSize, entries, endOffset))
+        return true;
+
+    // The log was not closed. Recover the records up to the first torn or corrupted one.
+    entries.clear();
+    endOffset = CoalLogHeaderSize;
+    CoalLogRecordHeader recordHeader;
+    while(readLogRecordHeader(data, dataSize, endOffset, recordHeader))
+    {
+        if(crc32c(data + endOffset + CoalLogRecordHeaderSize, recordHeader.size) != recordHeader.checksum)
+            break;
+
+        entries.push_back(CoalLogRecordEntry{endOffset, recordHeader.timestamp});
+        endOffset += CoalLogRecordHeaderSize + recordHeader.size;
+    }
+
+    return true;
+}
+
+#pragma endregion CoalLogFormat
+
+#pragma region MemoryMappedFile
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+    close();
+}
+
+bool MemoryMappedFile::open(const std::string &path)
+{
+    close();
+
+#ifdef _WIN32
+    auto fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(fileHandle, &fileSize))
+    {
+        CloseHandle(fileHandle);
+        return false;
+    }
+
+    // Empty files cannot be mapped.
+    if(fileSize.QuadPart == 0)
+    {
+        CloseHandle(fileHandle);
+        return true;
+    }
+
+    auto mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(fileHandle);
+    if(!mappingHandle)
+        return false;
+
+    auto view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mappingHandle);
+    if(!view)
+        return false;
+
+    data = static_cast<const uint8_t*> (view);
+    size = size_t(fileSize.QuadPart);
+#else
+    int fileDescriptor = ::open(path.c_str(), O_RDONLY);
+    if(fileDescriptor < 0)
+        return false;
+
+    struct stat fileStat;
+    if(fstat(fileDescriptor, &fileStat) != 0)
+    {
+        ::close(fileDescriptor);
+        return false;
+    }
+
+    // Empty files cannot be mapped.
+    if(fileStat.st_size == 0)
+    {
+        ::close(fileDescriptor);
+        return true;
+    }
+
+    auto mapping = mmap(nullptr, size_t(fileStat.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    ::close(fileDescriptor);
+    if(mapping == MAP_FAILED)
+        return false;
+
+    data = static_cast<const uint8_t*> (mapping);
+    size = size_t(fileStat.st_size);
+#endif
+
+    return true;
+}
+
+void MemoryMappedFile::close()
+{
+    if(data)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+#else
+        munmap(const_cast<uint8_t*> (data), size);
+#endif
+    }
+
+    data = nullptr;
+    size = 0;
+}
+
+#pragma endregion MemoryMappedFile
+
+#pragma region CoalLogWriter
+
+CoalLogWriter::CoalLogWriter()
+    : recordOutput(recordData), serializer(&recordOutput)
+{
+}
+
+CoalLogWriter::~CoalLogWriter()
+{
+    close();
+}
+
+bool CoalLogWriter::open(const std::string &path)
+{
+    close();
+    entries.clear();
+    fileSize = 0;
+
+    std::error_code error;
+    if(std::filesystem::exists(path, error))
+    {
+        MemoryMappedFile existingFile;
+        if(!existingFile.open(path))
+            return false;
+
+        if(existingFile.getSize() > 0 && !parseLogEntries(existingFile.getData(), existingFile.getSize(), entries, fileSize))
+            return false;
+    }
+
+    if(fileSize == 0)
+    {
+        file = fopen(path.c_str(), "wb");
+        if(!file)
+            return false;
+
+        std::vector<uint8_t> header;
+        MemoryWriteStream headerOutput(header);
+        headerOutput.writeUInt32(CoalLogMagicNumber);
+        headerOutput.writeUInt8(CoalLogVersionMajor);
+        headerOutput.writeUInt8(CoalLogVersionMinor);
+        headerOutput.writeUInt16(0); // Reserved
+        return writeData(header.data(), header.size());
+    }
+
+    // Drop the index footer, or the torn last record.
+    std::filesystem::resize_file(path, fileSize, error);
+    if(error)
+        return false;
+
+    file = fopen(path.c_str(), "ab");
+    return file != nullptr;
+}
+
+bool CoalLogWriter::close()
+{
+    if(!file)
+        return true;
+
+    std::vector<uint8_t> index;
+    MemoryWriteStream indexOutput(index);
+    for(auto &entry : entries)
+    {
+        indexOutput.writeUInt64(entry.offset);
+        indexOutput.writeUInt64(entry.timestamp);
+    }
+    indexOutput.writeUInt64(fileSize);
+    indexOutput.writeUInt32(uint32_t(entries.size()));
+    indexOutput.writeUInt32(CoalLogIndexMagicNumber);
+
+    auto success = fwrite(index.data(), 1, index.size(), file) == index.size();
+    success = fclose(file) == 0 && success;
+    file = nullptr;
+    return success;
+}
+
+bool CoalLogWriter::isOpen() const
+{
+    return file != nullptr;
+}
+
+bool CoalLogWriter::flush()
+{
+    return file && fflush(file) == 0;
+}
+
+Serializer &CoalLogWriter::getSerializer()
+{
+    return serializer;
+}
+
+bool CoalLogWriter::writeData(const void *data, size_t size)
+{
+    if(fwrite(data, 1, size, file) != size)
+        return false;
+
+    fileSize += size;
+    return true;
+}
+
+bool CoalLogWriter::appendRecordData(const uint8_t *data, size_t size, uint64_t timestamp)
+{
+    if(!file || size > UINT32_MAX)
+        return false;
+
+    std::vector<uint8_t> header;
+    MemoryWriteStream headerOutput(header);
+    headerOutput.writeUInt32(uint32_t(size));
+    headerOutput.writeUInt32(crc32c(data, size));
+    headerOutput.writeUInt64(timestamp);
+
+    auto offset = fileSize;
+    if(!writeData(header.data(), header.size()) || !writeData(data, size))
+        return false;
+
+    entries.push_back(CoalLogRecordEntry{offset, timestamp});
+    return true;
+}
+
+size_t CoalLogWriter::getRecordCount() const
+{
+    return entries.size();
+}
+
+#pragma endregion CoalLogWriter
+
+#pragma region CoalLogReader
+
+CoalLogReader::CoalLogReader()
+    : deserializer(nullptr)
+{
+}
+
+bool CoalLogReader::open(const std::string &path)
+{
+    close();
+    uint64_t endOffset = 0;
+    if(!mappedFile.open(path) ||
+        !parseLogEntries(mappedFile.getData(), mappedFile.getSize(), entries, endOffset))
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void CoalLogReader::close()
+{
+    entries.clear();
+    mappedFile.close();
+}
+
+size_t CoalLogReader::getRecordCount() const
+{
+    return entries.size();
+}
+
+uint64_t CoalLogReader::getRecordTimestamp(size_t index) const
+{
+    assert(index < entries.size());
+    return entries[index].timestamp;
+}
+
+size_t CoalLogReader::findFirstRecordAtOrAfter(uint64_t timestamp) const
+{
+    auto it = std::lower_bound(entries.begin(), entries.end(), timestamp, [](const CoalLogRecordEntry &entry, uint64_t value) {
+        return entry.timestamp < value;
+    });
+    return size_t(it - entries.begin());
+}
+
+bool CoalLogReader::getRecordData(size_t index, const uint8_t *&data, size_t &size) const
+{
+    if(index >= entries.size())
+        return false;
+
+    CoalLogRecordHeader recordHeader;
+    auto offset = entries[index].offset;
+    if(!readLogRecordHeader(mappedFile.getData(), mappedFile.getSize(), offset, recordHeader))
+        return false;
+
+    data = mappedFile.getData() + offset + CoalLogRecordHeaderSize;
+    size = recordHeader.size;
+    return crc32c(data, size) == recordHeader.checksum;
+}
+
+ObjectMapperPtr CoalLogReader::readWithRootObject(size_t index, const TypeMapperPtr &rootTypeMapper)
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    if(!getRecordData(index, data, size))
+        return nullptr;
+
+    MemoryReadStream input(data, size);
+    deserializer.reset(&input);
+    auto result = deserializer.deserializeRootObject(rootTypeMapper);
+    deserializer.reset(nullptr);
+    return result;
+}
+
+#pragma endregion CoalLogReader
+
+} // End of namespace coal
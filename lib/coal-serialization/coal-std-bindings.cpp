@@ -84,6 +84,289 @@ TypeDescriptorPtr StdStringTypeMapper::getOrCreateTypeDescriptor(TypeDescriptorC
     return context->getOrCreatePrimitiveTypeDescriptor(TypeDescriptorKind::UTF8_32_32);
 }
 
+TypeMapperPtr StdStringViewTypeMapper::uniqueInstance()
+{
+    static auto singleton = std::make_shared<StdStringViewTypeMapper> ();
+    return singleton;
+}
+
+StdStringViewTypeMapper::StdStringViewTypeMapper()
+{
+    name = typeDescriptorKindToString(TypeDescriptorKind::UTF8_32_32);
+}
+
+std::string StdStringViewTypeMapper::getQualifiedName() const
+{
+    return "std::string_view";
+}
+
+void StdStringViewTypeMapper::writeFieldWith(void *fieldPointer, WriteStream *output)
+{
+    // UTF8_32_32 has the same layout as Binary_32_32.
+    auto string = reinterpret_cast<std::string_view*> (fieldPointer);
+    output->writeBinary_32_32(reinterpret_cast<const uint8_t*> (string->data()), string->size());
+}
+
+void StdStringViewTypeMapper::pushFieldDataIntoBinaryBlob(void *fieldPointer, BinaryBlobBuilder &binaryBlobBuilder)
+{
+    auto string = reinterpret_cast<std::string_view*> (fieldPointer);
+    binaryBlobBuilder.pushBytes(reinterpret_cast<const uint8_t*> (string->data()), std::min(string->size(), size_t(0xFFFFFFFF)));
+}
+
+bool StdStringViewTypeMapper::canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const
+{
+    switch(encoding->kind)
+    {
+    case TypeDescriptorKind::UTF8_32_8:
+    case TypeDescriptorKind::UTF8_32_16:
+    case TypeDescriptorKind::UTF8_32_32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool StdStringViewTypeMapper::readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input)
+{
+    if(!input->areBinaryBlobViewsEnabled())
+        return false;
+
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+    switch(fieldEncoding->kind)
+    {
+    case TypeDescriptorKind::UTF8_32_8:
+        if(!input->readBinary_32_8(data, size))
+            return false;
+        break;
+    case TypeDescriptorKind::UTF8_32_16:
+        if(!input->readBinary_32_16(data, size))
+            return false;
+        break;
+    case TypeDescriptorKind::UTF8_32_32:
+        if(!input->readBinary_32_32(data, size))
+            return false;
+        break;
+    default:
+        return false;
+    }
+
+    *reinterpret_cast<std::string_view*> (fieldPointer) = std::string_view(reinterpret_cast<const char*> (data), size);
+    return true;
+}
+
+TypeDescriptorPtr StdStringViewTypeMapper::getOrCreateTypeDescriptor(TypeDescriptorContext *context)
+{
+    return context->getOrCreatePrimitiveTypeDescriptor(TypeDescriptorKind::UTF8_32_32);
+}
+
+TypeMapperPtr StdSharedStringTypeMapper::uniqueInstance()
+{
+    static auto singleton = std::make_shared<StdSharedStringTypeMapper> ();
+    return singleton;
+}
+
+StdSharedStringTypeMapper::StdSharedStringTypeMapper()
+{
+    name = typeDescriptorKindToString(TypeDescriptorKind::UTF8_32_32);
+}
+
+std::string StdSharedStringTypeMapper::getQualifiedName() const
+{
+    return "std::shared_ptr<const std::string>";
+}
+
+void StdSharedStringTypeMapper::writeFieldWith(void *fieldPointer, WriteStream *output)
+{
+    auto &string = *reinterpret_cast<std::shared_ptr<const std::string>*> (fieldPointer);
+    output->writeUTF8_32_32(string ? *string : std::string());
+}
+
+void StdSharedStringTypeMapper::pushFieldDataIntoBinaryBlob(void *fieldPointer, BinaryBlobBuilder &binaryBlobBuilder)
+{
+    auto &string = *reinterpret_cast<std::shared_ptr<const std::string>*> (fieldPointer);
+    if(string)
+        binaryBlobBuilder.internString32(*string);
+}
+
+bool StdSharedStringTypeMapper::canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const
+{
+    switch(encoding->kind)
+    {
+    case TypeDescriptorKind::UTF8_32_8:
+    case TypeDescriptorKind::UTF8_32_16:
+    case TypeDescriptorKind::UTF8_32_32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool StdSharedStringTypeMapper::readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input)
+{
+    auto &destination = *reinterpret_cast<std::shared_ptr<const std::string>*> (fieldPointer);
+
+    switch(fieldEncoding->kind)
+    {
+    case TypeDescriptorKind::UTF8_32_8:
+        return input->readSharedUTF8_32_8(destination);
+    case TypeDescriptorKind::UTF8_32_16:
+        return input->readSharedUTF8_32_16(destination);
+    case TypeDescriptorKind::UTF8_32_32:
+        return input->readSharedUTF8_32_32(destination);
+    default:
+        return false;
+    }
+}
+
+TypeDescriptorPtr StdSharedStringTypeMapper::getOrCreateTypeDescriptor(TypeDescriptorContext *context)
+{
+    return context->getOrCreatePrimitiveTypeDescriptor(TypeDescriptorKind::UTF8_32_32);
+}
+
+TypeMapperPtr BytesViewTypeMapper::uniqueInstance()
+{
+    static auto singleton = std::make_shared<BytesViewTypeMapper> ();
+    return singleton;
+}
+
+BytesViewTypeMapper::BytesViewTypeMapper()
+{
+    name = typeDescriptorKindToString(TypeDescriptorKind::Binary_32_32);
+}
+
+std::string BytesViewTypeMapper::getQualifiedName() const
+{
+    return "coal::BytesView";
+}
+
+void BytesViewTypeMapper::writeFieldWith(void *fieldPointer, WriteStream *output)
+{
+    auto bytes = reinterpret_cast<BytesView*> (fieldPointer);
+    output->writeBinary_32_32(bytes->data(), bytes->size());
+}
+
+void BytesViewTypeMapper::pushFieldDataIntoBinaryBlob(void *fieldPointer, BinaryBlobBuilder &binaryBlobBuilder)
+{
+    auto bytes = reinterpret_cast<BytesView*> (fieldPointer);
+    binaryBlobBuilder.pushBytes(bytes->data(), std::min(bytes->size(), size_t(0xFFFFFFFF)));
+}
+
+bool BytesViewTypeMapper::canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const
+{
+    switch(encoding->kind)
+    {
+    case TypeDescriptorKind::Binary_32_8:
+    case TypeDescriptorKind::Binary_32_16:
+    case TypeDescriptorKind::Binary_32_32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool BytesViewTypeMapper::readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input)
+{
+    if(!input->areBinaryBlobViewsEnabled())
+        return false;
+
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+
+    switch(fieldEncoding->kind)
+    {
+    case TypeDescriptorKind::Binary_32_8:
+        if(!input->readBinary_32_8(data, size))
+            return false;
+        break;
+    case TypeDescriptorKind::Binary_32_16:
+        if(!input->readBinary_32_16(data, size))
+            return false;
+        break;
+    case TypeDescriptorKind::Binary_32_32:
+        if(!input->readBinary_32_32(data, size))
+            return false;
+        break;
+    default:
+        return false;
+    }
+
+    *reinterpret_cast<BytesView*> (fieldPointer) = BytesView(data, size);
+    return true;
+}
+
+TypeDescriptorPtr BytesViewTypeMapper::getOrCreateTypeDescriptor(TypeDescriptorContext *context)
+{
+    return context->getOrCreatePrimitiveTypeDescriptor(TypeDescriptorKind::Binary_32_32);
+}
+
+TypeMapperPtr Float16VectorTypeMapper::uniqueInstance()
+{
+    static auto singleton = std::make_shared<Float16VectorTypeMapper> ();
+    return singleton;
+}
+
+Float16VectorTypeMapper::Float16VectorTypeMapper()
+{
+    name = typeDescriptorKindToString(TypeDescriptorKind::Array32);
+}
+
+void Float16VectorTypeMapper::writeFieldWith(void *fieldPointer, WriteStream *output)
+{
+    auto &vector = *reinterpret_cast<std::vector<float>*> (fieldPointer);
+    output->writeUInt32(uint32_t(vector.size()));
+
+    uint16_t batch[ConversionBatchSize];
+    for(size_t i = 0; i < vector.size(); i += ConversionBatchSize)
+    {
+        auto batchSize = std::min(ConversionBatchSize, vector.size() - i);
+        convertFloat32ToFloat16(vector.data() + i, batch, batchSize);
+        output->writeBytes(reinterpret_cast<const uint8_t*> (batch), batchSize*2);
+    }
+}
+
+bool Float16VectorTypeMapper::canReadFieldWithTypeDescriptor(const TypeDescriptorPtr &encoding) const
+{
+    return typeMapperForType<std::vector<float>> ()->canReadFieldWithTypeDescriptor(encoding);
+}
+
+bool Float16VectorTypeMapper::readFieldWith(void *fieldPointer, const TypeDescriptorPtr &fieldEncoding, ReadStream *input)
+{
+    // Only the half precision elements are converted in batches.
+    if(fieldEncoding->kind != TypeDescriptorKind::Array32 ||
+        std::static_pointer_cast<ArrayTypeDescriptor> (fieldEncoding)->element->kind != TypeDescriptorKind::Float16)
+        return typeMapperForType<std::vector<float>> ()->readFieldWith(fieldPointer, fieldEncoding, input);
+
+    uint32_t count = 0;
+    if(!input->readUInt32(count))
+        return false;
+
+    auto &destination = *reinterpret_cast<std::vector<float>*> (fieldPointer);
+    destination.clear();
+
+    uint16_t batch[ConversionBatchSize];
+    for(size_t i = 0; i < count; i += ConversionBatchSize)
+    {
+        auto batchSize = std::min(ConversionBatchSize, size_t(count) - i);
+        if(!input->readBytes(reinterpret_cast<uint8_t*> (batch), batchSize*2))
+            return false;
+
+        // The vector grows with the read data, so that a corrupted count fails before allocating.
+        destination.resize(i + batchSize);
+        convertFloat16ToFloat32(batch, destination.data() + i, batchSize);
+    }
+
+    return true;
+}
+
+TypeDescriptorPtr Float16VectorTypeMapper::getOrCreateTypeDescriptor(TypeDescriptorContext *context)
+{
+    return context->getOrCreateArrayTypeDescriptor(TypeDescriptorKind::Array32,
+        context->getOrCreatePrimitiveTypeDescriptor(TypeDescriptorKind::Float16)
+    );
+}
+
 SharedObjectWrapper::SharedObjectWrapper(const ValueTypePtr &initialReference, const TypeMapperPtr &initialTypeMapper)
     : reference(initialReference), typeMapper(initialTypeMapper)
 {
@@ -101,9 +384,35 @@ void *SharedObjectWrapper::getObjectBasePointer()
 
 std::shared_ptr<void> SharedObjectWrapper::asObjectSharedPointer()
 {
+    // An object whose ownership was released can no longer be shared.
+    auto deleter = std::get_deleter<ReleasableObjectDeleter> (reference);
+    if(deleter && deleter->released)
+        return nullptr;
+
     return reference;
 }
 
+void *SharedObjectWrapper::releaseObjectOwnership()
+{
+    // Only the deserialized objects that are not shared yet can be released.
+    auto deleter = std::get_deleter<ReleasableObjectDeleter> (reference);
+    if(!deleter || deleter->released || reference.use_count() != 1)
+        return nullptr;
+
+    deleter->released = true;
+    return reference.get();
+}
+
+bool SharedObjectWrapper::restoreObjectOwnership()
+{
+    auto deleter = std::get_deleter<ReleasableObjectDeleter> (reference);
+    if(!deleter || !deleter->released)
+        return false;
+
+    deleter->released = false;
+    return true;
+}
+
 SerializableSharedObjectClassTag::~SerializableSharedObjectClassTag()
 {
 }
@@ -22,6 +22,9 @@
  */
 
 #include "coal-serialization/coal.hpp"
+#include "coal-serialization/coal-checksum.hpp"
+#include "coal-serialization/coal-compression.hpp"
+#include <atomic>
 
 namespace coal
 {
@@ -86,12 +89,31 @@ const char *typeDescriptorKindToString(TypeDescriptorKind kind)
     case TypeDescriptorKind::Map8: return "Map8";
     case TypeDescriptorKind::Map16: return "Map16";
     case TypeDescriptorKind::Map32: return "Map32";
+    case TypeDescriptorKind::Optional: return "Optional";
+    case TypeDescriptorKind::Variant: return "Variant";
+    case TypeDescriptorKind::Enum: return "Enum";
     default: abort();
     }
 }
 
 #pragma endregion TypeDescriptorKind
 
+#pragma region Fingerprint
+
+uint64_t fingerprintForBytes(const uint8_t *bytes, size_t size, uint64_t seed)
+{
+    auto result = seed;
+    for(size_t i = 0; i < size; ++i)
+    {
+        result ^= bytes[i];
+        result *= 0x100000001b3ull;
+    }
+
+    return result;
+}
+
+#pragma endregion Fingerprint
+
 #pragma region BinaryBlobBuilder
 uint32_t BinaryBlobBuilder::getOffsetForBytes(const uint8_t *bytes, size_t dataSize) const
 {
@@ -158,14 +180,22 @@ void BinaryBlobBuilder::internString32(const std::string &string)
 
 uint32_t BinaryBlobBuilder::hashForBytes(const uint8_t *bytes, size_t dataSize)
 {
-    // FIXME: Use a better hash function.
-    uint32_t result = 0;
-    for(size_t i = 0; i < dataSize; ++i)
+    // The binary payloads can be large, so they are hashed a word at a time.
+    uint64_t result = 0x9E3779B97F4A7C15ull ^ dataSize;
+    size_t i = 0;
+    for(; i + 8 <= dataSize; i += 8)
     {
-        result = result*33 + bytes[i];
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        result = (result ^ word) * 0xFF51AFD7ED558CCDull;
+        result ^= result >> 32;
     }
 
-    return result;
+    for(; i < dataSize; ++i)
+        result = (result ^ bytes[i]) * 0x100000001B3ull;
+
+    result ^= result >> 29;
+    return uint32_t(result ^ (result >> 32));
 }
 
 const uint8_t *BinaryBlobBuilder::getData() const
@@ -178,8 +208,192 @@ size_t BinaryBlobBuilder::getDataSize() const
     return data.size();
 }
 
+void BinaryBlobBuilder::clear()
+{
+    if(data.empty())
+        return;
+
+    for(auto &bucket : hashTable)
+        bucket.clear();
+    data.clear();
+}
+
 #pragma endregion BinaryBlobBuilder
 
+#pragma region StringPool
+
+std::shared_ptr<const std::string> StringPool::getOrCreate(uint32_t offset, const uint8_t *data, size_t dataSize)
+{
+    auto &string = strings[(uint64_t(offset) << 32) | uint64_t(dataSize)];
+    if(!string)
+        string = std::make_shared<const std::string> (reinterpret_cast<const char*> (data), dataSize);
+    return string;
+}
+
+void StringPool::clear()
+{
+    strings.clear();
+}
+
+#pragma endregion StringPool
+
+#pragma region ExclusiveOwnershipTable
+
+void *ExclusiveOwnershipTable::moveOwnershipInto(const ObjectMapperPtr &instance, void *ownerField, ReleaseFunction releaseOwnerField)
+{
+    auto object = instance->getObjectBasePointer();
+    auto it = entries.find(object);
+    if(it == entries.end())
+    {
+        if(!instance->releaseObjectOwnership())
+            return nullptr;
+
+        entries[object] = Entry{instance, ownerField, releaseOwnerField, generation};
+        return object;
+    }
+
+    // An object cannot have two exclusive owners in the same message.
+    auto &entry = it->second;
+    if(entry.generation == generation)
+        return nullptr;
+
+    // The previous owner is either updated later in this message, or not reachable anymore.
+    entry.releaseOwnerField(entry.ownerField);
+    entry.ownerField = ownerField;
+    entry.releaseOwnerField = releaseOwnerField;
+    entry.generation = generation;
+    return object;
+}
+
+bool ExclusiveOwnershipTable::keepOwnership(void *object, void *ownerField)
+{
+    auto it = entries.find(object);
+    if(it == entries.end())
+        return true;
+
+    auto &entry = it->second;
+    if(entry.generation == generation)
+        return false;
+
+    entry.ownerField = ownerField;
+    entry.generation = generation;
+    return true;
+}
+
+bool ExclusiveOwnershipTable::restoreOwnershipOf(void *object, void *ownerField)
+{
+    auto it = entries.find(object);
+    if(it == entries.end() || it->second.ownerField != ownerField || !it->second.instance->restoreObjectOwnership())
+        return false;
+
+    entries.erase(it);
+    return true;
+}
+
+void ExclusiveOwnershipTable::beginMessage()
+{
+    ++generation;
+}
+
+void ExclusiveOwnershipTable::clear()
+{
+    entries.clear();
+}
+
+#pragma endregion ExclusiveOwnershipTable
+
+#pragma region ObjectHandleArena
+
+ObjectHandle *ObjectHandleArena::newHandle(TypeMapper *typeMapper, void *basePointer)
+{
+    if(activeChunkCount == 0 || nextChunkOffset == ChunkCapacity)
+    {
+        if(activeChunkCount == chunks.size())
+            chunks.push_back(std::make_unique<ObjectHandle[]> (ChunkCapacity));
+        ++activeChunkCount;
+        nextChunkOffset = 0;
+    }
+
+    auto handle = &chunks[activeChunkCount - 1][nextChunkOffset++];
+    *handle = ObjectHandle{};
+    handle->typeMapper = typeMapper;
+    handle->basePointer = basePointer;
+    return handle;
+}
+
+void ObjectHandleArena::reset()
+{
+    activeChunkCount = 0;
+    nextChunkOffset = 0;
+}
+
+#pragma endregion ObjectHandleArena
+
+#pragma region ObjectHandleTable
+
+size_t ObjectHandleTable::hashForPointer(const void *pointer)
+{
+    // Fibonacci hashing. The low bits are discarded because of the allocation alignment.
+    auto value = uint64_t(reinterpret_cast<uintptr_t> (pointer)) >> 4;
+    return size_t((value * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+size_t ObjectHandleTable::indexForKey(const void *basePointer) const
+{
+    auto mask = entries.size() - 1;
+    auto index = hashForPointer(basePointer) & mask;
+    while(entries[index].key && entries[index].key != basePointer)
+        index = (index + 1) & mask;
+    return index;
+}
+
+ObjectHandle *ObjectHandleTable::find(const void *basePointer) const
+{
+    if(!basePointer || entries.empty())
+        return nullptr;
+
+    return entries[indexForKey(basePointer)].handle;
+}
+
+ObjectHandle *&ObjectHandleTable::findOrInsert(const void *basePointer)
+{
+    assert(basePointer);
+    if((count + 1) * 2 > entries.size())
+        grow();
+
+    auto &entry = entries[indexForKey(basePointer)];
+    if(!entry.key)
+    {
+        entry.key = basePointer;
+        ++count;
+    }
+
+    return entry.handle;
+}
+
+void ObjectHandleTable::grow()
+{
+    std::vector<Entry> oldEntries;
+    oldEntries.swap(entries);
+    entries.resize(oldEntries.empty() ? InitialCapacity : oldEntries.size() * 2);
+    for(auto &entry : oldEntries)
+    {
+        if(entry.key)
+            entries[indexForKey(entry.key)] = entry;
+    }
+}
+
+void ObjectHandleTable::clear()
+{
+    if(count == 0)
+        return;
+
+    std::fill(entries.begin(), entries.end(), Entry{});
+    count = 0;
+}
+
+#pragma endregion ObjectHandleTable
+
 #pragma region WriteStream
 
 WriteStream::~WriteStream() {}
@@ -240,27 +454,55 @@ void WriteStream::writeBlob(const BinaryBlobBuilder *theBlob)
     writeBytes(blob->getData(), blob->getDataSize());
 }
 
-void WriteStream::writeUTF8_32_8(const std::string &string)
+void WriteStream::setBinaryBlob(const BinaryBlobBuilder *theBlob)
+{
+    blob = theBlob;
+}
+
+void WriteStream::setEncodedInstanceRecorder(EncodedInstance *recorder)
+{
+    encodedInstanceRecorder = recorder;
+}
+
+void WriteStream::writeBlobOffsetForBytes(const uint8_t *bytes, size_t dataSize)
 {
+    if(encodedInstanceRecorder)
+    {
+        if(dataSize != 0)
+            encodedInstanceRecorder->blobRelocations.push_back({encodedInstanceRecorder->data.size(), std::string(reinterpret_cast<const char*> (bytes), dataSize)});
+        writeUInt32(0);
+        return;
+    }
+
     assert(blob);
+    writeUInt32(blob->getOffsetForBytes(bytes, dataSize));
+}
+
+void WriteStream::writeUTF8_32_8(const std::string &string)
+{
     auto dataSize = uint8_t(std::min(string.size(), size_t(0xFF)));
-    writeUInt32(blob->getOffsetForBytes(reinterpret_cast<const uint8_t*> (string.data()), dataSize));
+    writeBlobOffsetForBytes(reinterpret_cast<const uint8_t*> (string.data()), dataSize);
     writeUInt8(dataSize);
 }
 
 void WriteStream::writeUTF8_32_16(const std::string &string)
 {
-    assert(blob);
     auto dataSize = uint16_t(std::min(string.size(), size_t(0xFFFF)));
-    writeUInt32(blob->getOffsetForBytes(reinterpret_cast<const uint8_t*> (string.data()), dataSize));
+    writeBlobOffsetForBytes(reinterpret_cast<const uint8_t*> (string.data()), dataSize);
     writeUInt16(dataSize);
 }
 
 void WriteStream::writeUTF8_32_32(const std::string &string)
 {
-    assert(blob);
     auto dataSize = uint32_t(std::min(string.size(), size_t(0xFFFFFFFF)));
-    writeUInt32(blob->getOffsetForBytes(reinterpret_cast<const uint8_t*> (string.data()), dataSize));
+    writeBlobOffsetForBytes(reinterpret_cast<const uint8_t*> (string.data()), dataSize);
+    writeUInt32(dataSize);
+}
+
+void WriteStream::writeBinary_32_32(const uint8_t *bytes, size_t size)
+{
+    auto dataSize = uint32_t(std::min(size, size_t(0xFFFFFFFF)));
+    writeBlobOffsetForBytes(bytes, dataSize);
     writeUInt32(dataSize);
 }
 
@@ -274,16 +516,24 @@ void WriteStream::writeTypeDescriptorForTypeMapper(const TypeMapperPtr &typeMapp
     typeDescriptorContext->getForTypeMapper(typeMapper)->writeDescriptionWith(this);
 }
 
-void WriteStream::setObjectPointerToIndexMap(const std::unordered_map<const void*, uint32_t> *map)
+void WriteStream::setObjectHandleTable(const ObjectHandleTable *table)
 {
-    objectPointerToIndexMap = map;
+    objectHandleTable = table;
 }
 
 void WriteStream::writeObjectPointerAsReference(const void *pointer)
 {
-    auto it = objectPointerToIndexMap->find(pointer);
-    if(it != objectPointerToIndexMap->end())
-        writeUInt32(it->second + 1);
+    if(encodedInstanceRecorder)
+    {
+        if(pointer)
+            encodedInstanceRecorder->referenceRelocations.push_back({encodedInstanceRecorder->data.size(), pointer});
+        writeUInt32(0);
+        return;
+    }
+
+    auto handle = objectHandleTable ? objectHandleTable->find(pointer) : nullptr;
+    if(handle)
+        writeUInt32(handle->instanceIndex + 1);
     else
         writeUInt32(0);
 }
@@ -296,6 +546,11 @@ ReadStream::~ReadStream()
 {
 }
 
+const uint8_t *ReadStream::peekContiguousBytes(size_t)
+{
+    return nullptr;
+}
+
 bool ReadStream::readUInt8(uint8_t &destination)
 {
     return readBytes(reinterpret_cast<uint8_t*> (&destination), 1);
@@ -348,37 +603,118 @@ bool ReadStream::readFloat64(double &destination)
 
 bool ReadStream::readUTF8_32_8(std::string &output)
 {
-    uint32_t offset = 0;
-    uint8_t size = 0;
-    if(!readUInt32(offset) || !readUInt8(size) || offset + size > binaryBlobSize)
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    if(!readBinary_32_8(data, size))
         return false;
 
-    output.resize(size);
-    memcpy(output.data(), binaryBlobData + offset, size);
+    output.assign(reinterpret_cast<const char*> (data), size);
     return true;
 }
 
 bool ReadStream::readUTF8_32_16(std::string &output)
 {
-    uint32_t offset = 0;
-    uint16_t size = 0;
-    if(!readUInt32(offset) || !readUInt16(size) || offset + size > binaryBlobSize)
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    if(!readBinary_32_16(data, size))
         return false;
 
-    output.resize(size);
-    memcpy(output.data(), binaryBlobData + offset, size);
+    output.assign(reinterpret_cast<const char*> (data), size);
     return true;
 }
 
 bool ReadStream::readUTF8_32_32(std::string &output)
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    if(!readBinary_32_32(data, size))
+        return false;
+
+    output.assign(reinterpret_cast<const char*> (data), size);
+    return true;
+}
+
+bool ReadStream::getBinaryBlobRange(uint32_t offset, size_t size, const uint8_t *&data)
+{
+    if(size_t(offset) + size > binaryBlobSize)
+        return false;
+
+    data = binaryBlobData + offset;
+    binaryBlobReadEnd = std::max(binaryBlobReadEnd, size_t(offset) + size);
+    return true;
+}
+
+bool ReadStream::readBinary_32_8(const uint8_t *&data, size_t &size)
+{
+    uint32_t offset = 0;
+    uint8_t dataSize = 0;
+    if(!readUInt32(offset) || !readUInt8(dataSize))
+        return false;
+
+    size = dataSize;
+    return getBinaryBlobRange(offset, size, data);
+}
+
+bool ReadStream::readBinary_32_16(const uint8_t *&data, size_t &size)
 {
     uint32_t offset = 0;
-    uint32_t size = 0;
-    if(!readUInt32(offset) || !readUInt32(size) || offset + size > binaryBlobSize)
+    uint16_t dataSize = 0;
+    if(!readUInt32(offset) || !readUInt16(dataSize))
+        return false;
+
+    size = dataSize;
+    return getBinaryBlobRange(offset, size, data);
+}
+
+bool ReadStream::readBinary_32_32(const uint8_t *&data, size_t &size)
+{
+    uint32_t offset = 0;
+    uint32_t dataSize = 0;
+    if(!readUInt32(offset) || !readUInt32(dataSize))
+        return false;
+
+    size = dataSize;
+    return getBinaryBlobRange(offset, size, data);
+}
+
+void ReadStream::makeSharedString(const uint8_t *data, size_t size, std::shared_ptr<const std::string> &output)
+{
+    if(stringPool)
+        output = stringPool->getOrCreate(uint32_t(data - binaryBlobData), data, size);
+    else
+        output = std::make_shared<const std::string> (reinterpret_cast<const char*> (data), size);
+}
+
+bool ReadStream::readSharedUTF8_32_8(std::shared_ptr<const std::string> &output)
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    if(!readBinary_32_8(data, size))
+        return false;
+
+    makeSharedString(data, size, output);
+    return true;
+}
+
+bool ReadStream::readSharedUTF8_32_16(std::shared_ptr<const std::string> &output)
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    if(!readBinary_32_16(data, size))
+        return false;
+
+    makeSharedString(data, size, output);
+    return true;
+}
+
+bool ReadStream::readSharedUTF8_32_32(std::shared_ptr<const std::string> &output)
+{
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    if(!readBinary_32_32(data, size))
         return false;
 
-    output.resize(size);
-    memcpy(output.data(), binaryBlobData + offset, size);
+    makeSharedString(data, size, output);
     return true;
 }
 
@@ -396,6 +732,27 @@ void ReadStream::setBinaryBlob(const uint8_t *data, size_t size)
 {
     binaryBlobData = data;
     binaryBlobSize = size;
+    binaryBlobReadEnd = 0;
+}
+
+size_t ReadStream::getBinaryBlobReadEnd() const
+{
+    return binaryBlobReadEnd;
+}
+
+void ReadStream::setStringPool(StringPool *pool)
+{
+    stringPool = pool;
+}
+
+void ReadStream::setBinaryBlobViewsEnabled(bool enabled)
+{
+    binaryBlobViewsEnabled = enabled;
+}
+
+bool ReadStream::areBinaryBlobViewsEnabled() const
+{
+    return binaryBlobViewsEnabled;
 }
 
 void ReadStream::setInstances(const std::vector<ObjectMapperPtr> *theInstances)
@@ -403,6 +760,16 @@ void ReadStream::setInstances(const std::vector<ObjectMapperPtr> *theInstances)
     instances = theInstances;
 }
 
+void ReadStream::setExclusiveOwnershipTable(ExclusiveOwnershipTable *table)
+{
+    exclusiveOwnershipTable = table;
+}
+
+ExclusiveOwnershipTable *ReadStream::getExclusiveOwnershipTable() const
+{
+    return exclusiveOwnershipTable;
+}
+
 bool ReadStream::readInstanceReference(ObjectMapperPtr &destination)
 {
     uint32_t index = 0;
@@ -453,6 +820,26 @@ bool MemoryReadStream::skipBytes(size_t size)
     position += size;
     return true;
 }
+
+const uint8_t *MemoryReadStream::peekContiguousBytes(size_t size)
+{
+    if(size > dataSize - position)
+        return nullptr;
+
+    return data + position;
+}
+
+void MemoryReadStream::reset(const uint8_t *newData, size_t newDataSize)
+{
+    data = newData;
+    dataSize = newDataSize;
+    position = 0;
+}
+
+size_t MemoryReadStream::getRemainingSize() const
+{
+    return dataSize - position;
+}
 #pragma endregion MemoryReadStream
 
 #pragma region TypeDescriptor
@@ -708,6 +1095,91 @@ bool MapTypeDescriptor::skipDataWith(ReadStream *input)
 }
 #pragma endregion MapTypeDescriptor
 
+#pragma region OptionalTypeDescriptor
+
+void OptionalTypeDescriptor::writeDescriptionWith(WriteStream *output)
+{
+    output->writeUInt8(uint8_t(kind));
+    element->writeDescriptionWith(output);
+}
+
+bool OptionalTypeDescriptor::skipDataWith(ReadStream *input)
+{
+    uint8_t isPresent = 0;
+    if(!input->readUInt8(isPresent))
+        return false;
+
+    return !isPresent || element->skipDataWith(input);
+}
+
+#pragma endregion OptionalTypeDescriptor
+
+#pragma region VariantTypeDescriptor
+
+void VariantTypeDescriptor::writeDescriptionWith(WriteStream *output)
+{
+    output->writeUInt8(uint8_t(kind));
+    output->writeUInt8(uint8_t(alternatives.size()));
+    for(auto &alternative : alternatives)
+        alternative->writeDescriptionWith(output);
+}
+
+bool VariantTypeDescriptor::skipDataWith(ReadStream *input)
+{
+    uint8_t alternativeIndex = 0;
+    if(!input->readUInt8(alternativeIndex))
+        return false;
+
+    if(alternativeIndex == ValuelessIndex)
+        return true;
+
+    return alternativeIndex < alternatives.size() && alternatives[alternativeIndex]->skipDataWith(input);
+}
+
+#pragma endregion VariantTypeDescriptor
+
+#pragma region EnumTypeDescriptor
+
+void EnumTypeDescriptor::writeDescriptionWith(WriteStream *output)
+{
+    output->writeUInt8(uint8_t(kind));
+    underlying->writeDescriptionWith(output);
+    output->writeUInt32(uint32_t(enumerators.size()));
+    for(auto &enumerator : enumerators)
+    {
+        output->writeUTF8_32_16(enumerator.name);
+        output->writeInt64(enumerator.value);
+    }
+}
+
+bool EnumTypeDescriptor::skipDataWith(ReadStream *input)
+{
+    return underlying->skipDataWith(input);
+}
+
+const EnumTypeDescriptor::ValueRemapTable &EnumTypeDescriptor::getValueRemapTableFor(const TypeMapper *targetTypeMapper, const EnumeratorDescriptions &targetEnumerators)
+{
+    auto it = valueRemapTables.find(targetTypeMapper);
+    if(it != valueRemapTables.end())
+        return it->second;
+
+    std::unordered_map<std::string, int64_t> targetValues;
+    for(auto &enumerator : targetEnumerators)
+        targetValues.insert({enumerator.name, enumerator.value});
+
+    ValueRemapTable table;
+    for(auto &enumerator : enumerators)
+    {
+        auto targetIt = targetValues.find(enumerator.name);
+        if(targetIt != targetValues.end() && targetIt->second != enumerator.value)
+            table.insert({enumerator.value, targetIt->second});
+    }
+
+    return valueRemapTables.insert({targetTypeMapper, std::move(table)}).first->second;
+}
+
+#pragma endregion EnumTypeDescriptor
+
 #pragma region ObjectReferenceTypeDescriptor
 
 void ObjectReferenceTypeDescriptor::writeDescriptionWith(WriteStream *output)
@@ -763,19 +1235,30 @@ TypeDescriptorPtr TypeDescriptorContext::addValueType(const TypeMapperPtr &mappe
     return descriptor;
 }
 
-void TypeDescriptorContext::pushDataIntoBinaryBlob(BinaryBlobBuilder &binaryBlobBuilder)
+void TypeDescriptorContext::addSchemaDataType(const TypeMapperPtr &mapper)
 {
-    for(auto &typeMapper : valueTypes)
+    if(schemaDataTypeSet.insert(mapper).second)
+        schemaDataTypes.push_back(mapper);
+}
+
+void TypeDescriptorContext::pushDataIntoBinaryBlob(BinaryBlobBuilder &binaryBlobBuilder, uint32_t firstValueTypeIndex)
+{
+    for(size_t i = firstValueTypeIndex; i < valueTypes.size(); ++i)
     {
+        auto &typeMapper = valueTypes[i];
         binaryBlobBuilder.internString16(typeMapper->getName());
         typeMapper->pushDataIntoBinaryBlob(binaryBlobBuilder);
     }
+
+    for(auto &typeMapper : schemaDataTypes)
+        typeMapper->pushDataIntoBinaryBlob(binaryBlobBuilder);
 }
 
-void TypeDescriptorContext::writeValueTypeLayoutsWith(WriteStream *output)
+void TypeDescriptorContext::writeValueTypeLayoutsWith(WriteStream *output, uint32_t firstValueTypeIndex)
 {
-    for(auto &typeMapper : valueTypes)
+    for(size_t i = firstValueTypeIndex; i < valueTypes.size(); ++i)
     {
+        auto &typeMapper = valueTypes[i];
         output->writeUTF8_32_16(typeMapper->getName());
         output->writeUInt16(typeMapper->getFieldCount());
         typeMapper->writeFieldDescriptionsWith(output);
@@ -818,6 +1301,17 @@ bool TypeDescriptorContext::readTypeDescriptorWith(TypeDescriptorPtr &descriptor
             return true;
         }
 
+    case TypeDescriptorKind::FixedArray:
+        {
+            uint32_t size = 0;
+            TypeDescriptorPtr elementTypeDescriptor;
+            if(!input->readUInt32(size) || !readTypeDescriptorWith(elementTypeDescriptor, input))
+                return false;
+
+            descriptor = getOrCreateFixedArrayTypeDescriptor(size, elementTypeDescriptor);
+            return true;
+        }
+
     case TypeDescriptorKind::Array8:
     case TypeDescriptorKind::Array16:
     case TypeDescriptorKind::Array32:
@@ -854,6 +1348,54 @@ bool TypeDescriptorContext::readTypeDescriptorWith(TypeDescriptorPtr &descriptor
             descriptor = getOrCreateMapTypeDescriptor(kind, keyTypeDescriptor, valueTypeDescriptor);
             return true;
         }
+
+    case TypeDescriptorKind::Optional:
+        {
+            TypeDescriptorPtr elementTypeDescriptor;
+            if(!readTypeDescriptorWith(elementTypeDescriptor, input))
+                return false;
+
+            descriptor = getOrCreateOptionalTypeDescriptor(elementTypeDescriptor);
+            return true;
+        }
+
+    case TypeDescriptorKind::Variant:
+        {
+            uint8_t alternativeCount = 0;
+            if(!input->readUInt8(alternativeCount) || alternativeCount == 0 || alternativeCount == VariantTypeDescriptor::ValuelessIndex)
+                return false;
+
+            std::vector<TypeDescriptorPtr> alternativeTypeDescriptors(alternativeCount);
+            for(auto &alternativeTypeDescriptor : alternativeTypeDescriptors)
+            {
+                if(!readTypeDescriptorWith(alternativeTypeDescriptor, input))
+                    return false;
+            }
+
+            descriptor = getOrCreateVariantTypeDescriptor(alternativeTypeDescriptors);
+            return true;
+        }
+
+    case TypeDescriptorKind::Enum:
+        {
+            TypeDescriptorPtr underlyingTypeDescriptor;
+            uint32_t enumeratorCount = 0;
+            if(!readTypeDescriptorWith(underlyingTypeDescriptor, input) || !input->readUInt32(enumeratorCount))
+                return false;
+
+            // The enumerators are appended one by one, so that a corrupted count fails on the missing data instead of allocating.
+            EnumeratorDescriptions enumerators;
+            for(uint32_t i = 0; i < enumeratorCount; ++i)
+            {
+                EnumeratorDescription enumerator;
+                if(!input->readUTF8_32_16(enumerator.name) || !input->readInt64(enumerator.value))
+                    return false;
+                enumerators.push_back(std::move(enumerator));
+            }
+
+            descriptor = getOrCreateEnumTypeDescriptor(underlyingTypeDescriptor, enumerators);
+            return true;
+        }
     default:
         // Unsupported type descriptor kind.
         return false;
@@ -862,10 +1404,31 @@ bool TypeDescriptorContext::readTypeDescriptorWith(TypeDescriptorPtr &descriptor
 
 void TypeDescriptorContext::addObjectTypeMapper(const TypeMapperPtr &typeMapper)
 {
-    objectTypeToClusterIndexMap.insert({typeMapper, uint32_t(clusterTypes.size())});
+    if(!objectTypeToClusterIndexMap.insert({typeMapper, uint32_t(clusterTypes.size())}).second)
+        return;
+
     clusterTypes.push_back(typeMapper);
 }
 
+void TypeDescriptorContext::clear()
+{
+    valueTypes.clear();
+    valueTypeDescriptors.clear();
+    clusterTypes.clear();
+    objectTypeToClusterIndexMap.clear();
+    mapperToDescriptorMap.clear();
+    typedObjectReferenceCache.clear();
+    fixedArrayTypeDescriptorCache.clear();
+    arrayTypeDescriptorCache.clear();
+    setTypeDescriptorCache.clear();
+    mapTypeDescriptorCache.clear();
+    optionalTypeDescriptorCache.clear();
+    variantTypeDescriptorCache.clear();
+    enumTypeDescriptorCache.clear();
+    schemaDataTypes.clear();
+    schemaDataTypeSet.clear();
+}
+
 TypeDescriptorPtr TypeDescriptorContext::getOrCreateForTypedObjectReference(const TypeMapperPtr &objectType)
 {
     auto it = typedObjectReferenceCache.find(objectType);
@@ -879,6 +1442,20 @@ TypeDescriptorPtr TypeDescriptorContext::getOrCreateForTypedObjectReference(cons
     return descriptor;
 }
 
+TypeDescriptorPtr TypeDescriptorContext::getOrCreateFixedArrayTypeDescriptor(uint32_t size, const TypeDescriptorPtr &elementType)
+{
+    auto it = fixedArrayTypeDescriptorCache.find({size, elementType});
+    if(it != fixedArrayTypeDescriptorCache.end())
+        return it->second;
+
+    auto descriptor = std::make_shared<FixedArrayTypeDescriptor> ();
+    descriptor->kind = TypeDescriptorKind::FixedArray;
+    descriptor->size = size;
+    descriptor->element = elementType;
+    fixedArrayTypeDescriptorCache.insert({{size, elementType}, descriptor});
+    return descriptor;
+}
+
 TypeDescriptorPtr TypeDescriptorContext::getOrCreateArrayTypeDescriptor(TypeDescriptorKind kind, const TypeDescriptorPtr &elementType)
 {
     auto it = arrayTypeDescriptorCache.find({kind, elementType});
@@ -919,6 +1496,47 @@ TypeDescriptorPtr TypeDescriptorContext::getOrCreateMapTypeDescriptor(TypeDescri
     return descriptor;
 }
 
+TypeDescriptorPtr TypeDescriptorContext::getOrCreateOptionalTypeDescriptor(const TypeDescriptorPtr &elementType)
+{
+    auto it = optionalTypeDescriptorCache.find(elementType);
+    if(it != optionalTypeDescriptorCache.end())
+        return it->second;
+
+    auto descriptor = std::make_shared<OptionalTypeDescriptor> ();
+    descriptor->kind = TypeDescriptorKind::Optional;
+    descriptor->element = elementType;
+    optionalTypeDescriptorCache.insert({elementType, descriptor});
+    return descriptor;
+}
+
+TypeDescriptorPtr TypeDescriptorContext::getOrCreateVariantTypeDescriptor(const std::vector<TypeDescriptorPtr> &alternativeTypes)
+{
+    assert(!alternativeTypes.empty() && alternativeTypes.size() < VariantTypeDescriptor::ValuelessIndex);
+    auto it = variantTypeDescriptorCache.find(alternativeTypes);
+    if(it != variantTypeDescriptorCache.end())
+        return it->second;
+
+    auto descriptor = std::make_shared<VariantTypeDescriptor> ();
+    descriptor->kind = TypeDescriptorKind::Variant;
+    descriptor->alternatives = alternativeTypes;
+    variantTypeDescriptorCache.insert({alternativeTypes, descriptor});
+    return descriptor;
+}
+
+TypeDescriptorPtr TypeDescriptorContext::getOrCreateEnumTypeDescriptor(const TypeDescriptorPtr &underlyingType, const EnumeratorDescriptions &enumerators)
+{
+    auto it = enumTypeDescriptorCache.find({underlyingType, enumerators});
+    if(it != enumTypeDescriptorCache.end())
+        return it->second;
+
+    auto descriptor = std::make_shared<EnumTypeDescriptor> ();
+    descriptor->kind = TypeDescriptorKind::Enum;
+    descriptor->underlying = underlyingType;
+    descriptor->enumerators = enumerators;
+    enumTypeDescriptorCache.insert({{underlyingType, enumerators}, descriptor});
+    return descriptor;
+}
+
 #pragma endregion TypeDescriptorContext
 
 #pragma region FieldDescription
@@ -981,6 +1599,11 @@ bool TypeMapper::isReferenceType() const
     return false;
 }
 
+std::string TypeMapper::getQualifiedName() const
+{
+    return getName();
+}
+
 void TypeMapper::pushDataIntoBinaryBlob(BinaryBlobBuilder &binaryBlobBuilder)
 {
     (void)binaryBlobBuilder;
@@ -1087,6 +1710,39 @@ void TypeMapper::subtypesDo(const TypeMapperIterationBlock &aBlock)
     (void)aBlock;
 }
 
+bool TypeMapper::isKindOf(const TypeMapperPtr &expectedType) const
+{
+    if(expectedType.get() == this)
+        return true;
+
+    for(auto type = getSuperType(); type; type = type->getSuperType())
+    {
+        if(type == expectedType)
+            return true;
+    }
+
+    return false;
+}
+
+bool TypeMapper::isExclusivelyOwnable() const
+{
+    if(exclusivelyOwnable)
+        return true;
+
+    for(auto type = getSuperType(); type; type = type->getSuperType())
+    {
+        if(type->exclusivelyOwnable)
+            return true;
+    }
+
+    return false;
+}
+
+void TypeMapper::setExclusivelyOwnable()
+{
+    exclusivelyOwnable = true;
+}
+
 void TypeMapper::typeMapperDependenciesDo(const TypeMapperIterationBlock &aBlock)
 {
     (void)aBlock;
@@ -1099,17 +1755,27 @@ void TypeMapper::withTypeMapperDependenciesDo(const TypeMapperIterationBlock &aB
     typeMapperDependenciesDo(aBlock);
 }
 
-void TypeMapper::objectReferencesInInstanceDo(void *instancePointer, std::unordered_map<void*, ObjectMapperPtr> *cache, const ObjectReferenceIterationBlock &aBlock)
+void TypeMapper::objectReferencesInInstanceDo(void *instancePointer, const ObjectReferenceIterationBlock &aBlock)
 {
     (void)instancePointer;
-    (void)cache;
     (void)aBlock;
 }
 
-void TypeMapper::objectReferencesInFieldDo(void *fieldPointer, std::unordered_map<void*, ObjectMapperPtr> *cache, const ObjectReferenceIterationBlock &aBlock)
+uint64_t TypeMapper::getDirtyGenerationOfInstance(void *instancePointer)
+{
+    (void)instancePointer;
+    return 0;
+}
+
+uint64_t TypeMapper::getIdentityOfInstance(void *instancePointer)
+{
+    (void)instancePointer;
+    return 0;
+}
+
+void TypeMapper::objectReferencesInFieldDo(void *fieldPointer, const ObjectReferenceIterationBlock &aBlock)
 {
     (void)fieldPointer;
-    (void)cache;
     (void)aBlock;
 }
 
@@ -1126,6 +1792,16 @@ std::shared_ptr<void> ObjectMapper::asObjectSharedPointer()
     return nullptr;
 }
 
+void *ObjectMapper::releaseObjectOwnership()
+{
+    return nullptr;
+}
+
+bool ObjectMapper::restoreObjectOwnership()
+{
+    return false;
+}
+
 #pragma endregion ObjectMapper
 
 #pragma region TypeMapperRegistry
@@ -1140,6 +1816,12 @@ TypeMapperPtr TypeMapperRegistry::getTypeMapperWithName(const std::string &name)
     return nullptr;
 }
 
+bool TypeMapperRegistry::isAmbiguousTypeName(const std::string &name) const
+{
+    (void)name;
+    return false;
+}
+
 TypeMapperRegistryPtr TypeMapperRegistry::getOrCreateForTransitiveClosureOf(const TypeMapperPtr &rootTypeMapper)
 {
     static std::unordered_map<TypeMapperPtr, TypeMapperRegistryPtr> cachedRegistries;
@@ -1157,14 +1839,70 @@ TypeMapperRegistryPtr TypeMapperRegistry::getOrCreateForTransitiveClosureOf(cons
     return transitiveClosureRegistry;
 }
 
+TypeMapperRegistryPtr TypeMapperRegistry::getOrCreateForTransitiveClosureOfAll(const std::vector<TypeMapperPtr> &rootTypeMappers)
+{
+    if(rootTypeMappers.size() == 1)
+        return getOrCreateForTransitiveClosureOf(rootTypeMappers.front());
+
+    static std::map<std::vector<TypeMapperPtr>, TypeMapperRegistryPtr> cachedRegistries;
+    static std::mutex cachedRegistriesMutex;
+
+    std::unique_lock<std::mutex> l(cachedRegistriesMutex);
+
+    auto it = cachedRegistries.find(rootTypeMappers);
+    if(it != cachedRegistries.end())
+        return it->second;
+
+    auto transitiveClosureRegistry = std::make_shared<TransitiveClosureTypeMapperRegistry> ();
+    for(auto &rootTypeMapper : rootTypeMappers)
+    {
+        if(rootTypeMapper)
+            transitiveClosureRegistry->addWithDependencies(rootTypeMapper);
+    }
+    cachedRegistries.insert({rootTypeMappers, transitiveClosureRegistry});
+    return transitiveClosureRegistry;
+}
+
 #pragma endregion TypeMapperRegistry
 
 #pragma region TransitiveClosureTypeMapperRegistry
 
+static std::string genericTypeNameOf(const std::string &name)
+{
+    return name.substr(0, name.find('<'));
+}
+
+static bool isSynthesizedGenericTypeName(const std::string &genericName)
+{
+    return genericName == "RootValueBox" || genericName == "std::pair" || genericName == "std::tuple";
+}
+
 TypeMapperPtr TransitiveClosureTypeMapperRegistry::getTypeMapperWithName(const std::string &name)
 {
     auto it = nameMap.find(name);
-    return it != nameMap.end() ? it->second : nullptr;
+    if(it != nameMap.end())
+        return ambiguousNames.find(name) == ambiguousNames.end() ? it->second : nullptr;
+
+    // An ambiguous generic name has a null type mapper.
+    auto genericName = genericTypeNameOf(name);
+    if(!isSynthesizedGenericTypeName(genericName))
+        return nullptr;
+
+    auto genericNameIt = genericNameMap.find(genericName);
+    return genericNameIt != genericNameMap.end() ? genericNameIt->second : nullptr;
+}
+
+bool TransitiveClosureTypeMapperRegistry::isAmbiguousTypeName(const std::string &name) const
+{
+    if(ambiguousNames.find(name) != ambiguousNames.end())
+        return true;
+
+    // The unqualified name that the previous versions gave to every root value box cannot tell apart the boxes of different value types.
+    if(name != "RootValueBox" || nameMap.find(name) != nameMap.end())
+        return false;
+
+    auto genericNameIt = genericNameMap.find(name);
+    return genericNameIt != genericNameMap.end() && !genericNameIt->second;
 }
 
 void TransitiveClosureTypeMapperRegistry::addWithDependencies(const TypeMapperPtr &typeMapper)
@@ -1176,7 +1914,19 @@ void TransitiveClosureTypeMapperRegistry::addWithDependencies(const TypeMapperPt
         return;
 
     addedTypes.insert(typeMapper);
-    nameMap.insert({typeMapper->getName(), typeMapper});
+    auto &name = typeMapper->getName();
+    auto [it, inserted] = nameMap.insert({name, typeMapper});
+    if(!inserted && it->second->isAggregateType() && typeMapper->isAggregateType())
+        ambiguousNames.insert(name);
+
+    auto genericName = genericTypeNameOf(name);
+    if(typeMapper->isAggregateType() && isSynthesizedGenericTypeName(genericName))
+    {
+        auto [genericNameIt, genericNameInserted] = genericNameMap.insert({genericName, typeMapper});
+        if(!genericNameInserted)
+            genericNameIt->second.reset();
+    }
+
     typeMapper->typeMapperDependenciesDo([&](const TypeMapperPtr &dependency) {
         addWithDependencies(dependency);
     });
@@ -1328,6 +2078,16 @@ TypeDescriptorPtr ObjectTypeMapper::getOrCreateTypeDescriptor(TypeDescriptorCont
     abort();
 }
 
+uint64_t ObjectTypeMapper::getDirtyGenerationOfInstance(void *instancePointer)
+{
+    return dirtyGenerationGetter ? dirtyGenerationGetter(instancePointer) : 0;
+}
+
+uint64_t ObjectTypeMapper::getIdentityOfInstance(void *instancePointer)
+{
+    return identityGetter ? identityGetter(instancePointer) : 0;
+}
+
 TypeMapperPtr ObjectTypeMapper::getSuperType() const
 {
     return superType.lock();
@@ -1357,11 +2117,11 @@ void ObjectTypeMapper::typeMapperDependenciesDo(const TypeMapperIterationBlock &
     AggregateTypeMapper::typeMapperDependenciesDo(aBlock);
 }
 
-void ObjectTypeMapper::objectReferencesInInstanceDo(void *instancePointer, std::unordered_map<void*, ObjectMapperPtr> *cache, const ObjectReferenceIterationBlock &aBlock)
+void ObjectTypeMapper::objectReferencesInInstanceDo(void *instancePointer, const ObjectReferenceIterationBlock &aBlock)
 {
     auto st = superType.lock();
     if(st)
-        st->objectReferencesInInstanceDo(instancePointer, cache, aBlock);
+        st->objectReferencesInInstanceDo(instancePointer, aBlock);
 
     for(auto &field : fields)
     {
@@ -1369,13 +2129,23 @@ void ObjectTypeMapper::objectReferencesInInstanceDo(void *instancePointer, std::
         if(fieldType)
         {
             auto fieldPointer = field.accessor->getPointerForBasePointer(instancePointer);
-            fieldType->objectReferencesInFieldDo(fieldPointer, cache, aBlock);
+            fieldType->objectReferencesInFieldDo(fieldPointer, aBlock);
         }
     }
 }
 
 #pragma endregion ObjectTypeMapper
 
+#pragma region DirtyTrackedObject
+
+uint64_t DirtyTrackedObject::nextDirtyGeneration()
+{
+    static std::atomic<uint64_t> lastGeneration(0);
+    return ++lastGeneration;
+}
+
+#pragma endregion DirtyTrackedObject
+
 #pragma region StructureTypeMapper
 
 TypeMapperPtr StructureTypeMapper::makeWithFields(const std::string &name, const std::vector<FieldDescription> &fields)
@@ -1421,7 +2191,7 @@ TypeDescriptorPtr StructureTypeMapper::getOrCreateTypeDescriptor(TypeDescriptorC
     abort();
 }
 
-void StructureTypeMapper::objectReferencesInFieldDo(void *baseFieldPointer, std::unordered_map<void*, ObjectMapperPtr> *cache, const ObjectReferenceIterationBlock &aBlock)
+void StructureTypeMapper::objectReferencesInFieldDo(void *baseFieldPointer, const ObjectReferenceIterationBlock &aBlock)
 {
     for(auto &field : fields)
     {
@@ -1429,7 +2199,7 @@ void StructureTypeMapper::objectReferencesInFieldDo(void *baseFieldPointer, std:
         if(fieldType)
         {
             auto fieldPointer = field.accessor->getPointerForBasePointer(baseFieldPointer);
-            fieldType->objectReferencesInFieldDo(fieldPointer, cache, aBlock);
+            fieldType->objectReferencesInFieldDo(fieldPointer, aBlock);
         }
     }
 }
@@ -1555,6 +2325,17 @@ bool StructureMaterializationTypeMapper::readFieldWith(void *basePointer, const
     return true;
 }
 
+bool StructureMaterializationTypeMapper::skipFieldWith(ReadStream *input)
+{
+    for(auto &field : fields)
+    {
+        if(!field.encoding->skipDataWith(input))
+            return false;
+    }
+
+    return true;
+}
+
 #pragma endregion StructureMaterializationTypeMapper
 
 #pragma region ObjectMaterializationTypeMapper
@@ -1618,39 +2399,38 @@ bool ObjectMaterializationTypeMapper::skipInstanceWith(ReadStream *input)
 
 #pragma region SerializationCluster
 
-void SerializationCluster::pushDataIntoBinaryBlob(BinaryBlobBuilder &binaryBlobBuilder)
+void SerializationCluster::pushLayoutDataIntoBinaryBlob(BinaryBlobBuilder &binaryBlobBuilder)
 {
     binaryBlobBuilder.internString16(name);
     typeMapper->pushDataIntoBinaryBlob(binaryBlobBuilder);
-    for(auto &instance: instances)
-    {
-        auto instancePointer = instance->getObjectBasePointer();
-        typeMapper->pushInstanceDataIntoBinaryBlob(instancePointer, binaryBlobBuilder);
-    }
 }
 
-void SerializationCluster::addObject(const ObjectMapperPtr &object)
+void SerializationCluster::pushInstanceDataIntoBinaryBlob(BinaryBlobBuilder &binaryBlobBuilder)
+{
+    for(auto instance: instances)
+        typeMapper->pushInstanceDataIntoBinaryBlob(instance->basePointer, binaryBlobBuilder);
+}
+
+void SerializationCluster::addObject(ObjectHandle *object)
 {
     instances.push_back(object);
 }
 
-void SerializationCluster::writeDescriptionWith(WriteStream *output)
+void SerializationCluster::writeDescriptionWith(WriteStream *output, bool withInstanceCount)
 {
     auto super = supertype.lock();
     output->writeUTF8_32_16(name);
     output->writeUInt32(uint32_t(super ? super->index + 1 : 0));
     output->writeUInt16(typeMapper->getFieldCount());
-    output->writeUInt32(uint32_t(instances.size()));
+    if(withInstanceCount)
+        output->writeUInt32(uint32_t(instances.size()));
     typeMapper->writeFieldDescriptionsWith(output);
 }
 
 void SerializationCluster::writeInstancesWith(WriteStream *output)
 {
-    for(const auto &instance : instances)
-    {
-        auto basePointer = instance->getObjectBasePointer();
-        typeMapper->writeInstanceWith(basePointer, output);
-    }
+    for(auto instance : instances)
+        typeMapper->writeInstanceWith(instance->basePointer, output);
 }
 
 #pragma endregion SerializationCluster
@@ -1662,28 +2442,199 @@ Serializer::Serializer(WriteStream *initialOutput)
 {
 }
 
+void Serializer::reset()
+{
+    objectCount = 0;
+    rootObjects.clear();
+    objectHandleArena.reset();
+    objectHandleTable.clear();
+    tracingStack.clear();
+    for(auto &cluster : clusters)
+    {
+        cluster->instances.clear();
+        cluster->updatedInstances.clear();
+    }
+
+    // The blob of the delta baseline is extended by the following messages.
+    if(!deltaModeEnabled)
+        binaryBlobBuilder.clear();
+}
+
+void Serializer::reset(WriteStream *newOutput)
+{
+    reset();
+    output = newOutput;
+}
+
+void Serializer::setSchemaFingerprintEnabled(bool enabled)
+{
+    schemaFingerprintEnabled = enabled;
+}
+
+void Serializer::setSessionModeEnabled(bool enabled)
+{
+    sessionModeEnabled = enabled;
+    sessionSchemaFingerprints.clear();
+}
+
+void Serializer::setSectionCompressionCodec(CompressionCodec codec)
+{
+    assert(isCompressionCodecSupported(codec));
+    sectionCompressionCodec = codec;
+}
+
+void Serializer::setDeltaModeEnabled(bool enabled)
+{
+    deltaModeEnabled = enabled;
+    resetDeltaBaseline();
+}
+
+void Serializer::resetDeltaBaseline()
+{
+    hasDeltaBaseline = false;
+}
+
+void Serializer::setStableObjectIdsEnabled(bool enabled)
+{
+    stableObjectIdsEnabled = enabled;
+    stableObjectIds.clear();
+}
+
+uint64_t Serializer::getStableObjectIdOf(const void *objectBasePointer) const
+{
+    auto it = stableObjectIds.find(objectBasePointer);
+    return it != stableObjectIds.end() && it->second.generation == stableObjectIdGeneration ? it->second.id : 0;
+}
+
+void Serializer::setEncodedInstanceCacheEnabled(bool enabled)
+{
+    encodedInstanceCacheEnabled = enabled;
+    encodedInstanceCache.clear();
+}
+
+void Serializer::setSectionChecksumsEnabled(bool enabled)
+{
+    sectionChecksumsEnabled = enabled;
+}
+
+void Serializer::setTrailerChecksumEnabled(bool enabled)
+{
+    trailerChecksumEnabled = enabled;
+}
+
+void Serializer::discardLayoutsForDifferentRootTypes()
+{
+    if(layoutsRootTypeMappers == rootTypeMappers)
+        return;
+
+    layoutsRootTypeMappers = rootTypeMappers;
+    hasEncodedSchema = false;
+    hasDeltaBaseline = false;
+    typeDescriptorContext.clear();
+    clusters.clear();
+    valueTypeScanColorMap.clear();
+    typeMapperToClustersMap.clear();
+    scannedReferenceType.clear();
+}
+
 void Serializer::serializeRootObject(const ObjectMapperPtr &object)
 {
-    addPendingObject(object);
+    reset();
+    rootObjects.push_back({std::string(), object});
+    multipleRoots = false;
+    serializeRoots();
+}
+
+void Serializer::serializeRootObjects(const NamedRootObjectList &roots)
+{
+    reset();
+    rootObjects = roots;
+    multipleRoots = true;
+    serializeRoots();
+}
+
+void Serializer::serializeRoots()
+{
+    rootTypeMappers.clear();
+    for(auto &root : rootObjects)
+        rootTypeMappers.push_back(root.second ? root.second->getTypeMapper() : nullptr);
+    discardLayoutsForDifferentRootTypes();
+
+    ++encodedInstanceCacheGeneration;
+    for(auto &root : rootObjects)
+    {
+        auto &object = root.second;
+        if(object)
+            addPendingObject(ObjectHandle{object->getTypeMapper().get(), object->getObjectBasePointer()});
+    }
     tracePendingObjects();
 
+    if(!sectionChecksumsEnabled && !trailerChecksumEnabled)
+    {
+        writeSections();
+        return;
+    }
+
+    // The checksum stream is below the compression streams, so that the checksums are computed on the stored data.
+    auto rawOutput = output;
+    Crc32cWriteStream checksumStream(rawOutput);
+    MemoryWriteStream sectionStream(sectionData);
+    sectionStream.setObjectHandleTable(&objectHandleTable);
+    checksumOutput = &checksumStream;
+    sectionOutput = &sectionStream;
+    output = &checksumStream;
+    writeSections();
+    auto messageChecksum = checksumStream.finish();
+    output = rawOutput;
+    checksumOutput = nullptr;
+    sectionOutput = nullptr;
+
+    if(trailerChecksumEnabled)
+        output->writeUInt32(messageChecksum);
+}
+
+void Serializer::writeSections()
+{
     prepareForWriting();
 
-    writeHeader();
+    writeFixedHeader();
+    beginSection();
+    writeVariableHeader();
     writeBlob();
+    endSection();
+    beginSection();
     writeValueTypeLayouts();
     writeClusterDescriptions();
+    endSection();
+    beginSection();
+    writeClusterInstanceCounts();
+    writeStableObjectIds();
     writeClusterInstances();
-    writeTrailerForObject(object);
+    writeTrailer();
+    endSection();
+
+    if(deltaModeEnabled)
+    {
+        deltaBaselineBlobSize = binaryBlobBuilder.getDataSize();
+        if(!isDeltaMessage)
+            deltaCompleteBlobSize = deltaBaselineBlobSize;
+        deltaBaselineInstanceCount += uint32_t(objectCount);
+        deltaBaselineInstanceData.swap(deltaInstanceData);
+        hasDeltaBaseline = true;
+    }
 }
 
-void Serializer::addPendingObject(const ObjectMapperPtr &object)
+void Serializer::addPendingObject(const ObjectHandle &object)
 {
-    if(seenSet.find(object) != seenSet.end())
+    if(!object.basePointer)
         return;
-    
-    tracingStack.push_back(object);
-    seenSet.insert(object);
+
+    auto &handle = objectHandleTable.findOrInsert(object.basePointer);
+    if(handle)
+        return;
+
+    handle = objectHandleArena.newHandle(object.typeMapper, object.basePointer);
+    tracingStack.push_back(handle);
 }
 
 void Serializer::tracePendingObjects()
@@ -1696,215 +2647,1233 @@ void Serializer::tracePendingObjects()
     }
 }
 
-void Serializer::tracePendingObject(const ObjectMapperPtr &object)
+void Serializer::tracePendingObject(ObjectHandle *object)
 {
-    auto typeMapper = object->getTypeMapper();
+    auto typeMapper = object->typeMapper;
     auto cluster = getOrCreateClusterFor(typeMapper);
+    object->cluster = cluster.get();
     cluster->addObject(object);
 
-    typeMapper->objectReferencesInInstanceDo(object->getObjectBasePointer(), &objectPointerToMapperMap, [&](const ObjectMapperPtr &reference) {
-        addPendingObject(reference);
-    });
-}
+    if(encodedInstanceCacheEnabled)
+        object->encodedInstance = getOrCreateEncodedInstanceFor(object);
+
+    if(object->encodedInstance)
+    {
+        for(auto &reference : object->encodedInstance->references)
+            addPendingObject(reference);
+        return;
+    }
+
+    typeMapper->objectReferencesInInstanceDo(object->basePointer, [&](const ObjectHandle &reference) {
+        addPendingObject(reference);
+    });
+}
+
+EncodedInstance *Serializer::getOrCreateEncodedInstanceFor(ObjectHandle *object)
+{
+    auto dirtyGeneration = object->typeMapper->getDirtyGenerationOfInstance(object->basePointer);
+    if(dirtyGeneration == 0)
+        return nullptr;
+
+    auto &encodedInstance = encodedInstanceCache[object->basePointer];
+    encodedInstance.usageGeneration = encodedInstanceCacheGeneration;
+    if(encodedInstance.typeMapper == object->typeMapper && encodedInstance.dirtyGeneration == dirtyGeneration)
+        return &encodedInstance;
+
+    encodedInstance.typeMapper = object->typeMapper;
+    encodedInstance.dirtyGeneration = dirtyGeneration;
+    encodedInstance.data.clear();
+    encodedInstance.blobRelocations.clear();
+    encodedInstance.referenceRelocations.clear();
+    encodedInstance.references.clear();
+
+    MemoryWriteStream instanceOutput(encodedInstance.data);
+    instanceOutput.setTypeDescriptorContext(&typeDescriptorContext);
+    instanceOutput.setEncodedInstanceRecorder(&encodedInstance);
+    object->typeMapper->writeInstanceWith(object->basePointer, &instanceOutput);
+
+    object->typeMapper->objectReferencesInInstanceDo(object->basePointer, [&](const ObjectHandle &reference) {
+        encodedInstance.references.push_back(reference);
+    });
+    return &encodedInstance;
+}
+
+void Serializer::pruneEncodedInstanceCache()
+{
+    for(auto it = encodedInstanceCache.begin(); it != encodedInstanceCache.end(); )
+    {
+        if(it->second.usageGeneration != encodedInstanceCacheGeneration)
+            it = encodedInstanceCache.erase(it);
+        else
+            ++it;
+    }
+}
+
+void Serializer::pushInstanceDataOf(ObjectHandle *instance)
+{
+    auto encodedInstance = instance->encodedInstance;
+    if(!encodedInstance)
+    {
+        instance->typeMapper->pushInstanceDataIntoBinaryBlob(instance->basePointer, binaryBlobBuilder);
+        return;
+    }
+
+    for(auto &[offset, string] : encodedInstance->blobRelocations)
+        binaryBlobBuilder.internString32(string);
+}
+
+void Serializer::writeInstanceOf(ObjectHandle *instance, WriteStream *instanceOutput)
+{
+    auto encodedInstance = instance->encodedInstance;
+    if(!encodedInstance)
+    {
+        instance->typeMapper->writeInstanceWith(instance->basePointer, instanceOutput);
+        return;
+    }
+
+    relocatedInstanceData = encodedInstance->data;
+    for(auto &[offset, string] : encodedInstance->blobRelocations)
+    {
+        auto blobOffset = binaryBlobBuilder.getOffsetForBytes(reinterpret_cast<const uint8_t*> (string.data()), string.size());
+        memcpy(relocatedInstanceData.data() + offset, &blobOffset, 4);
+    }
+
+    for(auto &[offset, pointer] : encodedInstance->referenceRelocations)
+    {
+        auto handle = objectHandleTable.find(pointer);
+        uint32_t reference = handle ? handle->instanceIndex + 1 : 0;
+        memcpy(relocatedInstanceData.data() + offset, &reference, 4);
+    }
+
+    instanceOutput->writeBytes(relocatedInstanceData.data(), relocatedInstanceData.size());
+}
 
 TypeDescriptorPtr Serializer::getOrCreateAggregateTypeDescriptorFor(const TypeMapperPtr &typeMapper)
 {
-    auto it = valueTypeScanColorMap.find(typeMapper);
-    if(it != valueTypeScanColorMap.end())
+    auto it = valueTypeScanColorMap.find(typeMapper);
+    if(it != valueTypeScanColorMap.end())
+    {
+        auto currentColor = it->second;
+        assert(currentColor == ValueTypeScanColor::Black && "Recursive value types are not allowed.");
+        if(currentColor == ValueTypeScanColor::Gray)
+            abort();
+        
+        return typeDescriptorContext.getForTypeMapper(typeMapper);
+    }
+
+    // Scan the dependencies recursively.
+    valueTypeScanColorMap[typeMapper] = ValueTypeScanColor::Gray;
+    typeMapper->typeMapperDependenciesDo([&](const TypeMapperPtr &dependency) {
+        scanTypeMapperDependency(dependency);
+    });
+    
+    valueTypeScanColorMap[typeMapper] = ValueTypeScanColor::Black;
+
+    // Add the value type.
+    return typeDescriptorContext.addValueType(typeMapper);
+}
+
+void Serializer::scanReferenceTypeDependencies(const TypeMapperPtr &typeMapper)
+{
+    if(scannedReferenceType.find(typeMapper) == scannedReferenceType.end())
+        return;
+
+    scannedReferenceType.insert(typeMapper);
+    typeMapper->typeMapperDependenciesDo([&](const TypeMapperPtr &dependency) {
+        scanTypeMapperDependency(dependency);
+    });
+}
+
+void Serializer::scanTypeMapperDependency(const TypeMapperPtr &typeMapper)
+{
+    if(typeMapper->isObjectType())
+        getOrCreateClusterFor(typeMapper.get());
+    else if(typeMapper->isAggregateType())
+        getOrCreateAggregateTypeDescriptorFor(typeMapper);
+    else if(typeMapper->isReferenceType())
+        scanReferenceTypeDependencies(typeMapper);
+    else
+        typeDescriptorContext.addSchemaDataType(typeMapper);
+}
+
+SerializationClusterPtr Serializer::getOrCreateClusterFor(TypeMapper *typeMapper)
+{
+    assert(typeMapper->isObjectType());
+    auto it = typeMapperToClustersMap.find(typeMapper);
+    if(it != typeMapperToClustersMap.end())
+        return it->second;
+
+    SerializationClusterPtr supertypeCluster;
+    auto superType = typeMapper->getSuperType();
+    if(superType)
+    {
+        supertypeCluster = getOrCreateClusterFor(superType.get());
+        it = typeMapperToClustersMap.find(typeMapper);
+        if(it != typeMapperToClustersMap.end())
+            return it->second;
+    }
+
+    auto newCluster = std::make_shared<SerializationCluster> ();
+    newCluster->name = typeMapper->getName();
+    newCluster->typeMapper = typeMapper->shared_from_this();
+    newCluster->index = clusters.size();
+    newCluster->supertype = supertypeCluster;
+    clusters.push_back(newCluster);
+    typeMapperToClustersMap.insert(std::make_pair(typeMapper, newCluster));
+
+    typeMapper->typeMapperDependenciesDo([&](const TypeMapperPtr &dependency) {
+        scanTypeMapperDependency(dependency);
+    });
+
+    return newCluster;
+}
+
+void Serializer::writeFixedHeader()
+{
+    output->writeUInt32(CoalMagicNumber);
+    output->writeUInt8(CoalVersionMajor);
+    output->writeUInt8(CoalVersionMinor);
+    uint16_t flags = 0;
+    if(schemaFingerprintEnabled)
+        flags |= CoalHeaderFlagSchemaFingerprint;
+    if(schemaElided)
+        flags |= CoalHeaderFlagSchemaElided;
+    if(schemaExtended)
+        flags |= CoalHeaderFlagSchemaExtension;
+    if(sectionCompressionCodec != CompressionCodec::None)
+        flags |= CoalHeaderFlagCompressedSections;
+    if(sectionChecksumsEnabled)
+        flags |= CoalHeaderFlagSectionChecksums;
+    if(trailerChecksumEnabled)
+        flags |= CoalHeaderFlagTrailerChecksum;
+    if(multipleRoots)
+        flags |= CoalHeaderFlagMultipleRoots;
+    if(isDeltaMessage)
+        flags |= CoalHeaderFlagDelta;
+    if(stableObjectIdsEnabled)
+        flags |= CoalHeaderFlagStableObjectIds;
+    output->writeUInt16(flags);
+
+    output->writeUInt32(uint32_t(binaryBlobBuilder.getDataSize() - (isDeltaMessage ? deltaBaselineBlobSize : 0))); // Blob size
+    output->writeUInt32(typeDescriptorContext.getValueTypeCount()); // Value type layouts size
+    output->writeUInt32(uint32_t(clusters.size())); // Cluster Count
+    output->writeUInt32(uint32_t(objectCount)); // Object Count
+}
+
+void Serializer::writeVariableHeader()
+{
+    if(schemaFingerprintEnabled)
+    {
+        output->writeUInt64(encodedSchemaFingerprint);
+        output->writeUInt32(uint32_t(encodedSchema.size()));
+        if(schemaExtended)
+            output->writeUInt64(baseSchemaFingerprint);
+    }
+
+    if(sectionCompressionCodec != CompressionCodec::None)
+        output->writeUInt8(uint8_t(sectionCompressionCodec));
+
+    if(isDeltaMessage)
+    {
+        output->writeUInt32(uint32_t(deltaBaselineBlobSize));
+        output->writeUInt32(deltaBaselineInstanceCount);
+    }
+}
+
+void Serializer::writeBlob()
+{
+    // A delta message only has the data that was appended to the baseline blob.
+    auto blobOffset = isDeltaMessage ? deltaBaselineBlobSize : 0;
+    auto blobData = binaryBlobBuilder.getData() + blobOffset;
+    auto blobDataSize = binaryBlobBuilder.getDataSize() - blobOffset;
+
+    output->setBinaryBlob(&binaryBlobBuilder);
+    if(sectionCompressionCodec == CompressionCodec::None)
+    {
+        output->writeBytes(blobData, blobDataSize);
+        return;
+    }
+
+    CompressingWriteStream blobOutput(output, sectionCompressionCodec);
+    blobOutput.writeBytes(blobData, blobDataSize);
+    blobOutput.finish();
+}
+
+void Serializer::writeValueTypeLayouts()
+{
+    output->setTypeDescriptorContext(&typeDescriptorContext);
+
+    // The encoded schema contains the value type layouts followed by the cluster descriptions.
+    if(schemaElided)
+        return;
+    else if(schemaFingerprintEnabled)
+        output->writeBytes(encodedSchema.data(), encodedSchema.size());
+    else
+        typeDescriptorContext.writeValueTypeLayoutsWith(output);
+}
+
+void Serializer::writeClusterDescriptions()
+{
+    if(schemaFingerprintEnabled)
+        return;
+
+    for(auto &cluster : clusters)
+        cluster->writeDescriptionWith(output, true);
+}
+
+void Serializer::writeClusterInstanceCounts()
+{
+    if(schemaFingerprintEnabled)
+    {
+        for(auto &cluster : clusters)
+            output->writeUInt32(uint32_t(cluster->instances.size()));
+    }
+
+    if(!isDeltaMessage)
+        return;
+
+    for(auto &cluster : clusters)
+    {
+        output->writeUInt32(uint32_t(cluster->updatedInstances.size()));
+        for(auto instance : cluster->updatedInstances)
+            output->writeUInt32(instance->instanceIndex);
+    }
+}
+
+void Serializer::writeStableObjectIds()
+{
+    if(!stableObjectIdsEnabled)
+        return;
+
+    for(auto &cluster : clusters)
+    {
+        for(auto instance : cluster->instances)
+            output->writeUInt64(getStableObjectIdOf(instance->basePointer));
+    }
+}
+
+void Serializer::writeClusterInstances()
+{
+    if(sectionCompressionCodec == CompressionCodec::None)
+    {
+        writeClusterInstancesWith(output);
+        return;
+    }
+
+    CompressingWriteStream instanceOutput(output, sectionCompressionCodec);
+    instanceOutput.setBinaryBlob(&binaryBlobBuilder);
+    instanceOutput.setTypeDescriptorContext(&typeDescriptorContext);
+    instanceOutput.setObjectHandleTable(&objectHandleTable);
+    writeClusterInstancesWith(&instanceOutput);
+    instanceOutput.finish();
+}
+
+void Serializer::writeClusterInstancesWith(WriteStream *instanceOutput)
+{
+    // In delta mode, the instances were already encoded for comparing them with the baseline.
+    if(deltaModeEnabled)
+    {
+        for(auto [offset, size] : deltaWrittenInstances)
+            instanceOutput->writeBytes(deltaInstanceData.data() + offset, size);
+        return;
+    }
+
+    for(auto &cluster : clusters)
+    {
+        if(!encodedInstanceCacheEnabled)
+        {
+            cluster->writeInstancesWith(instanceOutput);
+            continue;
+        }
+
+        for(auto instance : cluster->instances)
+            writeInstanceOf(instance, instanceOutput);
+    }
+}
+
+void Serializer::writeTrailer()
+{
+    if(!multipleRoots)
+    {
+        auto &rootObject = rootObjects.front().second;
+        output->writeObjectPointerAsReference(rootObject ? rootObject->getObjectBasePointer() : nullptr);
+        return;
+    }
+
+    output->writeUInt32(uint32_t(rootObjects.size()));
+    for(auto &[name, rootObject] : rootObjects)
+    {
+        output->writeUTF8_32_16(name);
+        output->writeObjectPointerAsReference(rootObject ? rootObject->getObjectBasePointer() : nullptr);
+    }
+}
+
+void Serializer::beginSection()
+{
+    if(!sectionChecksumsEnabled)
+        return;
+
+    sectionData.clear();
+    output = sectionOutput;
+}
+
+void Serializer::endSection()
+{
+    if(!sectionChecksumsEnabled)
+        return;
+
+    // The size precedes the section, so that a reader can verify the section before parsing it.
+    output = checksumOutput;
+    output->writeUInt32(uint32_t(sectionData.size()));
+    output->writeBytes(sectionData.data(), sectionData.size());
+    checksumOutput->writeSectionChecksum();
+}
+
+void Serializer::prepareForWriting()
+{
+    isDeltaMessage = false;
+    if(deltaModeEnabled)
+    {
+        // The unreachable objects and the strings of the replaced values accumulate in the baseline of the reader, until a complete message is written.
+        size_t tracedObjectCount = 0;
+        for(auto &cluster : clusters)
+            tracedObjectCount += cluster->instances.size();
+        isDeltaMessage = hasDeltaBaseline && deltaBaselineInstanceCount <= 2*tracedObjectCount + 64 &&
+            deltaBaselineBlobSize <= 2*deltaCompleteBlobSize + 4096;
+
+        if(!isDeltaMessage)
+        {
+            binaryBlobBuilder.clear();
+            deltaBaseline.clear();
+            deltaBaselineInstanceData.clear();
+            deltaBaselineBlobSize = 0;
+            deltaBaselineInstanceCount = 0;
+
+            // The layout strings may have been appended after instance data.
+            hasEncodedSchema = false;
+        }
+    }
+
+    // Layouts are only added while the root type is the same, so the encoded schema is still valid if their count did not change.
+    // An extension is only valid for a reader that has the schema that it extends.
+    auto isEncodedSchemaKnown = schemaFingerprintEnabled && sessionModeEnabled && hasEncodedSchema &&
+        sessionSchemaFingerprints.find(encodedSchemaFingerprint) != sessionSchemaFingerprints.end();
+    auto isEncodedSchemaValid = hasEncodedSchema && (isEncodedSchemaKnown || !isEncodedSchemaExtension) &&
+        encodedSchemaValueTypeCount == typeDescriptorContext.getValueTypeCount() &&
+        encodedSchemaClusterCount == clusters.size();
+    schemaElided = isEncodedSchemaKnown && isEncodedSchemaValid;
+
+    // The layouts of the new types are appended to the known schema, so only they are sent.
+    schemaExtended = isEncodedSchemaKnown && !isEncodedSchemaValid;
+    auto firstNewValueTypeIndex = schemaExtended ? uint32_t(encodedSchemaValueTypeCount) : 0;
+    auto firstNewClusterIndex = schemaExtended ? encodedSchemaClusterCount : 0;
+
+    // The layout strings are placed first, so that their offsets only depend on the schema.
+    if(!schemaElided)
+    {
+        typeDescriptorContext.pushDataIntoBinaryBlob(binaryBlobBuilder, firstNewValueTypeIndex);
+        for(size_t i = firstNewClusterIndex; i < clusters.size(); ++i)
+            clusters[i]->pushLayoutDataIntoBinaryBlob(binaryBlobBuilder);
+    }
+
+    for(auto &cluster : clusters)
+        typeDescriptorContext.addObjectTypeMapper(cluster->typeMapper);
+
+    auto schemaBlobSize = binaryBlobBuilder.getDataSize();
+
+    for(auto &cluster : clusters)
+    {
+        if(!isDeltaMessage && !encodedInstanceCacheEnabled)
+        {
+            cluster->pushInstanceDataIntoBinaryBlob(binaryBlobBuilder);
+            continue;
+        }
+
+        // The strings of the unmodified baseline objects are still in the retained blob.
+        for(auto instance : cluster->instances)
+        {
+            if(!isDeltaMessage || !isUnmodifiedSinceDeltaBaseline(instance))
+                pushInstanceDataOf(instance);
+        }
+    }
+
+    if(encodedInstanceCacheEnabled)
+        pruneEncodedInstanceCache();
+
+    if(stableObjectIdsEnabled)
+        assignStableObjectIds();
+
+    if(deltaModeEnabled)
+    {
+        prepareDeltaForWriting();
+    }
+    else
+    {
+        objectCount = 0;
+        for(auto &cluster : clusters)
+        {
+            for(auto instance : cluster->instances)
+                instance->instanceIndex = uint32_t(objectCount++);
+        }
+    }
+
+    if(multipleRoots)
+    {
+        for(auto &root : rootObjects)
+            binaryBlobBuilder.internString16(root.first);
+    }
+
+    output->setObjectHandleTable(&objectHandleTable);
+
+    if(!schemaFingerprintEnabled)
+        return;
+
+    if(!isEncodedSchemaValid)
+        encodeSchema(schemaBlobSize);
+    if(sessionModeEnabled)
+        sessionSchemaFingerprints.insert(encodedSchemaFingerprint);
+}
+
+void Serializer::assignStableObjectIds()
+{
+    ++stableObjectIdGeneration;
+    for(auto &cluster : clusters)
+    {
+        for(auto instance : cluster->instances)
+        {
+            // The address of a destroyed object may be reused, so only an object with an identity can keep its identifier.
+            auto identity = instance->typeMapper->getIdentityOfInstance(instance->basePointer);
+            if(identity == 0)
+                continue;
+
+            auto &entry = stableObjectIds[instance->basePointer];
+            if(entry.id == 0 || entry.identity != identity)
+            {
+                entry.identity = identity;
+                entry.id = nextStableObjectId++;
+            }
+            entry.generation = stableObjectIdGeneration;
+        }
+    }
+
+    // Forget the objects that are not reachable anymore.
+    for(auto it = stableObjectIds.begin(); it != stableObjectIds.end(); )
+    {
+        if(it->second.generation != stableObjectIdGeneration)
+            it = stableObjectIds.erase(it);
+        else
+            ++it;
+    }
+}
+
+bool Serializer::isUnmodifiedSinceDeltaBaseline(ObjectHandle *instance)
+{
+    auto dirtyGeneration = instance->typeMapper->getDirtyGenerationOfInstance(instance->basePointer);
+    if(dirtyGeneration == 0)
+        return false;
+
+    auto it = deltaBaseline.find(instance->basePointer);
+    return it != deltaBaseline.end() && it->second.typeMapper == instance->typeMapper && it->second.dirtyGeneration == dirtyGeneration;
+}
+
+void Serializer::prepareDeltaForWriting()
+{
+    // The baseline objects keep their index, and the new objects are appended in cluster order, as the reader does.
+    auto nextInstanceIndex = deltaBaselineInstanceCount;
+    for(auto &cluster : clusters)
+    {
+        auto &instances = cluster->instances;
+        size_t newInstanceCount = 0;
+        for(size_t i = 0; i < instances.size(); ++i)
+        {
+            auto instance = instances[i];
+            auto it = deltaBaseline.find(instance->basePointer);
+            if(it != deltaBaseline.end() && it->second.typeMapper == instance->typeMapper)
+            {
+                instance->instanceIndex = it->second.instanceIndex;
+                cluster->updatedInstances.push_back(instance);
+            }
+            else
+            {
+                instance->instanceIndex = nextInstanceIndex++;
+                instances[newInstanceCount++] = instance;
+            }
+        }
+        instances.resize(newInstanceCount);
+    }
+
+    // Encode every instance, and only keep the baseline instances whose encoding changed.
+    deltaInstanceData.clear();
+    deltaWrittenInstances.clear();
+    MemoryWriteStream instanceOutput(deltaInstanceData);
+    instanceOutput.setBinaryBlob(&binaryBlobBuilder);
+    instanceOutput.setTypeDescriptorContext(&typeDescriptorContext);
+    instanceOutput.setObjectHandleTable(&objectHandleTable);
+
+    objectCount = 0;
+    for(auto &cluster : clusters)
+    {
+        auto &updatedInstances = cluster->updatedInstances;
+        size_t changedInstanceCount = 0;
+        for(size_t i = 0; i < updatedInstances.size(); ++i)
+        {
+            auto instance = updatedInstances[i];
+            auto &entry = deltaBaseline[instance->basePointer];
+            auto offset = deltaInstanceData.size();
+
+            // The encoding of an unmodified dirty tracked object is reused instead of being compared.
+            auto dirtyGeneration = cluster->typeMapper->getDirtyGenerationOfInstance(instance->basePointer);
+            auto isChanged = false;
+            if(dirtyGeneration != 0 && dirtyGeneration == entry.dirtyGeneration)
+            {
+                instanceOutput.writeBytes(deltaBaselineInstanceData.data() + entry.dataOffset, entry.dataSize);
+            }
+            else
+            {
+                writeInstanceOf(instance, &instanceOutput);
+                auto size = deltaInstanceData.size() - offset;
+                isChanged = size != entry.dataSize ||
+                    (size > 0 && memcmp(deltaInstanceData.data() + offset, deltaBaselineInstanceData.data() + entry.dataOffset, size) != 0);
+            }
+
+            entry.dataOffset = offset;
+            entry.dataSize = deltaInstanceData.size() - offset;
+            entry.dirtyGeneration = dirtyGeneration;
+            if(isChanged)
+            {
+                updatedInstances[changedInstanceCount++] = instance;
+                deltaWrittenInstances.push_back({offset, entry.dataSize});
+            }
+        }
+        updatedInstances.resize(changedInstanceCount);
+
+        for(auto instance : cluster->instances)
+        {
+            auto dirtyGeneration = cluster->typeMapper->getDirtyGenerationOfInstance(instance->basePointer);
+            auto offset = deltaInstanceData.size();
+            writeInstanceOf(instance, &instanceOutput);
+            auto size = deltaInstanceData.size() - offset;
+
+            deltaBaseline[instance->basePointer] = DeltaBaselineEntry{instance->typeMapper, instance->instanceIndex, offset, size, dirtyGeneration};
+            deltaWrittenInstances.push_back({offset, size});
+        }
+        objectCount += cluster->instances.size();
+    }
+}
+
+void Serializer::encodeSchema(size_t schemaBlobSize)
+{
+    auto firstNewValueTypeIndex = schemaExtended ? uint32_t(encodedSchemaValueTypeCount) : 0;
+    auto firstNewClusterIndex = schemaExtended ? encodedSchemaClusterCount : 0;
+
+    encodedSchema.clear();
+    MemoryWriteStream schemaOutput(encodedSchema);
+    schemaOutput.setBinaryBlob(&binaryBlobBuilder);
+    schemaOutput.setTypeDescriptorContext(&typeDescriptorContext);
+
+    typeDescriptorContext.writeValueTypeLayoutsWith(&schemaOutput, firstNewValueTypeIndex);
+    for(size_t i = firstNewClusterIndex; i < clusters.size(); ++i)
+        clusters[i]->writeDescriptionWith(&schemaOutput, false);
+
+    // The encoded schema only has the blob offsets of the names, so their content is also part of the fingerprint.
+    // The fingerprint of an extension is chained to the fingerprint of the schema that it extends.
+    if(schemaExtended)
+    {
+        baseSchemaFingerprint = encodedSchemaFingerprint;
+        encodedSchemaFingerprint = fingerprintForBytes(binaryBlobBuilder.getData(), schemaBlobSize, baseSchemaFingerprint);
+    }
+    else
+    {
+        encodedSchemaFingerprint = fingerprintForBytes(binaryBlobBuilder.getData(), schemaBlobSize);
+    }
+    encodedSchemaFingerprint = fingerprintForBytes(encodedSchema.data(), encodedSchema.size(), encodedSchemaFingerprint);
+    encodedSchemaValueTypeCount = typeDescriptorContext.getValueTypeCount();
+    encodedSchemaClusterCount = clusters.size();
+    isEncodedSchemaExtension = schemaExtended;
+    hasEncodedSchema = true;
+}
+
+#pragma endregion Serializer
+
+#pragma region SchemaResolutionCache
+
+SchemaResolutionCache &SchemaResolutionCache::uniqueInstance()
+{
+    static SchemaResolutionCache singleton;
+    return singleton;
+}
+
+DeserializationSchemaPtr SchemaResolutionCache::find(const TypeMapperRegistryPtr &registry, uint64_t fingerprint)
+{
+    std::unique_lock<std::mutex> l(mutex);
+    auto it = entries.find({registry.get(), fingerprint});
+    return it != entries.end() ? it->second : nullptr;
+}
+
+void SchemaResolutionCache::add(const TypeMapperRegistryPtr &registry, const DeserializationSchemaPtr &schema)
+{
+    std::unique_lock<std::mutex> l(mutex);
+    if(entries.size() >= Capacity)
+        entries.clear();
+
+    entries[{registry.get(), schema->fingerprint}] = schema;
+}
+
+void SchemaResolutionCache::clear()
+{
+    std::unique_lock<std::mutex> l(mutex);
+    entries.clear();
+}
+
+#pragma endregion SchemaResolutionCache
+
+#pragma region Deserializer
+
+Deserializer::Deserializer(ReadStream *initialInput)
+    : input(initialInput)
+{
+}
+
+void Deserializer::reset()
+{
+    rootObjects.clear();
+    rootNames.clear();
+    typeDescriptorContext.clear();
+    headerFlags = 0;
+    valueTypeCount = 0;
+    clusterCount = 0;
+    objectCount = 0;
+    schemaFingerprint = 0;
+    baseSchemaFingerprint = 0;
+    schemaSize = 0;
+    blobSize = 0;
+    sectionCompressionCodec = CompressionCodec::None;
+    clusterInstanceCount.clear();
+    clusterUpdatedInstances.clear();
+    deltaBaselineInstanceCount = 0;
+
+    newInstanceStableIds.clear();
+
+    // The blob and the instances are the baseline of the next delta message.
+    if(!deltaModeEnabled)
+    {
+        clearBlobData();
+        instances.clear();
+        exclusiveOwnershipTable.clear();
+        objectsByStableId.clear();
+        stableIdsByObject.clear();
+    }
+}
+
+void Deserializer::reset(ReadStream *newInput)
+{
+    reset();
+    input = newInput;
+}
+
+void Deserializer::setSessionModeEnabled(bool enabled)
+{
+    sessionModeEnabled = enabled;
+    sessionSchemas.clear();
+}
+
+void Deserializer::setDeltaModeEnabled(bool enabled)
+{
+    deltaModeEnabled = enabled;
+    hasDeltaBaseline = false;
+    clearBlobData();
+    instances.clear();
+    exclusiveOwnershipTable.clear();
+    objectsByStableId.clear();
+    stableIdsByObject.clear();
+}
+
+std::shared_ptr<const std::vector<uint8_t>> Deserializer::getBinaryBlobHandle() const
+{
+    return blobData;
+}
+
+void Deserializer::setBinaryBlobViewsEnabled(bool enabled)
+{
+    binaryBlobViewsEnabled = enabled;
+}
+
+void Deserializer::setStringPoolEnabled(bool enabled)
+{
+    stringPoolEnabled = enabled;
+    stringPool.clear();
+}
+
+size_t Deserializer::getStringPoolSize() const
+{
+    return stringPool.size();
+}
+
+void Deserializer::clearBlobData()
+{
+    stringPool.clear();
+    if(blobData.use_count() > 1)
+        blobData = std::make_shared<std::vector<uint8_t>> ();
+    else
+        blobData->clear();
+}
+
+void Deserializer::detachSharedBlobData(size_t retainedSize)
+{
+    // The views into a blob whose handle is held must not be overwritten nor moved by a reallocation.
+    if(blobData.use_count() > 1)
+        blobData = std::make_shared<std::vector<uint8_t>> (blobData->begin(), blobData->begin() + retainedSize);
+}
+
+ObjectMapperPtr Deserializer::deserializeRootObject(const TypeMapperPtr &rootTypeMapper)
+{
+    if(!deserializeRootObjects({rootTypeMapper}))
+        return nullptr;
+    return getRootObjectAt(0);
+}
+
+bool Deserializer::deserializeRootObjects(const std::vector<TypeMapperPtr> &rootTypeMappers)
+{
+    reset();
+    if(!typeMapperRegistry || registryRootTypeMappers != rootTypeMappers)
+    {
+        registryRootTypeMappers = rootTypeMappers;
+        typeMapperRegistry = TypeMapperRegistry::getOrCreateForTransitiveClosureOfAll(rootTypeMappers);
+        schema.reset();
+    }
+
+    auto result = parseContent();
+    if(deltaModeEnabled)
+        hasDeltaBaseline = result;
+    return result;
+}
+
+size_t Deserializer::getRootObjectCount() const
+{
+    return rootObjects.size();
+}
+
+ObjectMapperPtr Deserializer::getRootObjectAt(size_t index) const
+{
+    return index < rootObjects.size() ? rootObjects[index] : nullptr;
+}
+
+uint64_t Deserializer::getStableObjectIdOf(const void *objectBasePointer) const
+{
+    auto it = stableIdsByObject.find(objectBasePointer);
+    return it != stableIdsByObject.end() ? it->second : 0;
+}
+
+ObjectMapperPtr Deserializer::getObjectWithStableId(uint64_t id) const
+{
+    auto it = objectsByStableId.find(id);
+    return it != objectsByStableId.end() ? it->second : nullptr;
+}
+
+ObjectMapperPtr Deserializer::getRootObjectNamed(const std::string &name) const
+{
+    for(size_t i = 0; i < rootNames.size(); ++i)
+    {
+        if(rootNames[i] == name)
+            return rootObjects[i];
+    }
+
+    return nullptr;
+}
+
+bool Deserializer::parseFixedHeader()
+{
+    // The fixed part of the header is read before knowing whether it is covered by a checksum.
+    if(!input->readBytes(fixedHeader.data(), fixedHeader.size()))
+        return false;
+
+    MemoryReadStream headerInput(fixedHeader.data(), fixedHeader.size());
+    uint32_t magicNumber;
+    uint8_t versionMajor, versionMinor;
+
+    if(!headerInput.readUInt32(magicNumber) || magicNumber != CoalMagicNumber)
+        return false;
+
+    if(!headerInput.readUInt8(versionMajor) || versionMajor != CoalVersionMajor)
+        return false;
+
+    if(!headerInput.readUInt8(versionMinor) || versionMinor > CoalVersionMinor)
+        return false;
+
+    if (!headerInput.readUInt16(headerFlags) || (headerFlags & ~CoalHeaderSupportedFlags) != 0 ||
+        !headerInput.readUInt32(blobSize) ||
+        !headerInput.readUInt32(valueTypeCount) ||
+        !headerInput.readUInt32(clusterCount) ||
+        !headerInput.readUInt32(objectCount))
+        return false;
+
+    if((headerFlags & CoalHeaderFlagSchemaElided) && (headerFlags & CoalHeaderFlagSchemaFingerprint) == 0)
+        return false;
+
+    if((headerFlags & CoalHeaderFlagSchemaExtension) &&
+        ((headerFlags & CoalHeaderFlagSchemaFingerprint) == 0 || (headerFlags & CoalHeaderFlagSchemaElided) != 0))
+        return false;
+
+    return true;
+}
+
+bool Deserializer::parseHeaderAndReadBlob()
+{
+    if((headerFlags & CoalHeaderFlagSchemaFingerprint) &&
+        (!input->readUInt64(schemaFingerprint) || !input->readUInt32(schemaSize)))
+        return false;
+
+    if((headerFlags & CoalHeaderFlagSchemaExtension) && !input->readUInt64(baseSchemaFingerprint))
+        return false;
+
+    if(headerFlags & CoalHeaderFlagCompressedSections)
     {
-        auto currentColor = it->second;
-        assert(currentColor == ValueTypeScanColor::Black && "Recursive value types are not allowed.");
-        if(currentColor == ValueTypeScanColor::Gray)
-            abort();
-        
-        return typeDescriptorContext.getForTypeMapper(typeMapper);
+        uint8_t codecByte = 0;
+        if(!input->readUInt8(codecByte))
+            return false;
+
+        sectionCompressionCodec = CompressionCodec(codecByte);
+        if(sectionCompressionCodec == CompressionCodec::None || !isCompressionCodecSupported(sectionCompressionCodec))
+            return false;
     }
 
-    // Scan the dependencies recursively.
-    valueTypeScanColorMap[typeMapper] = ValueTypeScanColor::Gray;
-    typeMapper->typeMapperDependenciesDo([&](const TypeMapperPtr &dependency) {
-        scanTypeMapperDependency(dependency);
-    });
-    
-    valueTypeScanColorMap[typeMapper] = ValueTypeScanColor::Black;
+    // The blob of a delta message is appended to the baseline blob.
+    size_t blobOffset = 0;
+    if(headerFlags & CoalHeaderFlagDelta)
+    {
+        uint32_t baselineBlobSize = 0;
+        if(!deltaModeEnabled || !hasDeltaBaseline ||
+            !input->readUInt32(baselineBlobSize) ||
+            !input->readUInt32(deltaBaselineInstanceCount) ||
+            baselineBlobSize != blobData->size() ||
+            deltaBaselineInstanceCount != instances.size())
+            return false;
 
-    // Add the value type.
-    return typeDescriptorContext.addValueType(typeMapper);
-}
+        blobOffset = baselineBlobSize;
+    }
+    else
+    {
+        instances.clear();
+        exclusiveOwnershipTable.clear();
+        objectsByStableId.clear();
+        stableIdsByObject.clear();
+    }
 
-void Serializer::scanReferenceTypeDependencies(const TypeMapperPtr &typeMapper)
-{
-    if(scannedReferenceType.find(typeMapper) == scannedReferenceType.end())
-        return;
+    // The pooled strings are keyed by their blob offsets.
+    if(blobOffset == 0)
+        stringPool.clear();
 
-    scannedReferenceType.insert(typeMapper);
-    typeMapper->typeMapperDependenciesDo([&](const TypeMapperPtr &dependency) {
-        scanTypeMapperDependency(dependency);
-    });
+    detachSharedBlobData(blobOffset);
+    blobData->resize(blobOffset + blobSize);
+    if(sectionCompressionCodec == CompressionCodec::None)
+    {
+        if(!input->readBytes(blobData->data() + blobOffset, blobSize))
+            return false;
+    }
+    else
+    {
+        DecompressingReadStream blobInput(input, sectionCompressionCodec);
+        if(!blobInput.readBytes(blobData->data() + blobOffset, blobSize) || !blobInput.finish())
+            return false;
+    }
+    input->setBinaryBlob(blobData->data(), blobData->size());
+    input->setStringPool(stringPoolEnabled ? &stringPool : nullptr);
+    input->setBinaryBlobViewsEnabled(binaryBlobViewsEnabled);
+    input->setTypeDescriptorContext(&typeDescriptorContext);
+
+    return true;
 }
 
-void Serializer::scanTypeMapperDependency(const TypeMapperPtr &typeMapper)
+/**
+ * I append some data that is read from a stream into a buffer. The buffer grows with the read data, so that a corrupted size fails without allocating it.
+ */
+static bool readIntoBuffer(ReadStream *source, std::vector<uint8_t> &buffer, size_t size)
 {
-    if(typeMapper->isObjectType())
-        getOrCreateClusterFor(typeMapper);
-    else if(typeMapper->isAggregateType())
-        getOrCreateAggregateTypeDescriptorFor(typeMapper);
-    else if(typeMapper->isReferenceType())
-        scanReferenceTypeDependencies(typeMapper);
+    auto bufferEnd = buffer.size() + size;
+    while(buffer.size() < bufferEnd)
+    {
+        auto readOffset = buffer.size();
+        auto readSize = std::min(bufferEnd - readOffset, std::max(readOffset, size_t(64*1024)));
+        buffer.resize(readOffset + readSize);
+        if(!source->readBytes(buffer.data() + readOffset, readSize))
+            return false;
+    }
+
+    return true;
 }
 
-SerializationClusterPtr Serializer::getOrCreateClusterFor(const TypeMapperPtr &typeMapper)
+bool Deserializer::parseContent()
 {
-    assert(typeMapper->isObjectType());
-    auto it = typeMapperToClustersMap.find(typeMapper);
-    if(it != typeMapperToClustersMap.end())
-        return it->second;
+    if(!parseFixedHeader())
+        return false;
 
-    SerializationClusterPtr supertypeCluster;
-    auto superType = typeMapper->getSuperType();
-    if(superType)
+    if((headerFlags & (CoalHeaderFlagSectionChecksums | CoalHeaderFlagTrailerChecksum)) == 0)
+        return parseSections();
+
+    auto rawInput = input;
+    auto result = false;
+    messageChecksum = 0;
+    if(headerFlags & CoalHeaderFlagSectionChecksums)
     {
-        supertypeCluster = getOrCreateClusterFor(superType);
-        it = typeMapperToClustersMap.find(typeMapper);
-        if(it != typeMapperToClustersMap.end())
-            return it->second;
+        // The sections are parsed from memory after verifying them.
+        MemoryReadStream sectionStream(nullptr, 0);
+        pendingChecksum = crc32c(fixedHeader.data(), fixedHeader.size());
+        pendingSize = fixedHeader.size();
+        sectionSource = rawInput;
+        sectionInput = &sectionStream;
+        result = parseSections();
+        sectionSource = nullptr;
+        sectionInput = nullptr;
+    }
+    else if(auto messageData = rawInput->peekContiguousBytes(0))
+    {
+        // The checksum of a message in memory is computed over the parsed range at once.
+        result = parseSections();
+        if(result)
+        {
+            auto parsedSize = size_t(rawInput->peekContiguousBytes(0) - messageData);
+            messageChecksum = crc32c(messageData, parsedSize, crc32c(fixedHeader.data(), fixedHeader.size()));
+        }
+    }
+    else
+    {
+        Crc32cReadStream checksumStream(rawInput);
+        checksumStream.includeBytes(fixedHeader.data(), fixedHeader.size());
+        input = &checksumStream;
+        result = parseSections();
+        messageChecksum = checksumStream.finish();
     }
 
-    auto newCluster = std::make_shared<SerializationCluster> ();
-    newCluster->name = typeMapper->getName();
-    newCluster->typeMapper = typeMapper;
-    newCluster->index = clusters.size();
-    newCluster->supertype = supertypeCluster;
-    clusters.push_back(newCluster);
-    typeMapperToClustersMap.insert(std::make_pair(typeMapper, newCluster));
+    input = rawInput;
+    if(!result)
+        return false;
 
-    typeMapper->typeMapperDependenciesDo([&](const TypeMapperPtr &dependency) {
-        scanTypeMapperDependency(dependency);
-    });
+    if(headerFlags & CoalHeaderFlagTrailerChecksum)
+    {
+        uint32_t expectedChecksum = 0;
+        if(!input->readUInt32(expectedChecksum) || expectedChecksum != messageChecksum)
+            return false;
+    }
 
-    return newCluster;
+    return true;
 }
 
-void Serializer::writeHeader()
+bool Deserializer::beginSection()
 {
-    output->writeUInt32(CoalMagicNumber);
-    output->writeUInt8(CoalVersionMajor);
-    output->writeUInt8(CoalVersionMinor);
-    output->writeUInt16(0); // Reserved
+    if((headerFlags & CoalHeaderFlagSectionChecksums) == 0)
+        return true;
 
-    output->writeUInt32(uint32_t(binaryBlobBuilder.getDataSize())); // Blob size
-    output->writeUInt32(typeDescriptorContext.getValueTypeCount()); // Value type layouts size
-    output->writeUInt32(uint32_t(clusters.size())); // Cluster Count
-    output->writeUInt32(uint32_t(objectCount)); // Object Count
-}
+    // A section in memory is verified in place. A section from another stream is read into a buffer first.
+    uint32_t sectionSize = 0;
+    const uint8_t *sectionData = nullptr;
+    if(auto sizeData = sectionSource->peekContiguousBytes(4))
+    {
+        memcpy(&sectionSize, sizeData, 4);
+        auto storedSize = 4 + size_t(sectionSize) + 4;
+        sectionData = sectionSource->peekContiguousBytes(storedSize);
+        if(!sectionData || !sectionSource->skipBytes(storedSize))
+            return false;
+    }
+    else
+    {
+        sectionBuffer.resize(4);
+        if(!sectionSource->readUInt32(sectionSize))
+            return false;
+        memcpy(sectionBuffer.data(), &sectionSize, 4);
+        if(!readIntoBuffer(sectionSource, sectionBuffer, size_t(sectionSize) + 4))
+            return false;
+        sectionData = sectionBuffer.data();
+    }
 
-void Serializer::writeBlob()
-{
-    output->writeBlob(&binaryBlobBuilder);
-}
+    // The checksum covers the data since the previous checksum, which is the fixed header for the first section.
+    auto checkedSize = 4 + size_t(sectionSize);
+    auto checksum = crc32c(sectionData, checkedSize, pendingChecksum);
+    uint32_t expectedChecksum = 0;
+    memcpy(&expectedChecksum, sectionData + checkedSize, 4);
+    if(expectedChecksum != checksum)
+        return false;
 
-void Serializer::writeValueTypeLayouts()
-{
-    output->setTypeDescriptorContext(&typeDescriptorContext);
-    typeDescriptorContext.writeValueTypeLayoutsWith(output);
-}
+    messageChecksum = crc32c(sectionData + checkedSize, 4, crc32cCombine(messageChecksum, checksum, pendingSize + checkedSize));
+    pendingChecksum = 0;
+    pendingSize = 0;
 
-void Serializer::writeClusterDescriptions()
-{
-    for(auto &cluster : clusters)
-        cluster->writeDescriptionWith(output);
+    sectionInput->reset(sectionData + 4, sectionSize);
+    input = sectionInput;
+    return true;
 }
 
-void Serializer::writeClusterInstances()
+bool Deserializer::endSection()
 {
-    for(auto &cluster : clusters)
-        cluster->writeInstancesWith(output);
-}
+    if((headerFlags & CoalHeaderFlagSectionChecksums) == 0)
+        return true;
 
-void Serializer::writeTrailerForObject(const ObjectMapperPtr &rootObject)
-{
-    output->writeUInt32(objectPointerToInstanceIndexTable.at(rootObject->getObjectBasePointer()) + 1);
+    input = sectionSource;
+    return sectionInput->getRemainingSize() == 0;
 }
 
-void Serializer::prepareForWriting()
+bool Deserializer::parseSections()
 {
-    objectCount = 0;
-    typeDescriptorContext.pushDataIntoBinaryBlob(binaryBlobBuilder);
-    for(auto & cluster : clusters)
+    if(!beginSection() || !parseHeaderAndReadBlob() || !endSection() ||
+        !beginSection())
+        return false;
+
+    // A schema with a fingerprint is compared against the cached schema before parsing it.
+    const uint8_t *schemaData = nullptr;
+    if((headerFlags & CoalHeaderFlagSchemaFingerprint) && (headerFlags & CoalHeaderFlagSchemaElided) == 0 &&
+        !readSchemaData(schemaData))
+        return false;
+
+    if(headerFlags & CoalHeaderFlagSchemaExtension)
     {
-        cluster->pushDataIntoBinaryBlob(binaryBlobBuilder);
-        typeDescriptorContext.addObjectTypeMapper(cluster->typeMapper);
-        for(auto instance : cluster->instances)
-            objectPointerToInstanceIndexTable.insert({instance->getObjectBasePointer(), uint32_t(objectCount++)});
+        if(!extendSessionSchema(schemaData))
+            return false;
     }
+    else if(!useCachedSchema(schemaData))
+    {
+        if(headerFlags & CoalHeaderFlagSchemaElided)
+            return false;
 
-    output->setObjectPointerToIndexMap(&objectPointerToInstanceIndexTable);
-}
-
-#pragma endregion Serializer
+        schema = std::make_shared<DeserializationSchema> ();
+        schema->fingerprint = schemaFingerprint;
+        schema->size = schemaSize;
+        schema->valueTypeCount = valueTypeCount;
+        if(!parseSchema(schemaData))
+        {
+            schema.reset();
+            return false;
+        }
 
-#pragma region Deserializer
+        if(headerFlags & CoalHeaderFlagSchemaFingerprint)
+        {
+            SchemaResolutionCache::uniqueInstance().add(typeMapperRegistry, schema);
+            if(sessionModeEnabled)
+                sessionSchemas[{typeMapperRegistry.get(), schema->fingerprint}] = schema;
+        }
+    }
 
-Deserializer::Deserializer(ReadStream *initialInput)
-    : input(initialInput)
-{
+    return endSection() &&
+        beginSection() &&
+        parseClusterInstanceCounts() &&
+        parseStableObjectIds() &&
+        parseClusterInstances() &&
+        parseTrailer() &&
+        endSection();
 }
 
-ObjectMapperPtr Deserializer::deserializeRootObject(const TypeMapperPtr &rootTypeMapper)
+bool Deserializer::readSchemaData(const uint8_t *&schemaData)
 {
-    if(!typeMapperRegistry)
-        typeMapperRegistry = TypeMapperRegistry::getOrCreateForTransitiveClosureOf(rootTypeMapper);
+    schemaData = input->peekContiguousBytes(schemaSize);
+    if(schemaData)
+        return input->skipBytes(schemaSize);
 
-    if(!parseContent())
-        return nullptr;
-    return rootObject;
+    schemaBuffer.clear();
+    if(!readIntoBuffer(input, schemaBuffer, schemaSize))
+        return false;
+
+    schemaData = schemaBuffer.data();
+    return true;
 }
 
-bool Deserializer::parseHeaderAndReadBlob()
+bool Deserializer::useCachedSchema(const uint8_t *schemaData)
 {
-    uint32_t magicNumber;
-    uint8_t versionMajor, versionMinor;
-    uint16_t reserved;
-    uint32_t blobSize;
+    if((headerFlags & CoalHeaderFlagSchemaFingerprint) == 0)
+        return false;
 
-    if(!input->readUInt32(magicNumber) || magicNumber != CoalMagicNumber)
+    // The schema of the previous message is checked first for avoiding the cache lock.
+    // An elided schema is only taken from this deserializer, because it cannot be compared.
+    if(!schema || schema->fingerprint != schemaFingerprint)
+    {
+        auto it = sessionSchemas.find({typeMapperRegistry.get(), schemaFingerprint});
+        if(it != sessionSchemas.end())
+            schema = it->second;
+        else if(schemaData)
+            schema = SchemaResolutionCache::uniqueInstance().find(typeMapperRegistry, schemaFingerprint);
+        else
+            schema.reset();
+    }
+
+    if(!schema ||
+        schema->size != schemaSize ||
+        schema->valueTypeCount != valueTypeCount ||
+        schema->clusterTypes.size() != clusterCount)
         return false;
 
-    if(!input->readUInt8(versionMajor) || versionMajor != CoalVersionMajor)
+    // The fingerprint is not collision resistant, so the schema and its names must also be the same.
+    if(schemaData &&
+        (schema->encoding.size() != schemaSize ||
+        memcmp(schema->encoding.data(), schemaData, schemaSize) != 0 ||
+        schema->nameData.size() > blobData->size() ||
+        memcmp(schema->nameData.data(), blobData->data(), schema->nameData.size()) != 0))
         return false;
 
-    if(!input->readUInt8(versionMinor) || versionMinor != CoalVersionMinor)
+    if(sessionModeEnabled)
+        sessionSchemas.insert({{typeMapperRegistry.get(), schema->fingerprint}, schema});
+
+    return true;
+}
+
+bool Deserializer::extendSessionSchema(const uint8_t *schemaData)
+{
+    // The extended schema is only in the session of the writer, so it cannot be taken from the process wide cache.
+    auto it = sessionSchemas.find({typeMapperRegistry.get(), baseSchemaFingerprint});
+    if(!sessionModeEnabled || it == sessionSchemas.end())
         return false;
 
-    if (!input->readUInt16(reserved) ||
-        !input->readUInt32(blobSize) ||
-        !input->readUInt32(valueTypeCount) ||
-        !input->readUInt32(clusterCount) ||
-        !input->readUInt32(objectCount))
+    auto baseSchema = it->second;
+    if(baseSchema->valueTypeCount > valueTypeCount || baseSchema->clusterTypes.size() > clusterCount)
         return false;
 
-    blobData.resize(blobSize);
-    if(!input->readBytes(blobData.data(), blobSize))
+    // The layouts of the extension reference the types of the base schema by their index.
+    schema = std::make_shared<DeserializationSchema> ();
+    schema->fingerprint = schemaFingerprint;
+    schema->size = schemaSize;
+    schema->valueTypeCount = valueTypeCount;
+    schema->valueTypes = baseSchema->valueTypes;
+    schema->clusterTypes = baseSchema->clusterTypes;
+    for(auto &valueType : schema->valueTypes)
+        typeDescriptorContext.addValueType(valueType);
+    for(auto &clusterType : schema->clusterTypes)
+        typeDescriptorContext.addObjectTypeMapper(clusterType);
+
+    if(!parseSchema(schemaData))
+    {
+        schema.reset();
         return false;
-    input->setBinaryBlob(blobData.data(), blobSize);
-    input->setTypeDescriptorContext(&typeDescriptorContext);
+    }
 
+    sessionSchemas[{typeMapperRegistry.get(), schema->fingerprint}] = schema;
     return true;
 }
 
-bool Deserializer::parseContent()
+bool Deserializer::parseSchema(const uint8_t *schemaData)
 {
-    return parseHeaderAndReadBlob() &&
-        parseValueTypeDescriptors() &&
-        parseClusterDescriptors() &&
-        validateAndResolveTypes() &&
-        parseClusterInstances() &&
-        parseTrailer();
+    if(!schemaData)
+    {
+        return parseValueTypeDescriptors() &&
+            parseClusterDescriptors() &&
+            validateAndResolveTypes(0);
+    }
+
+    auto firstNewClusterIndex = schema->clusterTypes.size();
+    MemoryReadStream schemaInput(schemaData, schemaSize);
+    schemaInput.setBinaryBlob(blobData->data(), blobData->size());
+    schemaInput.setTypeDescriptorContext(&typeDescriptorContext);
+    auto messageInput = input;
+    input = &schemaInput;
+    auto result = parseValueTypeDescriptors() && parseClusterDescriptors();
+    input = messageInput;
+    if(!result || schemaInput.getRemainingSize() != 0)
+        return false;
+
+    // The schema only has the blob offsets of its names, which are placed first in the blob.
+    schema->encoding.assign(schemaData, schemaData + schemaSize);
+    schema->nameData.assign(blobData->data(), blobData->data() + schemaInput.getBinaryBlobReadEnd());
+    return validateAndResolveTypes(firstNewClusterIndex);
 }
 
 bool Deserializer::parseValueTypeDescriptors()
 {
-    for(uint32_t i = 0; i < valueTypeCount; ++i)
+    for(uint32_t i = typeDescriptorContext.getValueTypeCount(); i < valueTypeCount; ++i)
     {
         auto structureType = std::make_shared<StructureMaterializationTypeMapper> ();
         uint16_t fieldCount;
@@ -1920,18 +3889,26 @@ bool Deserializer::parseValueTypeDescriptors()
                 return false;
         }
 
+        if(typeMapperRegistry->isAmbiguousTypeName(structureType->getName()))
+            return false;
+
         structureType->resolveTypeUsing(typeMapperRegistry->getTypeMapperWithName(structureType->getName()));
         structureType->resolveTypeFields();
         typeDescriptorContext.addValueType(structureType);
+        schema->valueTypes.push_back(structureType);
     }
     return true;
 }
 
 bool Deserializer::parseClusterDescriptors()
 {
-    // Pre-allocate the cluster types.
+    auto &clusterTypes = schema->clusterTypes;
+    bool hasInlineInstanceCount = (headerFlags & CoalHeaderFlagSchemaFingerprint) == 0;
+
+    // Pre-allocate the cluster types. The cluster types of an extended schema are already present.
+    auto firstNewClusterIndex = uint32_t(clusterTypes.size());
     clusterTypes.reserve(clusterCount);
-    for(uint32_t i = 0; i < clusterCount; ++i)
+    for(uint32_t i = firstNewClusterIndex; i < clusterCount; ++i)
     {
         clusterTypes.push_back(std::make_shared<ObjectMaterializationTypeMapper> ());
         typeDescriptorContext.addObjectTypeMapper(clusterTypes.back());
@@ -1939,8 +3916,7 @@ bool Deserializer::parseClusterDescriptors()
 
     // Parse the clusters.
     clusterInstanceCount.reserve(clusterCount);
-    uint32_t totalInstanceCount = 0;
-    for(uint32_t clusterIndex = 0; clusterIndex < clusterCount; ++clusterIndex)
+    for(uint32_t clusterIndex = firstNewClusterIndex; clusterIndex < clusterCount; ++clusterIndex)
     {
         auto &clusterType = clusterTypes[clusterIndex];
         uint32_t superTypeIndex;
@@ -1948,10 +3924,16 @@ bool Deserializer::parseClusterDescriptors()
         uint32_t instanceCount;
         if(!input->readUTF8_32_16(clusterType->name) ||
             !input->readUInt32(superTypeIndex) || superTypeIndex > clusterIndex ||
-            !input->readUInt16(fieldCount) ||
-            !input->readUInt32(instanceCount))
+            !input->readUInt16(fieldCount))
             return false;
-        clusterInstanceCount.push_back(instanceCount);
+
+        if(hasInlineInstanceCount)
+        {
+            if(!input->readUInt32(instanceCount))
+                return false;
+            clusterInstanceCount.push_back(instanceCount);
+        }
+
         if(superTypeIndex > 0)
             clusterType->supertype = clusterTypes[superTypeIndex - 1];
 
@@ -1962,32 +3944,121 @@ bool Deserializer::parseClusterDescriptors()
             if(!field.readDescriptionWith(input))
                 return false;
         }
+    }
 
-        totalInstanceCount += instanceCount;
+    return true;
+}
+
+bool Deserializer::validateAndResolveTypes(size_t firstClusterIndex)
+{
+    // The cluster types of the base of an extended schema are already resolved.
+    auto &clusterTypes = schema->clusterTypes;
+    for(size_t i = firstClusterIndex; i < clusterTypes.size(); ++i)
+    {
+        auto &type = clusterTypes[i];
+        if(typeMapperRegistry->isAmbiguousTypeName(type->getName()))
+            return false;
+        type->resolveTypeUsing(typeMapperRegistry->getTypeMapperWithName(type->getName()));
+    }
+
+    for(size_t i = firstClusterIndex; i < clusterTypes.size(); ++i)
+        clusterTypes[i]->resolveTypeFields();
+
+    return true;
+}
+
+bool Deserializer::parseClusterInstanceCounts()
+{
+    if(headerFlags & CoalHeaderFlagSchemaFingerprint)
+    {
+        clusterInstanceCount.resize(clusterCount);
+        for(auto &instanceCount : clusterInstanceCount)
+        {
+            if(!input->readUInt32(instanceCount))
+                return false;
+        }
     }
 
     // Validate the total instance count.
+    uint64_t totalInstanceCount = 0;
+    for(auto instanceCount : clusterInstanceCount)
+        totalInstanceCount += instanceCount;
+
     if(totalInstanceCount != objectCount)
         return false;
 
+    if((headerFlags & CoalHeaderFlagDelta) == 0)
+        return true;
+
+    clusterUpdatedInstances.resize(clusterCount);
+    for(auto &updatedInstances : clusterUpdatedInstances)
+    {
+        uint32_t updatedInstanceCount = 0;
+        if(!input->readUInt32(updatedInstanceCount) || updatedInstanceCount > deltaBaselineInstanceCount)
+            return false;
+
+        updatedInstances.resize(updatedInstanceCount);
+        for(auto &instanceIndex : updatedInstances)
+        {
+            if(!input->readUInt32(instanceIndex) || instanceIndex >= deltaBaselineInstanceCount)
+                return false;
+        }
+    }
+
     return true;
 }
 
-bool Deserializer::validateAndResolveTypes()
+bool Deserializer::parseStableObjectIds()
 {
-    for(auto &type : clusterTypes)
-        type->resolveTypeUsing(typeMapperRegistry->getTypeMapperWithName(type->getName()));
+    if((headerFlags & CoalHeaderFlagStableObjectIds) == 0)
+        return true;
 
-    for(auto &type : clusterTypes)
-        type->resolveTypeFields();
+    // The identifiers are not preallocated, because the object count is not validated against the message size.
+    for(uint32_t i = 0; i < objectCount; ++i)
+    {
+        uint64_t id = 0;
+        if(!input->readUInt64(id))
+            return false;
+        newInstanceStableIds.push_back(id);
+    }
 
     return true;
 }
 
+void Deserializer::registerStableObjectIds(size_t firstNewInstanceIndex)
+{
+    for(size_t i = 0; i < newInstanceStableIds.size(); ++i)
+    {
+        auto &instance = instances[firstNewInstanceIndex + i];
+        auto id = newInstanceStableIds[i];
+        if(!instance || id == 0)
+            continue;
+
+        objectsByStableId[id] = instance;
+        stableIdsByObject[instance->getObjectBasePointer()] = id;
+    }
+}
+
 bool Deserializer::parseClusterInstances()
 {
-    // Make the instances.
-    instances.reserve(objectCount);
+    if(sectionCompressionCodec == CompressionCodec::None)
+        return parseClusterInstancesWith(input);
+
+    DecompressingReadStream instanceInput(input, sectionCompressionCodec);
+    instanceInput.setBinaryBlob(blobData->data(), blobData->size());
+    instanceInput.setStringPool(stringPoolEnabled ? &stringPool : nullptr);
+    instanceInput.setBinaryBlobViewsEnabled(binaryBlobViewsEnabled);
+    instanceInput.setTypeDescriptorContext(&typeDescriptorContext);
+    return parseClusterInstancesWith(&instanceInput) && instanceInput.finish();
+}
+
+bool Deserializer::parseClusterInstancesWith(ReadStream *instanceInput)
+{
+    auto &clusterTypes = schema->clusterTypes;
+
+    // Make the instances. The new instances of a delta message are appended to the baseline instances.
+    auto firstNewInstanceIndex = instances.size();
+    instances.reserve(firstNewInstanceIndex + objectCount);
     for(size_t i = 0; i < clusterTypes.size(); ++i)
     {
         auto &clusterType = clusterTypes[i];
@@ -1995,13 +4066,36 @@ bool Deserializer::parseClusterInstances()
         for(uint32_t j = 0; j < instanceCount; ++j)
             instances.push_back(clusterType->makeInstance());
     }
-    input->setInstances(&instances);
+    instanceInput->setInstances(&instances);
+
+    // The exclusive owners of the baseline objects may change in a delta message.
+    exclusiveOwnershipTable.beginMessage();
+    instanceInput->setExclusiveOwnershipTable(deltaModeEnabled ? &exclusiveOwnershipTable : nullptr);
 
     // Parse the instance data.
-    uint32_t nextInstanceIndex = 0;
+    auto nextInstanceIndex = firstNewInstanceIndex;
     for(size_t i = 0; i < clusterTypes.size(); ++i)
     {
         auto &clusterType = clusterTypes[i];
+        if(i < clusterUpdatedInstances.size())
+        {
+            for(auto instanceIndex : clusterUpdatedInstances[i])
+            {
+                auto &instance = instances[instanceIndex];
+                if(instance)
+                {
+                    if(instance->getTypeMapper() != clusterType->getResolvedType() ||
+                        !clusterType->readInstanceWith(instance->getObjectBasePointer(), instanceInput))
+                        return false;
+                }
+                else
+                {
+                    if(!clusterType->skipInstanceWith(instanceInput))
+                        return false;
+                }
+            }
+        }
+
         auto instanceCount = clusterInstanceCount[i];
         for(uint32_t j = 0; j < instanceCount; ++j)
         {
@@ -2009,27 +4103,40 @@ bool Deserializer::parseClusterInstances()
             if(instance)
             {
                 auto basePointer = instance->getObjectBasePointer();
-                if(!clusterType->readInstanceWith(basePointer, input))
+                if(!clusterType->readInstanceWith(basePointer, instanceInput))
                     return false;
             }
             else
             {
-                if(!clusterType->skipInstanceWith(input))
+                if(!clusterType->skipInstanceWith(instanceInput))
                     return false;
             }
         }
     }
 
+    registerStableObjectIds(firstNewInstanceIndex);
     return true;
 }
 
 bool Deserializer::parseTrailer()
 {
-    uint32_t rootObjectIndex = 0;
-    if(!input->readUInt32(rootObjectIndex) || rootObjectIndex > objectCount)
+    uint32_t rootCount = 1;
+    if((headerFlags & CoalHeaderFlagMultipleRoots) && !input->readUInt32(rootCount))
         return false;
 
-    rootObject = rootObjectIndex > 0 ? instances[rootObjectIndex - 1] : 0;
+    // The roots are not preallocated, because their count is not validated.
+    for(uint32_t i = 0; i < rootCount; ++i)
+    {
+        std::string rootName;
+        uint32_t rootObjectIndex = 0;
+        if(((headerFlags & CoalHeaderFlagMultipleRoots) && !input->readUTF8_32_16(rootName)) ||
+            !input->readUInt32(rootObjectIndex) || rootObjectIndex > instances.size())
+            return false;
+
+        rootNames.push_back(std::move(rootName));
+        rootObjects.push_back(rootObjectIndex > 0 ? instances[rootObjectIndex - 1] : nullptr);
+    }
+
     return true;
 }
 
@@ -1,6 +1,13 @@
 #include "coal-serialization/coal.hpp"
 #include "coal-serialization/coal-std-bindings.hpp"
-
+#include "coal-serialization/coal-checksum.hpp"
+#include "coal-serialization/coal-chunked-stream.hpp"
+#include "coal-serialization/coal-compression.hpp"
+#include "coal-serialization/coal-log.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
 #include <stdexcept>
 #include <iostream>
 
@@ -35,6 +42,23 @@ std::ostream &operator<<(std::ostream &out, const std::vector<T> &v)
     return out;
 }
 
+template<typename T, size_t N>
+std::ostream &operator<<(std::ostream &out, const std::array<T, N> &v)
+{
+    out << '{';
+    bool first = true;
+    for(const auto &e : v)
+    {
+        if(first)
+            first = false;
+        else
+            out << ", ";
+        out << '"' << e << '"';
+    }
+    out << '}';
+    return out;
+}
+
 template<typename T>
 std::ostream &operator<<(std::ostream &out, const std::set<T> &v)
 {
@@ -172,6 +196,190 @@ struct TestNestedStructure : public coal::SerializableStructureTag
     }
 };
 
+/**
+ * Sample structure with fixed size arrays.
+ */
+struct TestTransform : public coal::SerializableStructureTag
+{
+    typedef TestTransform SelfType;
+
+    static constexpr char const __coal_typename__[] = "TestTransform";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"matrix", &SelfType::matrix},
+            {"color", &SelfType::color},
+            {"names", &SelfType::names},
+        };
+    }
+
+    float matrix[16] = {};
+    uint8_t color[4] = {};
+    std::array<std::string, 2> names;
+};
+
+/**
+ * Sample structure with views.
+ */
+struct TestViews : public coal::SerializableStructureTag
+{
+    typedef TestViews SelfType;
+
+    static constexpr char const __coal_typename__[] = "TestViews";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"name", &SelfType::name},
+            {"payload", &SelfType::payload},
+        };
+    }
+
+    std::string_view name;
+    coal::BytesView payload;
+};
+
+/**
+ * Sample structure with variable size arrays, with the same name as TestTransform.
+ */
+struct TestTransformWithVectors : public coal::SerializableStructureTag
+{
+    typedef TestTransformWithVectors SelfType;
+
+    static constexpr char const __coal_typename__[] = "TestTransform";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"matrix", &SelfType::matrix},
+            {"names", &SelfType::names},
+        };
+    }
+
+    std::vector<float> matrix;
+    std::vector<std::string> names;
+};
+
+/**
+ * Sample structure with optional and variant fields.
+ */
+struct TestOptionalFields : public coal::SerializableStructureTag
+{
+    typedef TestOptionalFields SelfType;
+
+    static constexpr char const __coal_typename__[] = "TestOptionalFields";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"count", &SelfType::count},
+            {"label", &SelfType::label},
+            {"value", &SelfType::value},
+            {"tail", &SelfType::tail},
+        };
+    }
+
+    std::optional<int32_t> count;
+    std::optional<std::string> label;
+    std::variant<int32_t, std::string, std::vector<double>> value;
+    int32_t tail = 0;
+};
+
+/**
+ * Sample structure without the optional wrappers, with the same name as TestOptionalFields.
+ */
+struct TestPlainOptionalFields : public coal::SerializableStructureTag
+{
+    typedef TestPlainOptionalFields SelfType;
+
+    static constexpr char const __coal_typename__[] = "TestOptionalFields";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"count", &SelfType::count},
+            {"tail", &SelfType::tail},
+        };
+    }
+
+    int32_t count = 0;
+    int32_t tail = 0;
+};
+
+/**
+ * Sample structure with half precision fields.
+ */
+struct TestFloat16Fields : public coal::SerializableStructureTag
+{
+    typedef TestFloat16Fields SelfType;
+
+    static constexpr char const __coal_typename__[] = "TestFloat16Fields";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            coal::float16Field("weight", &SelfType::weight),
+            coal::float16Field("normals", &SelfType::normals),
+        };
+    }
+
+    float weight = 0;
+    std::vector<float> normals;
+};
+
+/**
+ * Sample structure with single precision fields, with the same name as TestFloat16Fields.
+ */
+struct TestFloat32Fields : public coal::SerializableStructureTag
+{
+    typedef TestFloat32Fields SelfType;
+
+    static constexpr char const __coal_typename__[] = "TestFloat16Fields";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"weight", &SelfType::weight},
+            {"normals", &SelfType::normals},
+        };
+    }
+
+    float weight = 0;
+    std::vector<float> normals;
+};
+
+/**
+ * Sample structure with a 128 bits identifier.
+ */
+struct TestIdentifiedRecord : public coal::SerializableStructureTag
+{
+    typedef TestIdentifiedRecord SelfType;
+
+    static constexpr char const __coal_typename__[] = "TestIdentifiedRecord";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"uuid", &SelfType::uuid},
+            {"delta", &SelfType::delta},
+        };
+    }
+
+    coal::UInt128 uuid;
+    coal::Int128 delta;
+};
+
+std::ostream &operator<<(std::ostream &out, const coal::UInt128 &value)
+{
+    return out << std::hex << value.high << ':' << value.low << std::dec;
+}
+
+std::ostream &operator<<(std::ostream &out, const coal::Int128 &value)
+{
+    return out << std::hex << value.high << ':' << value.low << std::dec;
+}
+
 struct TestStructureWithDifferentOrder
 {
     int integerField = 0;
@@ -282,6 +490,68 @@ public:
     }
 };
 
+/**
+ * A class that is named like TestSharedObject.
+ */
+class TestSharedObjectHomonym : public coal::MakeSerializableSharedSubclassOf<TestSharedObjectHomonym, void>
+{
+public:
+    static constexpr char const __coal_typename__[] = "TestSharedObject";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"name", &SelfType::name},
+        };
+    }
+
+    std::string name;
+};
+
+/**
+ * TestUniqueObjectOwner
+ */
+class TestUniqueObjectOwner : public coal::MakeSerializableSharedSubclassOf<TestUniqueObjectOwner, void>
+{
+public:
+    static constexpr char const __coal_typename__[] = "TestUniqueObjectOwner";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"firstChild", &SelfType::firstChild},
+            {"secondChild", &SelfType::secondChild},
+            {"selectedChild", &SelfType::selectedChild},
+            {"owner", &SelfType::owner},
+        };
+    }
+
+    std::unique_ptr<TestSharedObject> firstChild;
+    std::unique_ptr<TestSharedObject> secondChild;
+    TestSharedObject *selectedChild = nullptr;
+    TestUniqueObjectOwner *owner = nullptr;
+};
+
+/**
+ * TestUniqueAndSharedOwner
+ */
+class TestUniqueAndSharedOwner : public coal::MakeSerializableSharedSubclassOf<TestUniqueAndSharedOwner, void>
+{
+public:
+    static constexpr char const __coal_typename__[] = "TestUniqueAndSharedOwner";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"uniqueChild", &SelfType::uniqueChild},
+            {"sharedChild", &SelfType::sharedChild},
+        };
+    }
+
+    std::unique_ptr<TestSharedObject> uniqueChild;
+    std::shared_ptr<TestSharedObject> sharedChild;
+};
+
 /**
  * TestSharedCyclicObject
  */
@@ -324,6 +594,173 @@ public:
     std::unordered_map<std::string, std::shared_ptr<TestSharedObject>> map;
 };
 
+/**
+ * TestDirtyTrackedObject
+ */
+class TestDirtyTrackedObject : public coal::MakeSerializableSharedSubclassOf<TestDirtyTrackedObject, void>, public coal::DirtyTrackedObject
+{
+public:
+    static constexpr char const __coal_typename__[] = "TestDirtyTrackedObject";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"name", &SelfType::name},
+            {"children", &SelfType::children},
+        };
+    }
+
+    std::string name;
+    std::vector<std::shared_ptr<TestDirtyTrackedObject>> children;
+};
+
+enum class TestPlainEnum : uint16_t
+{
+    First = 1,
+    Second = 2,
+};
+
+enum class TestProtocolEnum : uint8_t
+{
+    Hello = 0,
+    Data = 1,
+    Goodbye = 2,
+};
+
+/**
+ * The next version of TestProtocolEnum, where the enumerators were renumbered.
+ */
+enum class TestRenumberedProtocolEnum : int32_t
+{
+    Ping = 0,
+    Hello = 1,
+    Goodbye = 2,
+    Data = 3,
+};
+
+/**
+ * Sample structure with enum fields.
+ */
+struct TestEnumFields : public coal::SerializableStructureTag
+{
+    typedef TestEnumFields SelfType;
+
+    static constexpr char const __coal_typename__[] = "TestEnumFields";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"plain", &SelfType::plain},
+            {"messages", &SelfType::messages},
+        };
+    }
+
+    TestPlainEnum plain = TestPlainEnum::First;
+    std::vector<TestProtocolEnum> messages;
+};
+
+/**
+ * Sample structure with the renumbered enum, with the same name as TestEnumFields.
+ */
+struct TestRenumberedEnumFields : public coal::SerializableStructureTag
+{
+    typedef TestRenumberedEnumFields SelfType;
+
+    static constexpr char const __coal_typename__[] = "TestEnumFields";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"plain", &SelfType::plain},
+            {"messages", &SelfType::messages},
+        };
+    }
+
+    TestPlainEnum plain = TestPlainEnum::First;
+    std::vector<TestRenumberedProtocolEnum> messages;
+};
+
+/**
+ * Sample structure with pairs whose element types only differ in their nested element types.
+ */
+struct TestPairsWithContainers : public coal::SerializableStructureTag
+{
+    typedef TestPairsWithContainers SelfType;
+
+    static constexpr char const __coal_typename__[] = "TestPairsWithContainers";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"numbers", &SelfType::numbers},
+            {"names", &SelfType::names},
+            {"optionalNumber", &SelfType::optionalNumber},
+            {"optionalName", &SelfType::optionalName},
+            {"message", &SelfType::message},
+            {"renumberedMessage", &SelfType::renumberedMessage},
+        };
+    }
+
+    std::pair<std::vector<int32_t>, int32_t> numbers;
+    std::pair<std::vector<std::string>, int32_t> names;
+    std::pair<std::optional<int32_t>, int32_t> optionalNumber;
+    std::pair<std::optional<std::string>, int32_t> optionalName;
+    std::pair<TestProtocolEnum, int32_t> message;
+    std::pair<TestRenumberedProtocolEnum, int32_t> renumberedMessage;
+};
+
+/**
+ * Sample structure with pairs whose element types share an encoding.
+ */
+struct TestPairsWithSameEncodings : public coal::SerializableStructureTag
+{
+    typedef TestPairsWithSameEncodings SelfType;
+
+    static constexpr char const __coal_typename__[] = "TestPairsWithSameEncodings";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"name", &SelfType::name},
+            {"sharedName", &SelfType::sharedName},
+            {"bytes", &SelfType::bytes},
+            {"stdBytes", &SelfType::stdBytes},
+            {"number", &SelfType::number},
+            {"plainEnum", &SelfType::plainEnum},
+        };
+    }
+
+    std::pair<std::string, int32_t> name;
+    std::pair<std::shared_ptr<const std::string>, int32_t> sharedName;
+    std::pair<std::vector<uint8_t>, int32_t> bytes;
+    std::pair<std::vector<std::byte>, int32_t> stdBytes;
+    std::pair<uint16_t, int32_t> number;
+    std::pair<TestPlainEnum, int32_t> plainEnum;
+};
+
+/**
+ * Read stream whose data is not contiguous in memory, such as a socket or a pipe.
+ */
+class TestStreamingReadStream : public coal::ReadStream
+{
+public:
+    TestStreamingReadStream(const std::vector<uint8_t> &data)
+        : source(data.data(), data.size()) {}
+
+    virtual bool readBytes(uint8_t *buffer, size_t size) override
+    {
+        return source.readBytes(buffer, size);
+    }
+
+    virtual bool skipBytes(size_t size) override
+    {
+        return source.skipBytes(size);
+    }
+
+private:
+    coal::MemoryReadStream source;
+};
+
 namespace coal
 {
 template<>
@@ -365,6 +802,33 @@ struct StructureTypeMetadataFor<TestNestedStructureWithDifferentOrder>
     }
 };
 
+template<>
+struct EnumTypeMetadataFor<TestProtocolEnum>
+{
+    static EnumeratorDescriptions getEnumerators()
+    {
+        return {
+            {"Hello", TestProtocolEnum::Hello},
+            {"Data", TestProtocolEnum::Data},
+            {"Goodbye", TestProtocolEnum::Goodbye},
+        };
+    }
+};
+
+template<>
+struct EnumTypeMetadataFor<TestRenumberedProtocolEnum>
+{
+    static EnumeratorDescriptions getEnumerators()
+    {
+        return {
+            {"Ping", TestRenumberedProtocolEnum::Ping},
+            {"Hello", TestRenumberedProtocolEnum::Hello},
+            {"Goodbye", TestRenumberedProtocolEnum::Goodbye},
+            {"Data", TestRenumberedProtocolEnum::Data},
+        };
+    }
+};
+
 }
 
 class TestSharedShape : public coal::MakeSerializableSharedSubclassOf<TestSharedShape, void>
@@ -436,13 +900,28 @@ public:
     float height;
 };
 
+class TestSharedTransformedBox : public coal::MakeSerializableSharedSubclassOf<TestSharedTransformedBox, TestSharedBox>
+{
+public:
+    static constexpr char const __coal_typename__[] = "TransformedBox";
+
+    static coal::FieldDescriptions __coal_fields__()
+    {
+        return {
+            {"transform", &SelfType::transform}
+        };
+    }
+
+    TestTransform transform;
+};
+
 typedef std::shared_ptr<TestSharedShape> TestSharedShapePtr;
 typedef std::vector<TestSharedShapePtr> TestSharedShapePtrList;
 
 int main()
 {
     int testErrorCount = 0;
-    coal::ensureTypeMapperForTypesExists<TestSharedBox, TestSharedCircle> ();
+    coal::ensureTypeMapperForTypesExists<TestSharedBox, TestSharedCircle, TestSharedTransformedBox> ();
 
     // Primitive values
     {
@@ -652,6 +1131,1330 @@ int main()
         assertEquals(materializedThird, materializedObject->map.at("Third"));
     }
 
+    // TestSharedObjectWithCollections large list with repeated objects
+    {
+        auto root = std::make_shared<TestSharedObjectWithCollections> ();
+        for(int i = 0; i < 10000; ++i)
+        {
+            auto object = std::make_shared<TestSharedObject> ();
+            object->integerField = i;
+            object->floatField = float(i);
+            root->list.push_back(object);
+            root->list.push_back(object);
+        }
+
+        auto serialized = coal::serialize(root);
+        auto materializedObject = coal::deserialize<std::shared_ptr<TestSharedObjectWithCollections>> (serialized).value();
+        assertEquals(20000, materializedObject->list.size());
+        assertEquals(materializedObject->list[0], materializedObject->list[1]);
+        assertEquals(materializedObject->list[9000], materializedObject->list[9001]);
+        assertEquals(0, materializedObject->list[0]->integerField);
+        assertEquals(4500, materializedObject->list[9000]->integerField);
+        assertEquals(9999, materializedObject->list[19999]->integerField);
+    }
+
+    // Reused serializer and deserializer
+    {
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::Serializer serializer(&output);
+        coal::Deserializer deserializer(nullptr);
+
+        for(int i = 0; i < 3; ++i)
+        {
+            auto root = std::make_shared<TestSharedObjectWithCollections> ();
+            auto object = std::make_shared<TestSharedObject> ();
+            object->integerField = i;
+            root->list.push_back(object);
+            root->map.insert({"Object", object});
+
+            serialized.clear();
+            serializer.reset();
+            serializer.serializeRootObjectOrValue(root);
+            assertEquals(coal::serialize(root), serialized);
+
+            coal::MemoryReadStream input(serialized.data(), serialized.size());
+            deserializer.reset(&input);
+            auto materializedObject = deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestSharedObjectWithCollections>> ().value();
+            assertEquals(1, materializedObject->list.size());
+            assertEquals(i, materializedObject->list[0]->integerField);
+            assertEquals(materializedObject->list[0], materializedObject->map.at("Object"));
+        }
+
+        auto cyclic = std::make_shared<TestSharedCyclicObject> ();
+        cyclic->potentiallyCyclicReference2 = std::make_shared<TestSharedCyclicObject> ();
+        serialized.clear();
+        serializer.reset();
+        serializer.serializeRootObjectOrValue(cyclic);
+        assertEquals(coal::serialize(cyclic), serialized);
+
+        coal::MemoryReadStream input(serialized.data(), serialized.size());
+        deserializer.reset(&input);
+        auto materializedCyclic = deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestSharedCyclicObject>> ().value();
+        assertEquals(nullptr, materializedCyclic->potentiallyCyclicReference);
+        assertEquals(true, bool(materializedCyclic->potentiallyCyclicReference2));
+    }
+
+    // Schema fingerprint
+    {
+        auto first = std::make_shared<TestSharedObjectOuter> ();
+        first->innerObject = std::make_shared<TestSharedObject> ();
+        first->innerObject->integerField = 1;
+
+        auto second = std::make_shared<TestSharedObjectOuter> ();
+        second->innerObject = std::make_shared<TestSharedObject> ();
+        second->innerObject->integerField = 2;
+
+        auto firstSerialized = coal::serialize(first);
+        auto secondSerialized = coal::serialize(second);
+        auto otherSerialized = coal::serialize(std::make_shared<TestSharedCyclicObject> ());
+
+        uint64_t firstFingerprint = 0;
+        uint64_t secondFingerprint = 0;
+        uint64_t otherFingerprint = 0;
+        memcpy(&firstFingerprint, firstSerialized.data() + 24, 8);
+        memcpy(&secondFingerprint, secondSerialized.data() + 24, 8);
+        memcpy(&otherFingerprint, otherSerialized.data() + 24, 8);
+        assertEquals(firstFingerprint, secondFingerprint);
+        assertEquals(true, firstFingerprint != otherFingerprint);
+
+        assertEquals(1, coal::deserialize<std::shared_ptr<TestSharedObjectOuter>> (firstSerialized).value()->innerObject->integerField);
+        assertEquals(2, coal::deserialize<std::shared_ptr<TestSharedObjectOuter>> (secondSerialized).value()->innerObject->integerField);
+        assertEquals(1, coal::deserialize<std::shared_ptr<TestSharedObjectOuter>> (firstSerialized).value()->innerObject->integerField);
+
+        // A schema with a forged fingerprint does not reuse the cached schema.
+        const std::string fieldName = "integerField";
+        auto forged = firstSerialized;
+        auto fieldNameData = std::search(forged.begin(), forged.end(), fieldName.begin(), fieldName.end());
+        assertEquals(true, fieldNameData != forged.end());
+        fieldNameData[0] = 'X';
+        assertEquals(0, coal::deserialize<std::shared_ptr<TestSharedObjectOuter>> (forged).value()->innerObject->integerField);
+        assertEquals(1, coal::deserialize<std::shared_ptr<TestSharedObjectOuter>> (firstSerialized).value()->innerObject->integerField);
+    }
+
+    // Without schema fingerprint
+    {
+        auto root = std::make_shared<TestSharedObjectOuter> ();
+        root->innerObject = std::make_shared<TestSharedObject> ();
+        root->innerObject->integerField = 3;
+
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::Serializer serializer(&output);
+        serializer.setSchemaFingerprintEnabled(false);
+        serializer.serializeRootObjectOrValue(root);
+        assertEquals(0, serialized[6]);
+        assertEquals(3, coal::deserialize<std::shared_ptr<TestSharedObjectOuter>> (serialized).value()->innerObject->integerField);
+    }
+
+    // Session mode with elided schemas
+    {
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::Serializer serializer(&output);
+        serializer.setSessionModeEnabled(true);
+
+        coal::Deserializer deserializer(nullptr);
+        deserializer.setSessionModeEnabled(true);
+
+        std::vector<std::vector<uint8_t>> messages;
+        for(int i = 0; i < 3; ++i)
+        {
+            auto root = std::make_shared<TestSharedObjectOuter> ();
+            root->innerObject = std::make_shared<TestSharedObject> ();
+            root->innerObject->integerField = i;
+
+            serialized.clear();
+            serializer.serializeRootObjectOrValue(root);
+            messages.push_back(serialized);
+
+            coal::MemoryReadStream input(serialized.data(), serialized.size());
+            deserializer.reset(&input);
+            auto materializedObject = deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestSharedObjectOuter>> ().value();
+            assertEquals(i, materializedObject->innerObject->integerField);
+        }
+
+        assertEquals(0, messages[0][6] & coal::CoalHeaderFlagSchemaElided);
+        assertEquals(coal::CoalHeaderFlagSchemaElided, messages[1][6] & coal::CoalHeaderFlagSchemaElided);
+        assertEquals(true, messages[1].size() < messages[0].size());
+        assertEquals(messages[1].size(), messages[2].size());
+
+        // An elided message can not be read without its schema.
+        coal::SchemaResolutionCache::uniqueInstance().clear();
+        assertEquals(false, coal::deserialize<std::shared_ptr<TestSharedObjectOuter>> (messages[2]).has_value());
+
+        coal::MemoryReadStream input(messages[2].data(), messages[2].size());
+        deserializer.reset(&input);
+        assertEquals(2, deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestSharedObjectOuter>> ().value()->innerObject->integerField);
+    }
+
+    // Compressing and decompressing streams
+    {
+        std::vector<uint8_t> data;
+        uint32_t seed = 1;
+        for(size_t i = 0; i < 200000; ++i)
+        {
+            seed = seed * 1103515245 + 12345;
+            data.push_back(i < 100000 ? uint8_t(i % 251) : uint8_t(seed >> 24));
+        }
+
+        std::vector<uint8_t> compressed;
+        coal::MemoryWriteStream output(compressed);
+        coal::CompressingWriteStream compressingOutput(&output, coal::CompressionCodec::LZ);
+        compressingOutput.writeBytes(data.data(), data.size());
+        compressingOutput.finish();
+        assertEquals(true, compressed.size() < data.size());
+
+        std::vector<uint8_t> decompressed(data.size());
+        coal::MemoryReadStream input(compressed.data(), compressed.size());
+        coal::DecompressingReadStream decompressingInput(&input, coal::CompressionCodec::LZ);
+        assertEquals(true, decompressingInput.readBytes(decompressed.data(), decompressed.size()));
+        assertEquals(true, decompressingInput.finish());
+        assertEquals(true, data == decompressed);
+    }
+
+    // Multithreaded compression with the available codecs
+    for(auto codec : {coal::CompressionCodec::LZ, coal::CompressionCodec::Zlib, coal::CompressionCodec::Zstd})
+    {
+        if(!coal::isCompressionCodecSupported(codec))
+            continue;
+
+        std::vector<uint8_t> data;
+        for(size_t i = 0; i < 600000; ++i)
+            data.push_back(uint8_t((i * 7) % 253));
+
+        std::vector<uint8_t> compressed;
+        coal::MemoryWriteStream output(compressed);
+        coal::CompressingWriteStream compressingOutput(&output, codec, 4);
+        compressingOutput.writeBytes(data.data(), data.size());
+        compressingOutput.finish();
+        assertEquals(true, compressed.size() < data.size());
+
+        std::vector<uint8_t> decompressed(data.size());
+        coal::MemoryReadStream input(compressed.data(), compressed.size());
+        coal::DecompressingReadStream decompressingInput(&input, codec);
+        assertEquals(true, decompressingInput.readBytes(decompressed.data(), decompressed.size()));
+        assertEquals(true, decompressingInput.finish());
+        assertEquals(true, data == decompressed);
+    }
+
+    // Compressed sections
+    {
+        auto root = std::make_shared<TestSharedObjectWithCollections> ();
+        for(int i = 0; i < 5000; ++i)
+        {
+            auto object = std::make_shared<TestSharedObject> ();
+            object->integerField = i % 7;
+            root->list.push_back(object);
+            root->map.insert({"Object" + std::to_string(i), object});
+        }
+
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::Serializer serializer(&output);
+        serializer.setSectionCompressionCodec(coal::CompressionCodec::LZ);
+        serializer.serializeRootObjectOrValue(root);
+        assertEquals(true, serialized.size() < coal::serialize(root).size());
+
+        auto materializedObject = coal::deserialize<std::shared_ptr<TestSharedObjectWithCollections>> (serialized).value();
+        assertEquals(5000, materializedObject->list.size());
+        assertEquals(5000, materializedObject->map.size());
+        assertEquals(4999 % 7, materializedObject->list[4999]->integerField);
+        assertEquals(materializedObject->list[1234], materializedObject->map.at("Object1234"));
+    }
+
+    // CRC32C
+    {
+        const char *checkString = "123456789";
+        assertEquals(0xE3069283u, coal::crc32c(reinterpret_cast<const uint8_t*> (checkString), 9));
+
+        std::vector<uint8_t> data;
+        for(size_t i = 0; i < 100003; ++i)
+            data.push_back(uint8_t((i * 31) ^ (i >> 7)));
+
+        auto checksum = coal::crc32c(data.data(), data.size());
+        auto firstChecksum = coal::crc32c(data.data(), 40001);
+        auto secondChecksum = coal::crc32c(data.data() + 40001, data.size() - 40001);
+        assertEquals(checksum, coal::crc32c(data.data() + 40001, data.size() - 40001, firstChecksum));
+        assertEquals(checksum, coal::crc32cCombine(firstChecksum, secondChecksum, data.size() - 40001));
+    }
+
+    // Section and trailer checksums
+    for(auto codec : {coal::CompressionCodec::None, coal::CompressionCodec::LZ})
+    {
+        auto root = std::make_shared<TestSharedObjectWithCollections> ();
+        for(int i = 0; i < 100; ++i)
+        {
+            auto object = std::make_shared<TestSharedObject> ();
+            object->integerField = i;
+            root->list.push_back(object);
+            root->map.insert({"Object" + std::to_string(i), object});
+        }
+
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::Serializer serializer(&output);
+        serializer.setSectionCompressionCodec(codec);
+        serializer.setSectionChecksumsEnabled(true);
+        serializer.setTrailerChecksumEnabled(true);
+        serializer.serializeRootObjectOrValue(root);
+
+        auto materializedObject = coal::deserialize<std::shared_ptr<TestSharedObjectWithCollections>> (serialized).value();
+        assertEquals(100, materializedObject->list.size());
+        assertEquals(99, materializedObject->list[99]->integerField);
+
+        auto corrupted = serialized;
+        corrupted[coal::CoalFixedHeaderSize + 30] ^= 0x10;
+        assertEquals(false, coal::deserialize<std::shared_ptr<TestSharedObjectWithCollections>> (corrupted).has_value());
+
+        auto truncated = serialized;
+        truncated.pop_back();
+        assertEquals(false, coal::deserialize<std::shared_ptr<TestSharedObjectWithCollections>> (truncated).has_value());
+
+        // The last byte of the instances and trailer section precedes the section and trailer checksums.
+        auto corruptedInstances = serialized;
+        corruptedInstances[corruptedInstances.size() - 9] ^= 0x01;
+        assertEquals(false, coal::deserialize<std::shared_ptr<TestSharedObjectWithCollections>> (corruptedInstances).has_value());
+
+        // The sections of a stream that is not in memory are buffered.
+        for(auto sectionChecksums : {false, true})
+        {
+            std::vector<uint8_t> streamed;
+            coal::MemoryWriteStream streamedOutput(streamed);
+            serializer.reset(&streamedOutput);
+            serializer.setSectionChecksumsEnabled(sectionChecksums);
+            serializer.serializeRootObjectOrValue(root);
+
+            assertEquals(100, coal::deserialize<std::shared_ptr<TestSharedObjectWithCollections>> (streamed).value()->list.size());
+
+            TestStreamingReadStream input(streamed);
+            coal::Deserializer deserializer(&input);
+            auto streamedObject = deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestSharedObjectWithCollections>> ().value();
+            assertEquals(100, streamedObject->list.size());
+            assertEquals(42, streamedObject->map.at("Object42")->integerField);
+
+            streamed[streamed.size() - 9] ^= 0x01;
+            TestStreamingReadStream corruptedInput(streamed);
+            deserializer.reset(&corruptedInput);
+            assertEquals(false, deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestSharedObjectWithCollections>> ().has_value());
+        }
+    }
+
+    // Chunked sequence
+    {
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::ChunkedSequenceWriter<std::shared_ptr<TestSharedObject>> writer(&output, 100);
+        for(int i = 0; i < 1050; ++i)
+        {
+            auto object = std::make_shared<TestSharedObject> ();
+            object->integerField = i;
+            writer.write(object);
+        }
+        writer.finish();
+
+        coal::MemoryReadStream input(serialized.data(), serialized.size());
+        coal::ChunkedSequenceReader<std::shared_ptr<TestSharedObject>> reader(&input);
+        int readCount = 0;
+        while(auto object = reader.read())
+        {
+            assertEquals(readCount, object.value()->integerField);
+            ++readCount;
+        }
+        assertEquals(1050, readCount);
+        assertEquals(true, reader.hasReachedEnd());
+
+        serialized.resize(serialized.size() - 10);
+        coal::MemoryReadStream truncatedInput(serialized.data(), serialized.size());
+        coal::ChunkedSequenceReader<std::shared_ptr<TestSharedObject>> truncatedReader(&truncatedInput);
+        readCount = 0;
+        while(truncatedReader.read())
+            ++readCount;
+        assertEquals(1000, readCount);
+        assertEquals(false, truncatedReader.hasReachedEnd());
+    }
+
+    // Chunked stream with different root types
+    {
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::ChunkedStreamWriter writer(&output);
+        writer.writeChunkWithRootObjectOrValue(std::string("First"));
+        writer.writeChunkWithRootObjectOrValue(42);
+        writer.writeChunkWithRootObjectOrValue(std::string("Second"));
+        writer.finish();
+
+        coal::MemoryReadStream input(serialized.data(), serialized.size());
+        coal::ChunkedStreamReader reader(&input);
+        assertEquals("First", reader.readChunkWithRootObjectOrValueOfType<std::string> ().value());
+        assertEquals(42, reader.readChunkWithRootObjectOrValueOfType<int> ().value());
+        assertEquals("Second", reader.readChunkWithRootObjectOrValueOfType<std::string> ().value());
+        assertEquals(false, reader.readChunkWithRootObjectOrValueOfType<std::string> ().has_value());
+        assertEquals(true, reader.hasReachedEnd());
+    }
+
+    // Chunked stream with schema extensions
+    {
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::ChunkedStreamWriter writer(&output);
+        for(int i = 0; i < 4; ++i)
+        {
+            TestSharedShapePtrList shapes;
+            auto circle = std::make_shared<TestSharedCircle> ();
+            circle->radius = float(i);
+            shapes.push_back(circle);
+            if(i == 1 || i == 2)
+            {
+                auto box = std::make_shared<TestSharedBox> ();
+                box->width = float(i);
+                shapes.push_back(box);
+            }
+            if(i == 3)
+            {
+                auto transformedBox = std::make_shared<TestSharedTransformedBox> ();
+                transformedBox->transform.names[0] = "Transformed";
+                shapes.push_back(transformedBox);
+            }
+            writer.writeChunkWithRootObjectOrValue(shapes);
+        }
+        writer.finish();
+
+        // The chunks follow the stream header, and each one of them is prefixed by its size.
+        std::vector<std::vector<uint8_t>> chunks;
+        for(size_t offset = 8;;)
+        {
+            uint32_t chunkSize = 0;
+            memcpy(&chunkSize, &serialized[offset], 4);
+            if(chunkSize == 0)
+                break;
+
+            chunks.push_back(std::vector<uint8_t>(serialized.begin() + offset + 4, serialized.begin() + offset + 4 + chunkSize));
+            offset += 4 + chunkSize;
+        }
+        assertEquals(4, chunks.size());
+
+        auto schemaFlagsOf = [](const std::vector<uint8_t> &chunk) {
+            return (chunk[6] | (chunk[7] << 8)) & (coal::CoalHeaderFlagSchemaElided | coal::CoalHeaderFlagSchemaExtension);
+        };
+        auto containsText = [](const std::vector<uint8_t> &chunk, const std::string &text) {
+            return std::search(chunk.begin(), chunk.end(), text.begin(), text.end()) != chunk.end();
+        };
+        assertEquals(0, schemaFlagsOf(chunks[0]));
+        assertEquals(coal::CoalHeaderFlagSchemaExtension, schemaFlagsOf(chunks[1]));
+        assertEquals(coal::CoalHeaderFlagSchemaElided, schemaFlagsOf(chunks[2]));
+        assertEquals(coal::CoalHeaderFlagSchemaExtension, schemaFlagsOf(chunks[3]));
+        assertEquals(true, containsText(chunks[1], "width"));
+        assertEquals(false, containsText(chunks[1], "radius"));
+        assertEquals(true, containsText(chunks[3], "matrix"));
+        assertEquals(false, containsText(chunks[3], "width"));
+
+        coal::MemoryReadStream input(serialized.data(), serialized.size());
+        coal::ChunkedStreamReader reader(&input);
+        for(int i = 0; i < 4; ++i)
+        {
+            auto shapes = reader.readChunkWithRootObjectOrValueOfType<TestSharedShapePtrList> ().value();
+            assertEquals(size_t(i == 0 ? 1 : 2), shapes.size());
+            assertEquals(float(i), std::static_pointer_cast<TestSharedCircle> (shapes[0])->radius);
+            if(i == 1 || i == 2)
+                assertEquals(float(i), std::static_pointer_cast<TestSharedBox> (shapes[1])->width);
+            if(i == 3)
+                assertEquals("Transformed", std::dynamic_pointer_cast<TestSharedTransformedBox> (shapes[1])->transform.names[0]);
+        }
+        assertEquals(false, reader.readChunkWithRootObjectOrValueOfType<TestSharedShapePtrList> ().has_value());
+        assertEquals(true, reader.hasReachedEnd());
+
+        // An extension can not be read without the schema that it extends.
+        coal::Deserializer deserializer(nullptr);
+        deserializer.setSessionModeEnabled(true);
+        coal::MemoryReadStream extensionInput(chunks[1].data(), chunks[1].size());
+        deserializer.reset(&extensionInput);
+        assertEquals(false, deserializer.deserializeRootObjectOrValueOfType<TestSharedShapePtrList> ().has_value());
+    }
+
+    // Multiple roots
+    {
+        auto asset = std::make_shared<TestSharedObject> ();
+        asset->integerField = 7;
+        auto first = std::make_shared<TestSharedObjectOuter> ();
+        first->innerObject = asset;
+        auto second = std::make_shared<TestSharedObjectWithCollections> ();
+        second->list.push_back(asset);
+
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::Serializer serializer(&output);
+        serializer.serializeRootObjects({
+            {"first", coal::makeRootObjectFor(first)},
+            {"second", coal::makeRootObjectFor(second)},
+            {"numbers", coal::makeRootObjectFor(std::vector<int>{1, 2, 3})},
+        });
+
+        coal::MemoryReadStream input(serialized.data(), serialized.size());
+        coal::Deserializer deserializer(&input);
+        assertEquals(true, (deserializer.deserializeRootObjectsOrValuesOfTypes<std::shared_ptr<TestSharedObjectOuter>, std::shared_ptr<TestSharedObjectWithCollections>, std::vector<int>> ()));
+        assertEquals(3, deserializer.getRootObjectCount());
+
+        auto materializedFirst = deserializer.getRootObjectOrValueNamed<std::shared_ptr<TestSharedObjectOuter>> ("first").value();
+        auto materializedSecond = deserializer.getRootObjectOrValueAt<std::shared_ptr<TestSharedObjectWithCollections>> (1).value();
+        assertEquals(7, materializedFirst->innerObject->integerField);
+        assertEquals(materializedFirst->innerObject, materializedSecond->list[0]);
+        assertEquals(3, deserializer.getRootObjectOrValueNamed<std::vector<int>> ("numbers").value()[2]);
+        assertEquals(false, deserializer.getRootObjectOrValueNamed<std::vector<int>> ("missing").has_value());
+
+        // The first root is returned when a single root is expected.
+        assertEquals(7, coal::deserialize<std::shared_ptr<TestSharedObjectOuter>> (serialized).value()->innerObject->integerField);
+    }
+
+    // Multiple roots with values of different types
+    {
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::Serializer serializer(&output);
+        serializer.serializeRootObjects({
+            {"a", coal::makeRootObjectFor(42)},
+            {"b", coal::makeRootObjectFor(std::string("Hello"))},
+            {"c", coal::makeRootObjectFor(std::vector<int>{1, 2, 3})},
+            {"d", coal::makeRootObjectFor(std::vector<std::string>{"First", "Second"})},
+        });
+
+        assertEquals(std::string("RootValueBox<Array32<Int32>>"), coal::RootValueBox<std::vector<int>>::typeMapperSingleton()->getName());
+
+        coal::MemoryReadStream input(serialized.data(), serialized.size());
+        coal::Deserializer deserializer(&input);
+        assertEquals(true, (deserializer.deserializeRootObjectsOrValuesOfTypes<int, std::string, std::vector<int>, std::vector<std::string>> ()));
+        assertEquals(42, deserializer.getRootObjectOrValueNamed<int> ("a").value());
+        assertEquals("Hello", deserializer.getRootObjectOrValueNamed<std::string> ("b").value());
+        assertEquals(3, deserializer.getRootObjectOrValueNamed<std::vector<int>> ("c").value()[2]);
+        assertEquals("Second", deserializer.getRootObjectOrValueNamed<std::vector<std::string>> ("d").value()[1]);
+
+        // A root is not unwrapped as a value of another type.
+        assertEquals(false, deserializer.getRootObjectOrValueNamed<std::string> ("a").has_value());
+        assertEquals(false, deserializer.getRootObjectOrValueNamed<std::vector<int>> ("d").has_value());
+        assertEquals(false, deserializer.getRootObjectOrValueNamed<std::shared_ptr<TestSharedObject>> ("b").has_value());
+
+        // The roots whose types are not expected are not materialized.
+        coal::MemoryReadStream secondInput(serialized.data(), serialized.size());
+        deserializer.reset(&secondInput);
+        assertEquals(true, (deserializer.deserializeRootObjectsOrValuesOfTypes<int, std::vector<std::string>> ()));
+        assertEquals(42, deserializer.getRootObjectOrValueNamed<int> ("a").value());
+        assertEquals(false, deserializer.getRootObjectOrValueNamed<std::string> ("b").has_value());
+        assertEquals("First", deserializer.getRootObjectOrValueNamed<std::vector<std::string>> ("d").value()[0]);
+
+        // The types that have the same name only matter when their name is read.
+        typedef std::shared_ptr<TestSharedObject> TestSharedObjectPtr;
+        typedef std::shared_ptr<TestSharedObjectHomonym> TestSharedObjectHomonymPtr;
+        coal::MemoryReadStream thirdInput(serialized.data(), serialized.size());
+        deserializer.reset(&thirdInput);
+        assertEquals(true, (deserializer.deserializeRootObjectsOrValuesOfTypes<int, TestSharedObjectPtr, TestSharedObjectHomonymPtr> ()));
+        assertEquals(42, deserializer.getRootObjectOrValueNamed<int> ("a").value());
+
+        std::vector<uint8_t> homonymSerialized;
+        coal::MemoryWriteStream homonymOutput(homonymSerialized);
+        coal::Serializer homonymSerializer(&homonymOutput);
+        homonymSerializer.serializeRootObjects({
+            {"a", coal::makeRootObjectFor(42)},
+            {"o", coal::makeRootObjectFor(std::make_shared<TestSharedObject> ())},
+        });
+        coal::MemoryReadStream homonymInput(homonymSerialized.data(), homonymSerialized.size());
+        deserializer.reset(&homonymInput);
+        assertEquals(false, (deserializer.deserializeRootObjectsOrValuesOfTypes<int, TestSharedObjectPtr, TestSharedObjectHomonymPtr> ()));
+        coal::MemoryReadStream unambiguousInput(homonymSerialized.data(), homonymSerialized.size());
+        deserializer.reset(&unambiguousInput);
+        assertEquals(true, (deserializer.deserializeRootObjectsOrValuesOfTypes<int, TestSharedObjectPtr> ()));
+        assertEquals(true, deserializer.getRootObjectOrValueNamed<TestSharedObjectPtr> ("o").has_value());
+    }
+
+    // Delta messages
+    {
+        auto world = std::make_shared<TestSharedObjectWithCollections> ();
+        for(int i = 0; i < 1000; ++i)
+        {
+            auto object = std::make_shared<TestSharedObject> ();
+            object->integerField = i;
+            world->list.push_back(object);
+            world->map.insert({"Object" + std::to_string(i), object});
+        }
+
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::Serializer serializer(&output);
+        serializer.setDeltaModeEnabled(true);
+
+        coal::MemoryReadStream emptyInput(nullptr, 0);
+        coal::Deserializer deserializer(&emptyInput);
+        deserializer.setDeltaModeEnabled(true);
+
+        serializer.serializeRootObjectOrValue(world);
+        auto completeMessageSize = serialized.size();
+        coal::MemoryReadStream completeInput(serialized.data(), serialized.size());
+        deserializer.reset(&completeInput);
+        auto replica = deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestSharedObjectWithCollections>> ().value();
+        auto replicaObject = replica->list[5];
+        assertEquals(1000, replica->list.size());
+
+        // Only the changed object is written.
+        world->list[5]->integerField = -5;
+        serialized.clear();
+        serializer.serializeRootObjectOrValue(world);
+        assertEquals(true, serialized.size()*10 < completeMessageSize);
+        auto deltaMessage = serialized;
+
+        coal::MemoryReadStream deltaInput(serialized.data(), serialized.size());
+        deserializer.reset(&deltaInput);
+        auto updatedReplica = deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestSharedObjectWithCollections>> ().value();
+        assertEquals(replica, updatedReplica);
+        assertEquals(replicaObject, replica->list[5]);
+        assertEquals(-5, replicaObject->integerField);
+        assertEquals(1000, replica->list.size());
+
+        // A new object is appended to the baseline objects.
+        auto newObject = std::make_shared<TestSharedObject> ();
+        newObject->integerField = 1000;
+        world->list.push_back(newObject);
+        world->map.insert({"Object1000", newObject});
+        serialized.clear();
+        serializer.serializeRootObjectOrValue(world);
+        assertEquals(true, serialized.size() < completeMessageSize);
+
+        coal::MemoryReadStream newObjectInput(serialized.data(), serialized.size());
+        deserializer.reset(&newObjectInput);
+        assertEquals(replica, deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestSharedObjectWithCollections>> ().value());
+        assertEquals(replicaObject, replica->list[5]);
+        assertEquals(1001, replica->list.size());
+        assertEquals(1001, replica->map.size());
+        assertEquals(1000, replica->list[1000]->integerField);
+        assertEquals(replica->list[1000], replica->map.at("Object1000"));
+
+        // A delta message requires the baseline.
+        assertEquals(false, coal::deserialize<std::shared_ptr<TestSharedObjectWithCollections>> (deltaMessage).has_value());
+
+        serialized.clear();
+        serializer.serializeRootObjectOrValue(world);
+        assertEquals(true, serialized.size() < deltaMessage.size());
+
+        coal::MemoryReadStream unchangedInput(serialized.data(), serialized.size());
+        deserializer.reset(&unchangedInput);
+        assertEquals(replica, deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestSharedObjectWithCollections>> ().value());
+        assertEquals(1001, replica->list.size());
+    }
+
+    // Fixed size arrays
+    {
+        typedef std::array<int, 2> IntArray2;
+        typedef std::array<int, 3> IntArray3;
+        typedef std::array<int, 16> IntArray16;
+        typedef std::array<double, 2> DoubleArray2;
+        typedef std::array<std::string, 2> StringArray2;
+        assertEquals((IntArray3{1, 2, 3}), coal::deserialize<IntArray3> (coal::serialize(IntArray3{1, 2, 3})).value());
+        assertEquals((StringArray2{"Hello", "World"}), coal::deserialize<StringArray2> (coal::serialize(StringArray2{"Hello", "World"})).value());
+
+        TestTransform transform;
+        for(int i = 0; i < 16; ++i)
+            transform.matrix[i] = float(i);
+        transform.color[3] = 255;
+        transform.names = {"First", "Second"};
+        auto replica = coal::deserialize<TestTransform> (coal::serialize(transform)).value();
+        assertEquals(15.0f, replica.matrix[15]);
+        assertEquals(255, int(replica.color[3]));
+        assertEquals(transform.names, replica.names);
+
+        // Fixed size arrays do not have a size prefix.
+        assertEquals(coal::serialize(std::array<int, 10> {}).size() + 4*6, coal::serialize(IntArray16{}).size());
+
+        // The elements are converted, and extra elements are skipped.
+        assertEquals((DoubleArray2{1, 2}), coal::deserialize<DoubleArray2> (coal::serialize(IntArray3{1, 2, 3})).value());
+        assertEquals((IntArray3{1, 2, 0}), coal::deserialize<IntArray3> (coal::serialize(IntArray2{1, 2})).value());
+
+        // Fixed size arrays can be read from variable size arrays.
+        TestTransformWithVectors transformWithVectors;
+        transformWithVectors.matrix = {1, 2, 3};
+        transformWithVectors.names = {"A", "B", "C"};
+        replica = coal::deserialize<TestTransform> (coal::serialize(transformWithVectors)).value();
+        assertEquals(3.0f, replica.matrix[2]);
+        assertEquals(0.0f, replica.matrix[3]);
+        assertEquals((StringArray2{"A", "B"}), replica.names);
+    }
+
+    // Binary blobs
+    {
+        typedef std::vector<uint8_t> Bytes;
+        typedef std::vector<std::byte> StdBytes;
+        assertEquals((Bytes{1, 2, 3}), coal::deserialize<Bytes> (coal::serialize(Bytes{1, 2, 3})).value());
+        assertEquals(Bytes{}, coal::deserialize<Bytes> (coal::serialize(Bytes{})).value());
+        assertEquals(true, (StdBytes{std::byte(7), std::byte(255)}) == coal::deserialize<StdBytes> (coal::serialize(StdBytes{std::byte(7), std::byte(255)})).value());
+
+        // Identical payloads are stored once.
+        Bytes payload(1000);
+        for(size_t i = 0; i < payload.size(); ++i)
+            payload[i] = uint8_t(i*7);
+        std::vector<Bytes> payloads(10, payload);
+        auto serialized = coal::serialize(payloads);
+        assertEquals(true, serialized.size() < 2*payload.size());
+        assertEquals(payloads, coal::deserialize<std::vector<Bytes>> (serialized).value());
+
+        // Byte arrays that were written element by element can still be read.
+        assertEquals((Bytes{1, 2, 3}), coal::deserialize<Bytes> (coal::serialize(std::vector<int>{1, 2, 3})).value());
+
+        // The blob ranges whose end overflows are rejected.
+        Bytes blob(64);
+        Bytes overflowingReference = {0xF0, 0xFF, 0xFF, 0xFF, 0x20, 0x00, 0x00, 0x00};
+        coal::MemoryReadStream referenceInput(overflowingReference.data(), overflowingReference.size());
+        referenceInput.setBinaryBlob(blob.data(), blob.size());
+        std::string string;
+        assertEquals(false, referenceInput.readUTF8_32_32(string));
+    }
+
+    // Zero-copy views
+    {
+        std::vector<uint8_t> payload = {1, 2, 3, 4};
+        TestViews views;
+        views.name = "A view";
+        views.payload = coal::BytesView(payload);
+        auto firstMessage = coal::serialize(views);
+        views.name = "Another view";
+        auto secondMessage = coal::serialize(views);
+
+        coal::MemoryReadStream firstInput(firstMessage.data(), firstMessage.size());
+        coal::Deserializer deserializer(&firstInput);
+        auto replica = deserializer.deserializeRootObjectOrValueOfType<TestViews> ().value();
+        auto blob = deserializer.getBinaryBlobHandle();
+        assertEquals("A view", std::string(replica.name));
+        assertEquals(true, replica.payload == coal::BytesView(payload));
+
+        // The views point into the blob.
+        auto blobBegin = reinterpret_cast<const char*> (blob->data());
+        assertEquals(true, replica.name.data() >= blobBegin && replica.name.data() + replica.name.size() <= blobBegin + blob->size());
+
+        // The views remain valid while the blob handle is held.
+        coal::MemoryReadStream secondInput(secondMessage.data(), secondMessage.size());
+        deserializer.reset(&secondInput);
+        auto secondReplica = deserializer.deserializeRootObjectOrValueOfType<TestViews> ().value();
+        assertEquals("Another view", std::string(secondReplica.name));
+        assertEquals("A view", std::string(replica.name));
+        assertEquals(true, blob != deserializer.getBinaryBlobHandle());
+
+        // The views are not read when the blob does not outlive the deserializer.
+        assertEquals(false, coal::deserialize<TestViews> (firstMessage).has_value());
+        assertEquals(false, coal::deserialize<std::string_view> (coal::serialize(std::string("A string"))).has_value());
+
+        // The views can be read as strings and byte vectors.
+        assertEquals("Another view", coal::deserialize<std::string> (coal::serialize(std::string_view("Another view"))).value());
+        assertEquals(payload, coal::deserialize<std::vector<uint8_t>> (coal::serialize(coal::BytesView(payload))).value());
+    }
+
+    // String pool
+    {
+        typedef std::shared_ptr<const std::string> SharedString;
+        std::vector<SharedString> names;
+        for(int i = 0; i < 100; ++i)
+            names.push_back(std::make_shared<const std::string> ("Name" + std::to_string(i % 3)));
+        names.push_back(nullptr);
+        auto serialized = coal::serialize(names);
+
+        coal::MemoryReadStream input(serialized.data(), serialized.size());
+        coal::Deserializer deserializer(&input);
+        deserializer.setStringPoolEnabled(true);
+        auto replica = deserializer.deserializeRootObjectOrValueOfType<std::vector<SharedString>> ().value();
+        assertEquals(101, replica.size());
+        assertEquals("Name1", *replica[1]);
+        assertEquals("", *replica[100]);
+        assertEquals(replica[1], replica[4]);
+        assertEquals(true, replica[1] != replica[2]);
+        assertEquals(4, deserializer.getStringPoolSize());
+
+        // Without the pool, each string is materialized separately.
+        auto unpooledReplica = coal::deserialize<std::vector<SharedString>> (serialized).value();
+        assertEquals("Name1", *unpooledReplica[4]);
+        assertEquals(true, unpooledReplica[1] != unpooledReplica[4]);
+    }
+
+    // Optionals and variants
+    {
+        typedef std::optional<int32_t> OptionalInt;
+        typedef std::variant<int32_t, std::string> IntOrString;
+        assertEquals(42, coal::deserialize<OptionalInt> (coal::serialize(OptionalInt(42))).value().value());
+        assertEquals(false, coal::deserialize<OptionalInt> (coal::serialize(OptionalInt())).value().has_value());
+        assertEquals(std::string("Hello"), std::get<1> (coal::deserialize<IntOrString> (coal::serialize(IntOrString("Hello"))).value()));
+        assertEquals(7, std::get<0> (coal::deserialize<IntOrString> (coal::serialize(IntOrString(7))).value()));
+
+        // The values are stored inline, after a single byte tag.
+        assertEquals(coal::serialize(OptionalInt()).size() + 4, coal::serialize(OptionalInt(0)).size());
+
+        TestOptionalFields fields;
+        fields.label = "Label";
+        fields.value = std::vector<double>{1, 2};
+        fields.tail = 5;
+        auto replica = coal::deserialize<TestOptionalFields> (coal::serialize(fields)).value();
+        assertEquals(false, replica.count.has_value());
+        assertEquals(std::string("Label"), replica.label.value());
+        assertEquals(2.0, std::get<2> (replica.value)[1]);
+        assertEquals(5, replica.tail);
+
+        // Unknown optional and variant fields are skipped.
+        fields.count = 3;
+        auto plainReplica = coal::deserialize<TestPlainOptionalFields> (coal::serialize(fields)).value();
+        assertEquals(0, plainReplica.count);
+        assertEquals(5, plainReplica.tail);
+
+        // Plain fields are read as present optionals.
+        plainReplica.count = 9;
+        replica = coal::deserialize<TestOptionalFields> (coal::serialize(plainReplica)).value();
+        assertEquals(9, replica.count.value());
+        assertEquals(false, replica.label.has_value());
+        assertEquals(5, replica.tail);
+
+        // A variant that is valueless by exception is written with a special index, which cannot be read.
+        auto valuelessVariant = coal::serialize(IntOrString(0x7B7B7B7B));
+        const uint8_t valueBytes[] = {0x7B, 0x7B, 0x7B, 0x7B};
+        auto alternativeIndex = std::search(valuelessVariant.begin(), valuelessVariant.end(), std::begin(valueBytes), std::end(valueBytes)) - 1;
+        assertEquals(0, int(*alternativeIndex));
+        *alternativeIndex = coal::VariantTypeDescriptor::ValuelessIndex;
+        assertEquals(false, coal::deserialize<IntOrString> (valuelessVariant).has_value());
+    }
+
+    // Unique and raw pointers
+    {
+        auto object = std::make_shared<TestUniqueObjectOwner> ();
+        object->firstChild = std::make_unique<TestSharedObject> ();
+        object->firstChild->integerField = 1;
+        object->secondChild = std::make_unique<TestSharedObject> ();
+        object->secondChild->integerField = 2;
+        object->selectedChild = object->secondChild.get();
+        object->owner = object.get();
+
+        auto replica = coal::deserialize<std::shared_ptr<TestUniqueObjectOwner>> (coal::serialize(object)).value();
+        assertEquals(*object->firstChild, *replica->firstChild);
+        assertEquals(*object->secondChild, *replica->secondChild);
+        assertEquals(true, replica->selectedChild == replica->secondChild.get());
+        assertEquals(true, replica->owner == replica.get());
+
+        // An object cannot have two exclusive owners.
+        object->firstChild.reset(object->selectedChild);
+        auto serialized = coal::serialize(object);
+        object->firstChild.release();
+        assertEquals(false, coal::deserialize<std::shared_ptr<TestUniqueObjectOwner>> (serialized).has_value());
+
+        // Neither can an object be shared after it was moved into an exclusive owner.
+        auto mixedOwner = std::make_shared<TestUniqueAndSharedOwner> ();
+        mixedOwner->uniqueChild = std::make_unique<TestSharedObject> ();
+        mixedOwner->sharedChild = std::shared_ptr<TestSharedObject> (std::shared_ptr<void> (), mixedOwner->uniqueChild.get());
+        assertEquals(false, coal::deserialize<std::shared_ptr<TestUniqueAndSharedOwner>> (coal::serialize(mixedOwner)).has_value());
+
+        // An updated owner keeps its children in delta mode.
+        object->firstChild = std::make_unique<TestSharedObject> ();
+        object->firstChild->integerField = 1;
+        std::vector<uint8_t> deltaSerialized;
+        coal::MemoryWriteStream output(deltaSerialized);
+        coal::Serializer serializer(&output);
+        serializer.setDeltaModeEnabled(true);
+        coal::MemoryReadStream emptyInput(nullptr, 0);
+        coal::Deserializer deserializer(&emptyInput);
+        deserializer.setDeltaModeEnabled(true);
+
+        serializer.serializeRootObjectOrValue(object);
+        coal::MemoryReadStream completeInput(deltaSerialized.data(), deltaSerialized.size());
+        deserializer.reset(&completeInput);
+        auto deltaReplica = deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestUniqueObjectOwner>> ().value();
+        auto replicaFirstChild = deltaReplica->firstChild.get();
+
+        object->selectedChild = object->firstChild.get();
+        object->firstChild->integerField = 10;
+        deltaSerialized.clear();
+        serializer.serializeRootObjectOrValue(object);
+        coal::MemoryReadStream deltaInput(deltaSerialized.data(), deltaSerialized.size());
+        deserializer.reset(&deltaInput);
+        assertEquals(deltaReplica, deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestUniqueObjectOwner>> ().value());
+        assertEquals(true, deltaReplica->firstChild.get() == replicaFirstChild);
+        assertEquals(true, deltaReplica->selectedChild == replicaFirstChild);
+        assertEquals(10, deltaReplica->firstChild->integerField);
+        assertEquals(2, deltaReplica->secondChild->integerField);
+
+        // A child can be moved into another owner in delta mode.
+        auto movingOwner = std::make_shared<TestUniqueObjectOwner> ();
+        movingOwner->firstChild = std::make_unique<TestSharedObject> ();
+        movingOwner->firstChild->integerField = 1;
+        movingOwner->secondChild = std::make_unique<TestSharedObject> ();
+        movingOwner->secondChild->integerField = 2;
+        coal::Serializer movingSerializer(&output);
+        movingSerializer.setDeltaModeEnabled(true);
+        coal::Deserializer movingDeserializer(&emptyInput);
+        movingDeserializer.setDeltaModeEnabled(true);
+
+        deltaSerialized.clear();
+        movingSerializer.serializeRootObjectOrValue(movingOwner);
+        coal::MemoryReadStream movingInput(deltaSerialized.data(), deltaSerialized.size());
+        movingDeserializer.reset(&movingInput);
+        auto movingReplica = movingDeserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestUniqueObjectOwner>> ().value();
+        auto movedChild = movingReplica->firstChild.get();
+
+        movingOwner->secondChild = std::move(movingOwner->firstChild);
+        deltaSerialized.clear();
+        movingSerializer.serializeRootObjectOrValue(movingOwner);
+        coal::MemoryReadStream movedInput(deltaSerialized.data(), deltaSerialized.size());
+        movingDeserializer.reset(&movedInput);
+        assertEquals(movingReplica, movingDeserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestUniqueObjectOwner>> ().value());
+        assertEquals(true, movingReplica->firstChild == nullptr);
+        assertEquals(true, movingReplica->secondChild.get() == movedChild);
+        assertEquals(1, movingReplica->secondChild->integerField);
+
+        // The new owner may also be read before the previous one gives up the child.
+        movingOwner->firstChild = std::move(movingOwner->secondChild);
+        deltaSerialized.clear();
+        movingSerializer.serializeRootObjectOrValue(movingOwner);
+        coal::MemoryReadStream movedBackInput(deltaSerialized.data(), deltaSerialized.size());
+        movingDeserializer.reset(&movedBackInput);
+        assertEquals(movingReplica, movingDeserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestUniqueObjectOwner>> ().value());
+        assertEquals(true, movingReplica->firstChild.get() == movedChild);
+        assertEquals(true, movingReplica->secondChild == nullptr);
+        assertEquals(1, movingReplica->firstChild->integerField);
+
+        // Only the objects that may be moved into a std::unique_ptr are allocated with a releasable deleter.
+        auto sharedOnly = coal::deserialize<std::shared_ptr<TestSharedCyclicObject>> (coal::serialize(std::make_shared<TestSharedCyclicObject> ())).value();
+        assertEquals(true, std::get_deleter<coal::ReleasableObjectDeleter> (sharedOnly) == nullptr);
+        auto exclusivelyOwnable = coal::deserialize<std::shared_ptr<TestSharedObject>> (coal::serialize(std::make_shared<TestSharedObject> ())).value();
+        assertEquals(true, std::get_deleter<coal::ReleasableObjectDeleter> (exclusivelyOwnable) != nullptr);
+    }
+
+    // Enums
+    {
+        assertEquals(int(TestPlainEnum::Second), int(coal::deserialize<TestPlainEnum> (coal::serialize(TestPlainEnum::Second)).value()));
+        assertEquals(int(TestProtocolEnum::Goodbye), int(coal::deserialize<TestProtocolEnum> (coal::serialize(TestProtocolEnum::Goodbye)).value()));
+
+        // Enums without metadata are encoded as their underlying integer, but their root value box has another name.
+        assertEquals(std::string("RootValueBox<Enum<UInt16>>"), coal::RootValueBox<TestPlainEnum>::typeMapperSingleton()->getName());
+        assertEquals(coal::serialize(uint16_t(2)).size() + strlen("Enum<>"), coal::serialize(TestPlainEnum::Second).size());
+        assertEquals(2, int(coal::deserialize<uint16_t> (coal::serialize(TestPlainEnum::Second)).value()));
+
+        TestEnumFields fields;
+        fields.plain = TestPlainEnum::Second;
+        fields.messages = {TestProtocolEnum::Hello, TestProtocolEnum::Data, TestProtocolEnum::Goodbye};
+        auto replica = coal::deserialize<TestEnumFields> (coal::serialize(fields)).value();
+        assertEquals(int(TestPlainEnum::Second), int(replica.plain));
+        assertEquals(3, int(replica.messages.size()));
+        assertEquals(int(TestProtocolEnum::Data), int(replica.messages[1]));
+
+        // The renumbered enumerators are remapped by name.
+        auto renumberedReplica = coal::deserialize<TestRenumberedEnumFields> (coal::serialize(fields)).value();
+        assertEquals(int(TestPlainEnum::Second), int(renumberedReplica.plain));
+        assertEquals(int(TestRenumberedProtocolEnum::Hello), int(renumberedReplica.messages[0]));
+        assertEquals(int(TestRenumberedProtocolEnum::Data), int(renumberedReplica.messages[1]));
+        assertEquals(int(TestRenumberedProtocolEnum::Goodbye), int(renumberedReplica.messages[2]));
+    }
+
+    // Half precision floats
+    {
+        assertEquals(0x3C00, int(coal::float32ToFloat16(1.0f)));
+        assertEquals(0xC000, int(coal::float32ToFloat16(-2.0f)));
+        assertEquals(0x7BFF, int(coal::float32ToFloat16(65504.0f)));
+        assertEquals(0x7C00, int(coal::float32ToFloat16(70000.0f)));
+        assertEquals(0x0001, int(coal::float32ToFloat16(5.9604645e-8f)));
+        assertEquals(0x3C00, int(coal::float32ToFloat16(1.0f + 1.0f/2048.0f)));
+        assertEquals(0x3C02, int(coal::float32ToFloat16(1.0f + 3.0f/2048.0f)));
+        assertEquals(0.5f, coal::float16ToFloat32(0x3800));
+        assertEquals(5.9604645e-8f, coal::float16ToFloat32(0x0001));
+        assertEquals(true, std::isnan(coal::float16ToFloat32(coal::float32ToFloat16(NAN))));
+
+        // The batch conversions agree with the scalar ones.
+        std::vector<float> values;
+        for(int i = 0; i < 1001; ++i)
+            values.push_back(float(i - 500) * 0.37f);
+        std::vector<uint16_t> halfs(values.size());
+        std::vector<float> converted(values.size());
+        coal::convertFloat32ToFloat16(values.data(), halfs.data(), values.size());
+        coal::convertFloat16ToFloat32(halfs.data(), converted.data(), halfs.size());
+        size_t mismatchCount = 0;
+        for(size_t i = 0; i < values.size(); ++i)
+        {
+            if(halfs[i] != coal::float32ToFloat16(values[i]) || converted[i] != coal::float16ToFloat32(halfs[i]))
+                ++mismatchCount;
+        }
+        assertEquals(size_t(0), mismatchCount);
+
+        TestFloat16Fields fields;
+        fields.weight = 0.25f;
+        fields.normals = values;
+        auto serialized = coal::serialize(fields);
+        auto replica = coal::deserialize<TestFloat16Fields> (serialized).value();
+        assertEquals(0.25f, replica.weight);
+        assertEquals(converted, replica.normals);
+
+        // The half precision fields halve the size, and they can be read as single precision fields.
+        TestFloat32Fields singlePrecisionFields;
+        singlePrecisionFields.weight = fields.weight;
+        singlePrecisionFields.normals = values;
+        assertEquals(true, serialized.size() < coal::serialize(singlePrecisionFields).size() - values.size()*2 + 16);
+        auto singlePrecisionReplica = coal::deserialize<TestFloat32Fields> (serialized).value();
+        assertEquals(0.25f, singlePrecisionReplica.weight);
+        assertEquals(converted, singlePrecisionReplica.normals);
+        assertEquals(values, coal::deserialize<TestFloat16Fields> (coal::serialize(singlePrecisionFields)).value().normals);
+    }
+
+    // 128 bits integers
+    {
+        auto uuid = coal::UInt128{0x0123456789ABCDEFull, 0xFEDCBA9876543210ull};
+        assertEquals(uuid, coal::deserialize<coal::UInt128> (coal::serialize(uuid)).value());
+        assertEquals((coal::Int128{~uint64_t(0), -1}), coal::deserialize<coal::Int128> (coal::serialize(coal::Int128{~uint64_t(0), -1})).value());
+
+        // Widening extends the sign of the encoding.
+        assertEquals((coal::Int128{~uint64_t(0) - 4, -1}), coal::deserialize<coal::Int128> (coal::serialize(int32_t(-5))).value());
+        assertEquals((coal::UInt128{0xFFFFFFFFull, 0}), coal::deserialize<coal::UInt128> (coal::serialize(uint32_t(0xFFFFFFFF))).value());
+
+        // Floating point encodings are not read.
+        assertEquals(coal::UInt128{}, coal::deserialize<coal::UInt128> (coal::serialize(1.5)).value());
+
+        // Narrowing keeps the low bits of integers, and floats get the whole value.
+        assertEquals(uint64_t(0x0123456789ABCDEFull), coal::deserialize<uint64_t> (coal::serialize(uuid)).value());
+        assertEquals(18446744073709551616.0, coal::deserialize<double> (coal::serialize(coal::UInt128{0, 1})).value());
+        assertEquals(-1.0, coal::deserialize<double> (coal::serialize(coal::Int128{~uint64_t(0), -1})).value());
+
+        TestIdentifiedRecord record;
+        record.uuid = uuid;
+        record.delta = coal::Int128{42, -7};
+        auto replica = coal::deserialize<TestIdentifiedRecord> (coal::serialize(record)).value();
+        assertEquals(record.uuid, replica.uuid);
+        assertEquals(record.delta, replica.delta);
+
+#ifdef __SIZEOF_INT128__
+        // The compiler integers are interchangeable with the portable ones.
+        auto nativeUuid = (static_cast<unsigned __int128> (uuid.high) << 64) | uuid.low;
+        assertEquals(true, nativeUuid == coal::deserialize<unsigned __int128> (coal::serialize(uuid)).value());
+        assertEquals(uuid, coal::deserialize<coal::UInt128> (coal::serialize(nativeUuid)).value());
+        assertEquals(true, __int128(-123456789) == coal::deserialize<__int128> (coal::serialize(int64_t(-123456789))).value());
+        assertEquals((coal::Int128{uint64_t(-3), -1}), coal::deserialize<coal::Int128> (coal::serialize(__int128(-3))).value());
+#endif
+    }
+
+    // Pairs and tuples
+    {
+        typedef std::pair<int32_t, int32_t> Cell;
+        typedef std::map<Cell, std::string> Grid;
+        typedef std::tuple<int32_t, std::string, double> Record;
+        typedef std::pair<std::string, TestStructure> NamedStructure;
+
+        auto cell = coal::deserialize<Cell> (coal::serialize(Cell{3, -4})).value();
+        assertEquals(3, cell.first);
+        assertEquals(-4, cell.second);
+
+        Grid grid = {{{0, 0}, "Origin"}, {{1, -1}, "Corner"}};
+        auto gridReplica = coal::deserialize<Grid> (coal::serialize(grid)).value();
+        assertEquals(size_t(2), gridReplica.size());
+        assertEquals(std::string("Corner"), gridReplica[Cell(1, -1)]);
+
+        auto record = coal::deserialize<Record> (coal::serialize(Record{7, "Seven", 7.5})).value();
+        assertEquals(7, std::get<0> (record));
+        assertEquals(std::string("Seven"), std::get<1> (record));
+        assertEquals(7.5, std::get<2> (record));
+
+        NamedStructure namedStructure;
+        namedStructure.first = "Name";
+        namedStructure.second.integerField = 42;
+        auto namedStructureReplica = coal::deserialize<NamedStructure> (coal::serialize(namedStructure)).value();
+        assertEquals(std::string("Name"), namedStructureReplica.first);
+        assertEquals(42, namedStructureReplica.second.integerField);
+
+        // The structure names are synthesized from the element types.
+        assertEquals(std::string("std::pair<Int32, Int32>"), coal::typeMapperForType<Cell> ()->getName());
+        assertEquals(std::string("std::tuple<Int32, UTF8_32_32, Float64>"), coal::typeMapperForType<Record> ()->getName());
+        assertEquals(std::string("std::pair<Array32<UTF8_32_32>, Int32>"), coal::typeMapperForType<decltype(TestPairsWithContainers::names)> ()->getName());
+
+        // The pairs whose element types only differ in their nested element types have different names.
+        TestPairsWithContainers pairs;
+        pairs.numbers = {{1, 2, 3}, 4};
+        pairs.names = {{"First", "Second"}, 5};
+        pairs.optionalNumber = {6, 7};
+        pairs.optionalName = {std::string("Optional"), 8};
+        pairs.message = {TestProtocolEnum::Goodbye, 9};
+        pairs.renumberedMessage = {TestRenumberedProtocolEnum::Ping, 10};
+        auto pairsReplica = coal::deserialize<TestPairsWithContainers> (coal::serialize(pairs)).value();
+        assertEquals(pairs.numbers.first, pairsReplica.numbers.first);
+        assertEquals(pairs.names.first, pairsReplica.names.first);
+        assertEquals(5, pairsReplica.names.second);
+        assertEquals(6, pairsReplica.optionalNumber.first.value());
+        assertEquals(std::string("Optional"), pairsReplica.optionalName.first.value());
+        assertEquals(true, TestProtocolEnum::Goodbye == pairsReplica.message.first);
+        assertEquals(true, TestRenumberedProtocolEnum::Ping == pairsReplica.renumberedMessage.first);
+        assertEquals(10, pairsReplica.renumberedMessage.second);
+
+        // The pairs whose element types share an encoding have different names.
+        TestPairsWithSameEncodings sameEncodings;
+        sameEncodings.name = {"Name", 1};
+        sameEncodings.sharedName = {std::make_shared<const std::string> ("Shared"), 2};
+        sameEncodings.bytes = {{1, 2, 3}, 3};
+        sameEncodings.stdBytes = {{std::byte(4), std::byte(5)}, 4};
+        sameEncodings.number = {6, 5};
+        sameEncodings.plainEnum = {TestPlainEnum::Second, 6};
+        auto sameEncodingsReplica = coal::deserialize<TestPairsWithSameEncodings> (coal::serialize(sameEncodings)).value();
+        assertEquals(std::string("Name"), sameEncodingsReplica.name.first);
+        assertEquals(std::string("Shared"), *sameEncodingsReplica.sharedName.first);
+        assertEquals(2, sameEncodingsReplica.sharedName.second);
+        assertEquals(sameEncodings.bytes.first, sameEncodingsReplica.bytes.first);
+        assertEquals(true, sameEncodings.stdBytes.first == sameEncodingsReplica.stdBytes.first);
+        assertEquals(6, int(sameEncodingsReplica.number.first));
+        assertEquals(true, TestPlainEnum::Second == sameEncodingsReplica.plainEnum.first);
+        assertEquals(6, sameEncodingsReplica.plainEnum.second);
+
+        // A pair can be read with converted element types.
+        typedef std::pair<int64_t, double> WideCell;
+        auto wideCell = coal::deserialize<WideCell> (coal::serialize(Cell{3, -4})).value();
+        assertEquals(int64_t(3), wideCell.first);
+        assertEquals(-4.0, wideCell.second);
+    }
+
+    // Dirty tracked objects
+    {
+        auto world = std::make_shared<TestDirtyTrackedObject> ();
+        for(int i = 0; i < 100; ++i)
+        {
+            auto child = std::make_shared<TestDirtyTrackedObject> ();
+            child->name = "Child" + std::to_string(i);
+            world->children.push_back(child);
+        }
+
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::Serializer serializer(&output);
+        serializer.setDeltaModeEnabled(true);
+
+        coal::MemoryReadStream emptyInput(nullptr, 0);
+        coal::Deserializer deserializer(&emptyInput);
+        deserializer.setDeltaModeEnabled(true);
+
+        serializer.serializeRootObjectOrValue(world);
+        coal::MemoryReadStream completeInput(serialized.data(), serialized.size());
+        deserializer.reset(&completeInput);
+        auto replica = deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestDirtyTrackedObject>> ().value();
+        assertEquals(100, replica->children.size());
+
+        // The encoding of a clean object is reused, so an unmarked modification is not written.
+        world->children[3]->name = "Unmarked";
+        serialized.clear();
+        serializer.serializeRootObjectOrValue(world);
+        coal::MemoryReadStream unmarkedInput(serialized.data(), serialized.size());
+        deserializer.reset(&unmarkedInput);
+        deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestDirtyTrackedObject>> ();
+        assertEquals("Child3", replica->children[3]->name);
+
+        world->children[3]->name = "Marked";
+        world->children[3]->markCoalDirty();
+        serialized.clear();
+        serializer.serializeRootObjectOrValue(world);
+        coal::MemoryReadStream markedInput(serialized.data(), serialized.size());
+        deserializer.reset(&markedInput);
+        deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestDirtyTrackedObject>> ();
+        assertEquals("Marked", replica->children[3]->name);
+        assertEquals("Child4", replica->children[4]->name);
+
+        // The strings of the replaced names do not accumulate forever in the retained blobs, because complete messages are written again.
+        auto completeBlobSize = deserializer.getBinaryBlobHandle()->size();
+        for(int i = 0; i < 1000; ++i)
+        {
+            world->children[3]->name = "A name that is replaced on every tick " + std::to_string(i);
+            world->children[3]->markCoalDirty();
+            serialized.clear();
+            serializer.serializeRootObjectOrValue(world);
+            coal::MemoryReadStream tickInput(serialized.data(), serialized.size());
+            deserializer.reset(&tickInput);
+            replica = deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestDirtyTrackedObject>> ().value();
+        }
+        assertEquals("A name that is replaced on every tick 999", replica->children[3]->name);
+        assertEquals("Child4", replica->children[4]->name);
+        assertEquals(true, deserializer.getBinaryBlobHandle()->size() < 2*completeBlobSize + 8192);
+
+        // A copy is a different object.
+        auto copy = std::make_shared<TestDirtyTrackedObject> (*world->children[5]);
+        assertEquals(true, copy->getCoalDirtyGeneration() != world->children[5]->getCoalDirtyGeneration());
+    }
+
+    // Encoded instance cache
+    {
+        auto world = std::make_shared<TestDirtyTrackedObject> ();
+        world->name = "World";
+        for(int i = 0; i < 10; ++i)
+        {
+            auto asset = std::make_shared<TestDirtyTrackedObject> ();
+            asset->name = "Asset" + std::to_string(i);
+            if(i > 0)
+                asset->children.push_back(world->children.back());
+            world->children.push_back(asset);
+        }
+
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::Serializer serializer(&output);
+        serializer.setEncodedInstanceCacheEnabled(true);
+        serializer.serializeRootObjectOrValue(world);
+        assertEquals(coal::serialize(world), serialized);
+
+        serialized.clear();
+        serializer.serializeRootObjectOrValue(world);
+        assertEquals(coal::serialize(world), serialized);
+
+        // The blob offsets and the references of the cached encodings are relocated.
+        auto newAsset = std::make_shared<TestDirtyTrackedObject> ();
+        newAsset->name = "A new asset with a longer name";
+        world->children.insert(world->children.begin(), newAsset);
+        world->markCoalDirty();
+        serialized.clear();
+        serializer.serializeRootObjectOrValue(world);
+        assertEquals(coal::serialize(world), serialized);
+
+        auto replica = coal::deserialize<std::shared_ptr<TestDirtyTrackedObject>> (serialized).value();
+        assertEquals(11, replica->children.size());
+        assertEquals("A new asset with a longer name", replica->children[0]->name);
+        assertEquals("Asset9", replica->children[10]->name);
+        assertEquals(replica->children[9], replica->children[10]->children[0]);
+
+        // Only the flagged objects are encoded again.
+        world->children[5]->name = "Unflagged";
+        world->children[6]->name = "Flagged";
+        world->children[6]->markCoalDirty();
+        serialized.clear();
+        serializer.serializeRootObjectOrValue(world);
+        replica = coal::deserialize<std::shared_ptr<TestDirtyTrackedObject>> (serialized).value();
+        assertEquals("Asset4", replica->children[5]->name);
+        assertEquals("Flagged", replica->children[6]->name);
+    }
+
+    // Stable object ids
+    {
+        auto world = std::make_shared<TestDirtyTrackedObject> ();
+        for(int i = 0; i < 10; ++i)
+        {
+            auto child = std::make_shared<TestDirtyTrackedObject> ();
+            child->name = "Child" + std::to_string(i);
+            world->children.push_back(child);
+        }
+
+        std::vector<uint8_t> serialized;
+        coal::MemoryWriteStream output(serialized);
+        coal::Serializer serializer(&output);
+        serializer.setStableObjectIdsEnabled(true);
+        serializer.serializeRootObjectOrValue(world);
+
+        auto firstObjectId = serializer.getStableObjectIdOf(world->children[0].get());
+        auto lastObjectId = serializer.getStableObjectIdOf(world->children[9].get());
+        assertEquals(true, firstObjectId != 0);
+        assertEquals(true, firstObjectId != lastObjectId);
+
+        coal::MemoryReadStream input(serialized.data(), serialized.size());
+        coal::Deserializer deserializer(&input);
+        auto replica = deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestDirtyTrackedObject>> ().value();
+        assertEquals(firstObjectId, deserializer.getStableObjectIdOf(replica->children[0].get()));
+        assertEquals(lastObjectId, deserializer.getStableObjectIdOf(replica->children[9].get()));
+        assertEquals(replica->children[9].get(), deserializer.getObjectWithStableId(lastObjectId)->getObjectBasePointer());
+
+        // The identifiers are kept by the next serialization, even by the modified objects.
+        auto newObject = std::make_shared<TestDirtyTrackedObject> ();
+        world->children.push_back(newObject);
+        world->children[9]->name = "Modified";
+        world->children[9]->markCoalDirty();
+        world->markCoalDirty();
+        serialized.clear();
+        serializer.serializeRootObjectOrValue(world);
+        assertEquals(firstObjectId, serializer.getStableObjectIdOf(world->children[0].get()));
+        assertEquals(lastObjectId, serializer.getStableObjectIdOf(world->children[9].get()));
+        auto newObjectId = serializer.getStableObjectIdOf(newObject.get());
+        assertEquals(true, newObjectId != 0 && newObjectId != firstObjectId && newObjectId != lastObjectId);
+
+        coal::MemoryReadStream newInput(serialized.data(), serialized.size());
+        deserializer.reset(&newInput);
+        replica = deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestDirtyTrackedObject>> ().value();
+        assertEquals(firstObjectId, deserializer.getStableObjectIdOf(replica->children[0].get()));
+        assertEquals(newObjectId, deserializer.getStableObjectIdOf(replica->children[10].get()));
+
+        // A new object at the address of a destroyed one does not inherit its identifier.
+        auto reusedAddress = world->children[1].get();
+        auto reusedObjectId = serializer.getStableObjectIdOf(reusedAddress);
+        reusedAddress->~TestDirtyTrackedObject();
+        new (reusedAddress) TestDirtyTrackedObject();
+        world->markCoalDirty();
+        serialized.clear();
+        serializer.serializeRootObjectOrValue(world);
+        assertEquals(true, serializer.getStableObjectIdOf(reusedAddress) != 0);
+        assertEquals(true, serializer.getStableObjectIdOf(reusedAddress) != reusedObjectId);
+
+        // Unreachable objects are forgotten.
+        auto removedObject = world->children[0];
+        world->children.erase(world->children.begin());
+        world->markCoalDirty();
+        serialized.clear();
+        serializer.serializeRootObjectOrValue(world);
+        assertEquals(0, serializer.getStableObjectIdOf(removedObject.get()));
+        assertEquals(lastObjectId, serializer.getStableObjectIdOf(world->children[8].get()));
+
+        // The objects that are not dirty tracked have no identifier.
+        auto untrackedWorld = std::make_shared<TestSharedObjectWithCollections> ();
+        untrackedWorld->list.push_back(std::make_shared<TestSharedObject> ());
+        serialized.clear();
+        serializer.serializeRootObjectOrValue(untrackedWorld);
+        assertEquals(0, serializer.getStableObjectIdOf(untrackedWorld->list[0].get()));
+        coal::MemoryReadStream untrackedInput(serialized.data(), serialized.size());
+        deserializer.reset(&untrackedInput);
+        auto untrackedReplica = deserializer.deserializeRootObjectOrValueOfType<std::shared_ptr<TestSharedObjectWithCollections>> ().value();
+        assertEquals(0, deserializer.getStableObjectIdOf(untrackedReplica->list[0].get()));
+    }
+
+    // Record log
+    {
+        auto logPath = (std::filesystem::temp_directory_path() / "CoalSerializationTests.coallog").string();
+        std::filesystem::remove(logPath);
+
+        {
+            coal::CoalLogWriter writer;
+            assertEquals(true, writer.open(logPath));
+            for(int i = 0; i < 10; ++i)
+                assertEquals(true, writer.append(std::vector<int>{i, i*2}, uint64_t(100 + i*10)));
+            assertEquals(true, writer.close());
+        }
+
+        {
+            coal::CoalLogReader reader;
+            assertEquals(true, reader.open(logPath));
+            assertEquals(10, reader.getRecordCount());
+            assertEquals(150, reader.getRecordTimestamp(5));
+            assertEquals(6, reader.findFirstRecordAtOrAfter(155));
+            assertEquals(14, reader.read<std::vector<int>> (7).value()[1]);
+            assertEquals(false, reader.read<std::vector<int>> (10).has_value());
+        }
+
+        // Reopening for appending drops the index.
+        {
+            coal::CoalLogWriter writer;
+            assertEquals(true, writer.open(logPath));
+            assertEquals(10, writer.getRecordCount());
+            assertEquals(true, writer.append(std::vector<int>{10, 20}, 200));
+            assertEquals(true, writer.close());
+        }
+
+        // Tear the last record, which also removes the index.
+        std::filesystem::resize_file(logPath, std::filesystem::file_size(logPath) - 11*16 - 16 - 3);
+
+        {
+            coal::CoalLogReader reader;
+            assertEquals(true, reader.open(logPath));
+            assertEquals(10, reader.getRecordCount());
+            assertEquals(18, reader.read<std::vector<int>> (9).value()[1]);
+        }
+
+        {
+            coal::CoalLogWriter writer;
+            assertEquals(true, writer.open(logPath));
+            assertEquals(10, writer.getRecordCount());
+            assertEquals(true, writer.append(std::vector<int>{11, 22}, 210));
+            assertEquals(true, writer.close());
+        }
+
+        {
+            coal::CoalLogReader reader;
+            assertEquals(true, reader.open(logPath));
+            assertEquals(11, reader.getRecordCount());
+            assertEquals(22, reader.read<std::vector<int>> (10).value()[1]);
+        }
+
+        std::filesystem::remove(logPath);
+    }
+
     // Empty shape list
     {
         auto materialized = coal::deserialize<TestSharedShapePtrList> (coal::serialize(TestSharedShapePtrList{})).value();